@@ -0,0 +1,130 @@
+#pragma once
+
+#include "GL_Includes.h"
+#include "StreamBuffer.h"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Skeletal animation for IQM files. A skeleton's frames are decoded once,
+// at load, into joint translations, rotations and scales stored one array
+// per channel (padded to blocks of four joints). Every update, each instance
+// blends two frames of its animation (and, while crossfading, the animation
+// it's leaving) four joints at a time with SSE if we have it, then walks
+// the hierarchy to build a palette of 3x4 skinning matrices. Palettes are
+// written to one uniform buffer per frame, and each skinned draw binds
+// its own range of it (see shaders/skinned.vert). The GL side only reads
+// the palettes it's handed, so it can run on the render thread with a copy.
+class Animator
+{
+public:
+	// Palettes are sized for this many joints (the shader's uniform block matches)
+	static const uint32_t kMaxJoints = 128;
+
+	// Where an instance's palette is within GetPalettes
+	struct PaletteRange
+	{
+		size_t uOfs;						// In floats
+		uint32_t uNumJoints;
+	};
+
+	Animator();
+
+	// Create and free the palette buffer (call while the context is alive)
+	bool Init();
+	void Destroy();
+
+	// Load the skeleton and animations in an IQM file (once per file); -1 on failure
+	int LoadSkeleton( const std::string strIqmFile );
+
+	// Add an instance of a skeleton, starting in its bind pose; -1 on failure
+	int AddInstance( int iSkeleton );
+
+	// Start an animation, fading out the current one over fFadeTime seconds
+	bool Play( int iInstance, const std::string strAnim, float fFadeTime );
+
+	// Playback rate (1 is the animation's own framerate)
+	bool SetSpeed( int iInstance, float fSpeed );
+
+	// Advance every instance by fDT seconds and rebuild their palettes
+	void Update( float fDT );
+
+	// Every instance's palette (12 floats, three rows of a 3x4 matrix, per joint)
+	const std::vector<float>& GetPalettes() const;
+	PaletteRange GetPaletteRange( int iInstance ) const;
+
+	// Write the given palettes to this frame's region of the uniform buffer
+	bool Upload( const std::vector<float>& vPalettes, const std::vector<PaletteRange>& vRanges );
+
+	// Bind one of the uploaded ranges to a uniform block binding point
+	bool BindPalette( size_t uRange, GLuint uBinding ) const;
+
+	// Call once every skinned draw has been issued
+	void EndFrame();
+
+	size_t GetNumInstances() const;
+
+	// Joints evaluated by the last Update
+	size_t GetNumJointsEvaluated() const;
+
+private:
+	struct Anim
+	{
+		uint32_t uFirstFrame;
+		uint32_t uNumFrames;
+		float fFrameRate;
+		bool bLoop;
+	};
+
+	struct Skeleton
+	{
+		std::string strSrcFile;
+		uint32_t uNumJoints;
+		uint32_t uNumJoints4;				// Rounded up to a multiple of 4
+		std::vector<int> vParents;			// Parents come before their children
+		std::vector<float> vInvBase;		// Inverse bind pose, 12 floats (3 rows) per joint
+		std::vector<float> vBindPose;		// The bind pose, laid out like a frame
+		std::vector<float> vFrames;			// Each frame is kNumChannels arrays of uNumJoints4 floats
+		std::vector<Anim> vAnims;
+		std::map<std::string, int> mapAnims;
+	};
+
+	// Where we are in an animation (-1 is the bind pose)
+	struct Track
+	{
+		int iAnim;
+		float fTime;						// Seconds
+	};
+
+	struct Instance
+	{
+		int iSkeleton;
+		Track trCur;
+		Track trPrev;						// Being faded out
+		float fFade;						// 0 is all trPrev, 1 is all trCur
+		float fFadeRate;					// Per second
+		float fSpeed;
+		size_t uPaletteOfs;					// Into m_vPalettes, in floats
+	};
+
+	std::vector<Skeleton> m_vSkeletons;
+	std::vector<Instance> m_vInstances;
+	std::vector<float> m_vPalettes;			// Every instance's palette, 12 floats per joint
+
+	// Scratch space for Update
+	std::vector<float> m_vPoseCur, m_vPosePrev;
+	std::vector<float> m_vLocalMats, m_vWorldMats;
+	size_t m_uNumJointsEvaluated;
+
+	StreamBuffer m_PaletteStream;			// One region per frame in flight
+	std::vector<size_t> m_vUploadOfs;		// Each uploaded range's offset in the GL buffer
+	size_t m_uUboAlignment;					// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+
+	// Blend the track's two nearest frames into pOut
+	void sampleTrack( const Skeleton& skel, const Track& tr, float * pOut ) const;
+
+	// Turn a pose into the skinning palette at pPalette
+	void buildPalette( const Skeleton& skel, const float * pPose, float * pPalette );
+};
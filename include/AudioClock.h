@@ -0,0 +1,67 @@
+#pragma once
+
+// Where audio playback is, published by the audio thread each callback
+// and read by anyone (the main thread, mostly) without locking. The
+// audio thread is the only writer: it bumps a sequence number to odd,
+// writes the fields, and bumps it back to even (a seqlock). Readers retry
+// if the number was odd or changed while they read. Reads never block the
+// writer, and the writer never waits on anything.
+//
+// Positions are in samples as the SoundManager counts them (interleaved
+// floats), and readers interpolate from the last callback's timestamp.
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+class AudioClock
+{
+public:
+	// What the audio thread published at the start of a callback
+	struct Snapshot
+	{
+		uint64_t uSamplesRendered;		// Samples rendered before this callback
+		uint64_t uLoopPos;				// The loop sample position the callback started at
+		uint64_t uLoopLength;			// 0 if nothing was looping
+		int64_t iTimestampNs;			// When the callback started (see Now)
+	};
+
+	AudioClock();
+
+	// Samples per second (all channels) and per callback; set before audio starts
+	void SetRate( uint64_t uSamplesPerSecond, uint64_t uSamplesPerBuffer );
+
+	// Publish the state at the start of a callback, timestamped now (audio thread only)
+	void Publish( uint64_t uSamplesRendered, uint64_t uLoopPos, uint64_t uLoopLength );
+
+	// The last published state; false if nothing has been published yet
+	bool Read( Snapshot& snap ) const;
+
+	// Seconds of audio heard so far, interpolated to right now
+	double GetTime() const;
+
+	// Where in the loop playback is, in [0, 1), interpolated to right now
+	float GetLoopPhase() const;
+
+	// Times a reader caught the writer mid-publish and had to read again
+	size_t GetNumRetries() const;
+
+	// Timestamps are steady clock nanoseconds
+	static int64_t Now();
+
+private:
+	std::atomic<uint32_t> m_uSeq;		// Odd while the writer is mid-publish
+	std::atomic<uint64_t> m_uSamplesRendered;
+	std::atomic<uint64_t> m_uLoopPos;
+	std::atomic<uint64_t> m_uLoopLength;
+	std::atomic<int64_t> m_iTimestampNs;
+
+	std::atomic<uint64_t> m_uSamplesPerSecond;
+	std::atomic<uint64_t> m_uSamplesPerBuffer;
+	mutable std::atomic<size_t> m_uNumRetries;
+
+	// Samples heard since the snapshot's callback started. The device plays
+	// the previous buffer while we fill this one, so we're a buffer behind,
+	// and we never run past what's been rendered if a callback is late
+	double samplesSince( const Snapshot& snap, int64_t iNowNs ) const;
+};
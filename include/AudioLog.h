@@ -0,0 +1,49 @@
+#pragma once
+
+// A lock-free, preallocated log that the audio thread can write
+// formatted records into without allocating or blocking. The main
+// thread drains it (SoundManager::Update does this) to stdout or a file.
+// There must only be one writer thread and one reader thread.
+
+#include <atomic>
+#include <memory>
+#include <stdio.h>
+#include <stdint.h>
+
+class AudioLog
+{
+public:
+	// Max length of a formatted record (including null terminator)
+	static const size_t kMaxRecordLength = 120;
+
+	// Construct with the number of records the ring can hold (rounded up to a power of 2)
+	AudioLog( size_t uCapacity = 256 );
+
+	// Format a record into the ring, returns false if it was dropped (called by audio thread)
+	bool Write( const char * szFmt, ... )
+#ifdef __GNUC__
+		__attribute__( (format( printf, 2, 3 )) )
+#endif
+		;
+
+	// Write every pending record to fp, returns the number written (called by main thread)
+	size_t Drain( FILE * fp );
+
+	// The total number of records dropped because the ring was full
+	size_t GetNumDropped() const;
+
+private:
+	struct Record
+	{
+		uint32_t uSeq;						// The record's sequence number
+		char szMsg[kMaxRecordLength];		// The formatted message
+	};
+
+	std::unique_ptr<Record[]> m_pRecords;	// The ring buffer itself
+	size_t m_uMask;							// Capacity - 1
+	std::atomic<size_t> m_uWritePos;		// Only modified by the writer
+	std::atomic<size_t> m_uReadPos;			// Only modified by the reader
+	std::atomic<size_t> m_uNumDropped;		// Incremented by the writer when the ring is full
+	size_t m_uNumDroppedReported;			// The drop count last reported by the reader
+	uint32_t m_uNextSeq;					// Sequence number of the next record written
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+// A lock-free ring the audio thread copies its output into, so the main
+// thread can look at the most recent samples (for visualizers). Writing
+// is a memcpy or two and a store; nothing waits. The reader copies out
+// the latest window, and if the writer lapped it while it copied it
+// tries again. There must only be one writer thread.
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+class AudioTap
+{
+public:
+	// Construct with the number of samples the ring can hold (rounded up to a power of 2)
+	AudioTap( size_t uCapacity = 1 << 15 );
+
+	// Append samples (called by the audio thread)
+	void Write( const float * pSamples, size_t uNumSamples );
+
+	// Copy the uNumSamples most recently written into pOut, oldest first.
+	// Returns how many were copied (fewer if not that many were ever written)
+	size_t ReadLatest( float * pOut, size_t uNumSamples ) const;
+
+	size_t GetCapacity() const;
+
+private:
+	std::unique_ptr<float[]> m_pSamples;	// The ring buffer itself
+	size_t m_uMask;							// Capacity - 1
+	std::atomic<uint64_t> m_uWritePos;		// Total samples written, only modified by the writer
+
+	// Copy uNumSamples starting at uPos (wrapping around the ring)
+	void copyOut( uint64_t uPos, float * pOut, size_t uNumSamples ) const;
+};
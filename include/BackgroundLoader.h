@@ -0,0 +1,96 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+// Runs jobs on a background thread, one at a time and in the order they were
+// requested, using a load function that fills in a result for each. Finished
+// results wait here until whoever owns the loader picks them up with
+// TakeLoaded, so the load function never touches anything the owner can see.
+template <typename Job, typename Result>
+class BackgroundLoader
+{
+public:
+	// Turns a job into a result (called on the loader thread)
+	using LoadFn = void (*)( const Job& job, Result& result );
+
+	BackgroundLoader( LoadFn fnLoad ) :
+		m_fnLoad( fnLoad ),
+		m_bQuit( false )
+	{
+	}
+
+	~BackgroundLoader()
+	{
+		// Tell the loader thread to quit and wait for it
+		{
+			std::lock_guard<std::mutex> lg( m_muLoader );
+			m_bQuit = true;
+		}
+		m_cvLoader.notify_all();
+
+		if ( m_thLoader.joinable() )
+			m_thLoader.join();
+	}
+
+	BackgroundLoader( const BackgroundLoader& ) = delete;
+	BackgroundLoader& operator=( const BackgroundLoader& ) = delete;
+
+	// Queue a job to be run on the loader thread
+	void Request( Job job )
+	{
+		{
+			std::lock_guard<std::mutex> lg( m_muLoader );
+			m_liJobs.push_back( std::move( job ) );
+
+			// Start the thread if we haven't yet
+			if ( m_thLoader.joinable() == false )
+				m_thLoader = std::thread( &BackgroundLoader::loaderThread, this );
+		}
+
+		m_cvLoader.notify_one();
+	}
+
+	// Move any finished results into liLoaded
+	void TakeLoaded( std::list<Result>& liLoaded )
+	{
+		std::lock_guard<std::mutex> lg( m_muLoader );
+		liLoaded.splice( liLoaded.end(), m_liLoaded );
+	}
+
+private:
+	LoadFn m_fnLoad;							// What the loader thread runs for each job
+	bool m_bQuit;								// Set when the loader thread should exit
+	std::mutex m_muLoader;						// Protects everything below
+	std::condition_variable m_cvLoader;			// Signaled when there's a job or we're quitting
+	std::list<Job> m_liJobs;					// Jobs waiting to be run
+	std::list<Result> m_liLoaded;				// Results of finished jobs
+	std::thread m_thLoader;						// The loader thread, started on the first request
+
+	// The loader thread's function
+	void loaderThread()
+	{
+		std::unique_lock<std::mutex> lk( m_muLoader );
+		while ( true )
+		{
+			// Wait for something to do
+			m_cvLoader.wait( lk, [this] () { return m_bQuit || m_liJobs.empty() == false; } );
+			if ( m_bQuit )
+				return;
+
+			// Take the job's node, so nothing is copied
+			std::list<Job> liJob;
+			liJob.splice( liJob.end(), m_liJobs, m_liJobs.begin() );
+
+			// Load without holding the lock
+			lk.unlock();
+			std::list<Result> liLoaded( 1 );
+			m_fnLoad( liJob.front(), liLoaded.front() );
+			lk.lock();
+
+			m_liLoaded.splice( m_liLoaded.end(), liLoaded );
+		}
+	}
+};
@@ -5,6 +5,8 @@
 #include <glm/gtx/quaternion.hpp>
 #include "GL_Includes.h"
 
+#include <array>
+
 class Camera
 {
 public:
@@ -19,6 +21,10 @@ public:
 	mat4 GetTransform();
 	mat4 GetProj();
 
+	// The six planes bounding what GetMat can see (left, right, bottom,
+	// top, near, far), xyz pointing inward and normalized
+	std::array<vec4, 6> GetFrustumPlanes();
+
 	// Access to static shader handles
 	static GLint GetProjHandle();
 	static GLint GetPosHandle();
@@ -31,6 +37,10 @@ private:
 	vec2 m_v2Pos;
 	mat4 m_m4Proj;
 
+	// GetMat is cached until we move or change projection
+	mat4 m_m4Mat;
+	bool m_bMatDirty;
+
 	// Static shader handles
 	static GLint s_ProjHandle;
 	static GLint s_PosHandle;
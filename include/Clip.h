@@ -2,6 +2,8 @@
 
 #include <string>
 #include <vector>
+#include <atomic>
+#include <memory>
 
 // remaps x : [m0, M0] to the range of [m1, M1]
 inline float remap( float x, float m0, float M0, float m1, float M1 )
@@ -12,6 +14,19 @@ inline float remap( float x, float m0, float M0, float m1, float M1 )
 class Clip
 {
 public:
+	// Whether or not the clip's samples are in memory. The main thread moves
+	// clips between these states, except for Evicting -> Evicted / Resident,
+	// which the audio thread does once it knows no voice is using the clip
+	// (the main thread can also cancel an eviction, Evicting -> Resident)
+	enum class EResidency : int
+	{
+		NotResident = 0,						// No samples in memory
+		Loading,								// Being loaded in the background
+		Resident,								// Samples in memory, voices can use it
+		Evicting,								// Waiting on the audio thread to release it
+		Evicted									// Released by the audio thread, can be freed
+	};
+
 	Clip();
 	Clip( const std::string strName,			// The friendly name of the loop
 		  const float * const pHeadBuffer,		// The head buffer
@@ -20,16 +35,53 @@ public:
 		  const size_t uSamplesInTailBuffer,
 		  const size_t m_uFadeSamples);			// and its sample count
 
+	// The residency state is atomic, so these need to be written out
+	Clip( const Clip& other );
+	Clip& operator=( const Clip& other );
+	~Clip();
+
 	std::string GetName() const;
 
+	// Residency state
+	EResidency GetResidency() const;
+	void SetResidency( EResidency eResidency );
+	bool IsResident() const;
+
+	// Move from eFrom to eTo, unless another thread changed it first
+	bool ChangeResidency( EResidency eFrom, EResidency eTo );
+
+	// Not resident, but it may be soon (it's loading, or it's being evicted,
+	// which can be cancelled or followed by a reload if it's wanted again)
+	bool IsLoadPending() const;
+
+	// The number of bytes of sample data currently in memory
+	size_t GetNumResidentBytes() const;
+
+	// Free our samples (only once the audio thread has released us)
+	void Evict();
+
+	// Take the samples of a clip loaded elsewhere
+	void Restore( Clip& staged );
+
 	// The sample count, if bTail is true tail samples included
 	size_t GetNumSamples( bool bTail = false ) const;
 	size_t GetNumFadeSamples() const;
 	float const * GetAudioData() const;
 
+	// Something to hold while looking at GetAudioData from outside (i.e Python). If our
+	// samples are replaced or freed while any are held, the holders get to keep them
+	std::shared_ptr<const void> GetSampleViewToken();
+	bool HasSampleViews() const;
+
 private:
 	size_t m_uSamplesInHead;					// The number of samples in the head
+	size_t m_uTotalSamples;						// The number of samples in the head and tail (even if evicted)
 	size_t m_uFadeSamples;						// The target sample for the fade-out when stopping
 	std::string m_strName;						// The name of the loop (this is never touched by aud thread)
 	std::vector<float> m_vAudioBuffer;			// The vector storing the entire head and tail (with fades baked)
+	std::atomic<EResidency> m_eResidency;		// Whether the above is in memory
+	std::shared_ptr<std::vector<float>> m_spViewToken;	// Takes our samples if they're let go while viewed
+
+	// Called before m_vAudioBuffer is replaced or freed
+	void releaseSampleViews();
 };
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Clip.h"
+#include "BackgroundLoader.h"
+
+#include <SDL_audio.h>
+
+#include <string>
+#include <list>
+
+// Loads clips from WAV files, either immediately or on a background
+// thread. Background loads are picked up later by the main thread
+// with TakeLoaded, so nothing here ever touches clips the audio thread can see.
+class ClipLoader
+{
+public:
+	// Where a clip's samples come from
+	struct Source
+	{
+		std::string strHeadFile;
+		std::string strTailFile;
+		size_t uFadeSamples{ 0 };
+	};
+
+	// A clip that finished loading in the background (bSuccess is false if it failed)
+	struct Loaded
+	{
+		std::string strName;
+		Clip clip;
+		bool bSuccess{ false };
+	};
+
+	ClipLoader();
+
+	// Load a clip right now; the WAV files must match refSpec
+	static bool LoadClip( const std::string strName, const Source& src, const SDL_AudioSpec& refSpec, Clip& clip );
+
+	// Queue a clip to be loaded on the loader thread
+	void Request( const std::string strName, const Source& src, const SDL_AudioSpec& refSpec );
+
+	// Move any finished loads into liLoaded
+	void TakeLoaded( std::list<Loaded>& liLoaded );
+
+private:
+	struct Job
+	{
+		std::string strName;
+		Source src;
+		SDL_AudioSpec spec;
+	};
+
+	BackgroundLoader<Job, Loaded> m_Loader;		// Runs loadJob on its thread
+
+	// LoadClip, for the loader thread
+	static void loadJob( const Job& job, Loaded& loaded );
+};
@@ -2,6 +2,9 @@
 
 #include "GL_Includes.h"
 #include "quatvec.h"
+#include "TransformStore.h"
+#include "MeshData.h"
+#include "MeshArena.h"
 
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
@@ -17,17 +20,67 @@
 
 class Drawable {
 	std::string m_SrcFile;
-	GLuint m_VAO;
-	GLuint m_nIdx;
+	MeshArena::Handle m_hMesh;			// Our mesh's range in the mesh arena
+	bool m_bQuantized;					// Whether the mesh's positions need m_m4Dequant
+	mat4 m_m4Dequant;					// Maps quantized positions to model space
+	vec3 m_v3BoundsMin, m_v3BoundsMax;	// Model space bounds of our mesh
 	vec4 m_Color;
 	quatvec m_QV;
 	vec2 m_Scale; // Could be a part of quatvec...
+
+	// If we've been given a transform store, our transform lives there
+	// (and m_QV / m_Scale are ignored); otherwise we use our own
+	TransformStore * m_pTransformStore;
+	uint32_t m_uTransformIdx;
+
+	// Our instance in the scene's animator, if we're skinned (-1 if not)
+	int m_iAnimInstance;
+
+	// bLoadMesh is false for deferred drawables
+	Drawable(std::string iqmSrc, vec4 clr, quatvec qv, vec2 scale, bool bLoadMesh);
 public:
 	Drawable();
 	Drawable(std::string iqmSrc, vec4 clr, quatvec qv, vec2 scale);
 
+	// A drawable whose mesh isn't loaded here; it draws nothing until
+	// the mesh is cached (see CacheMesh) and ResolveMesh is called
+	static Drawable Deferred(std::string iqmSrc, vec4 clr, quatvec qv, vec2 scale);
+
+	// Pick up our mesh from the mesh cache; returns false if it isn't there yet
+	bool ResolveMesh();
+	bool IsResident() const;
+
+	// Whether a mesh has been uploaded, and upload one (main thread only)
+	static bool IsMeshCached(std::string iqmSrc);
+	static bool CacheMesh(std::string iqmSrc, const MeshData& mesh);
+
+	// Release a mesh's space in the arena, and reclaim freed space
+	static bool FreeMesh(std::string iqmSrc);
+	static void CompactMeshes();
+
+	// Quantize meshes loaded from now on, and how many bytes a mesh saved
+	static void SetQuantizeMeshes(bool bQuantize);
+	static int GetMeshBytesSaved(std::string iqmSrc);
+	static size_t GetTotalMeshBytesSaved();
+
+	// Free every mesh's GL objects (call while the context is alive)
+	static void DestroyMeshes();
+	static const MeshArena& GetMeshArena();
+
 	mat4 GetMV() const;
+
+	// The matrix to draw with: GetMV, plus dequantization if the mesh is quantized
+	mat4 GetDrawMV() const;
+
+	// Maps our mesh's positions to model space (identity unless quantized)
+	mat4 GetDequantMat() const;
 	vec4 GetColor() const;
+	// Where our mesh lives in the arena (null if it isn't resident)
+	const MeshArena::Mesh * GetMesh() const;
+	MeshArena::Handle GetMeshHandle() const;
+
+	// Whether we survived the last cull (always true without a transform store)
+	bool IsVisible() const;
 	
 	void Draw();
 
@@ -41,18 +94,42 @@ public:
 	void Transform(quatvec QV);
 
 	void SetColor(vec4 C);
+
+	// Move our transform into the store, which must outlive us
+	void AttachTransformStore(TransformStore * pStore);
+
+	// Skinned drawables are drawn with their animator instance's joint palette
+	void SetAnimInstance(int iAnimInstance);
+	int GetAnimInstance() const;
+	bool IsSkinned() const;
 	
 	static void SetPosHandle( GLint );
 	static void SetColorHandle( GLint );
 
+	// Where meshes with skinning data send their joint indices and weights
+	static void SetBlendHandles( GLint hBlendIdx, GLint hBlendWeight );
+
 private:
-	// Static VAO cache (string to VAO/nIdx)
-	static std::map<std::string, std::array<GLuint, 2> > s_VAOCache;
+	// What we keep around for each loaded IQM file
+	struct MeshInfo
+	{
+		MeshArena::Handle hMesh;
+		vec3 v3BoundsMin, v3BoundsMax;
+		bool bQuantized;
+		mat4 m4Dequant;
+		size_t uBytesSaved;
+	};
+
+	// Static mesh cache (string to arena handle/bounds), and the arena itself
+	static std::map<std::string, MeshInfo> s_MeshCache;
+	static MeshArena s_MeshArena;
 	// Static Drawable Cache for common primitives
 	static std::map<std::string, Drawable> s_PrimitiveMap;
 
 	static GLint s_PosHandle;
 	static GLint s_ColorHandle;
+	static GLint s_BlendIdxHandle;
+	static GLint s_BlendWeightHandle;
 
 public:
 	static bool DrawPrimitive(std::string prim);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+// 64 bit FNV-1a, used to check that cached meshes and shader binaries
+// still match what they were made from. Hashes chain: pass the result of
+// one call as uHash to the next to hash several buffers as one.
+static const uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+
+uint64_t FnvHash( const void * pData, size_t uNumBytes, uint64_t uHash = kFnvOffsetBasis );
+
+// Hash a whole file, false if it can't be read
+bool FnvHashFile( const std::string strFile, uint64_t& uHash );
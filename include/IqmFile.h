@@ -1,13 +1,31 @@
 #pragma once
 
-// For file IO and exceptions
-#include <stdio.h>
+// For file mapping and exceptions
+#include <algorithm>
 #include <stdexcept>
+#include <string.h>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 class IQMFile
 {
 	// To avoid including stdint
 	using uint32_t = unsigned int;
+	using uint64_t = unsigned long long;
 public:
 	// Various types of data within an IQM File
 	enum class EType : uint32_t
@@ -102,7 +120,33 @@ private:
 		uint32_t num_frames, num_framechannels, ofs_frames, ofs_bounds;
 		uint32_t num_comment, ofs_comment;
 		uint32_t num_extensions, ofs_extensions;
-	} * m_pHeader;
+	} * m_pHeader;		// Start of the mapping
+
+	size_t m_uMapSize;	// Size of the mapping
+#ifdef _WIN32
+	HANDLE m_hFile;
+	HANDLE m_hMapping;
+#endif
+
+	// Unmap the file (if we have one)
+	void release() noexcept
+	{
+#ifdef _WIN32
+		if ( m_pHeader )
+			UnmapViewOfFile( m_pHeader );
+		if ( m_hMapping )
+			CloseHandle( m_hMapping );
+		if ( m_hFile != INVALID_HANDLE_VALUE )
+			CloseHandle( m_hFile );
+		m_hMapping = nullptr;
+		m_hFile = INVALID_HANDLE_VALUE;
+#else
+		if ( m_pHeader )
+			munmap( m_pHeader, m_uMapSize );
+#endif
+		m_pHeader = nullptr;
+		m_uMapSize = 0;
+	}
 
 	// Convenient marker for data within file
 	struct Waypoint
@@ -121,6 +165,8 @@ private:
 				return{ m_pHeader->num_meshes, m_pHeader->ofs_meshes };
 			case EType::TRI:
 				return{ m_pHeader->num_triangles, m_pHeader->ofs_triangles };
+			case EType::JOINT:
+				return{ m_pHeader->num_joints, m_pHeader->ofs_joints };
 			case EType::POSE:
 				return{ m_pHeader->num_poses, m_pHeader->ofs_poses };
 			case EType::ANIM:
@@ -161,41 +207,29 @@ protected:
 	}
 
 	// Get ptr to IQM_T mapped types
-	template <typename T = uint8_t>
+	template <typename T = const uint8_t>
 	inline T * getPtr( EType c ) const noexcept
 	{
 		Waypoint wp = getWaypoint( c );
-		return wp.ofs ? (T *) &reinterpret_cast<char *>(m_pHeader)[wp.ofs] : nullptr;
+		return wp.ofs ? (T *) &reinterpret_cast<const char *>(m_pHeader)[wp.ofs] : nullptr;
 	}
 
 public:
-	// Source constructor
-	IQMFile( const char * szFilename )
+	// Source constructor, maps the file and validates it in place
+	IQMFile( const char * szFilename ) :
+		m_pHeader( nullptr ),
+		m_uMapSize( 0 )
+#ifdef _WIN32
+		, m_hFile( INVALID_HANDLE_VALUE ),
+		m_hMapping( nullptr )
+#endif
 	{
-		FILE * fp = nullptr;
-		char * pDataBuf = nullptr;
-
 		// Useful lambdas
-		auto isLittleEndian = [] ()
-		{	// Check if lil endian (not handled yet)
-			union { int i; uint8_t b[sizeof( int )]; } conv;
-			conv.i = 1;
-			return conv.b[0] != 0;
-		};
-		auto IQMASSERT = [&fp, &pDataBuf] ( bool cond, const char * msg )
+		auto IQMASSERT = [this] ( bool cond, const char * msg )
 		{
 			if ( cond == false )
 			{
-				if ( fp )
-				{
-					fclose( fp );
-					fp = nullptr;
-				}
-				if ( pDataBuf )
-				{
-					free( fp );
-					pDataBuf = nullptr;
-				}
+				release();
 				throw std::runtime_error( msg );
 			}
 		};
@@ -204,41 +238,67 @@ public:
 		const uint32_t IQM_VERSION = 2;
 		const char * IQM_MAGIC = "INTERQUAKEMODEL";
 
-		fp = fopen( szFilename, "r" );
-		IQMASSERT( fp, "Error: Invalid filename provided to IQM File constructor!" );
+		// Map the whole file read only; pages are only read in when touched
+#ifdef _WIN32
+		m_hFile = CreateFileA( szFilename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+		IQMASSERT( m_hFile != INVALID_HANDLE_VALUE, "Error: Invalid filename provided to IQM File constructor!" );
 
-		// Check the file size
-		fseek( fp, 0, SEEK_END );
-		size_t uFileSize = ftell( fp );
-		IQMASSERT( uFileSize, "Error: Empty file provided to IQM File constructor!" );
+		LARGE_INTEGER liFileSize{};
+		IQMASSERT( GetFileSizeEx( m_hFile, &liFileSize ) != 0, "Error: Unable to get IQM file size!" );
+		m_uMapSize = (size_t) liFileSize.QuadPart;
+		IQMASSERT( m_uMapSize, "Error: Empty file provided to IQM File constructor!" );
 
-		// Rewind
-		fseek( fp, 0, SEEK_SET );
+		m_hMapping = CreateFileMappingA( m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr );
+		IQMASSERT( m_hMapping != nullptr, "Error: Unable to map IQM file!" );
 
-		// Allocate internal buffer
-		pDataBuf = (char *) malloc( uFileSize );
-		if ( pDataBuf == nullptr )
-			throw std::bad_alloc();
+		m_pHeader = (Header *) MapViewOfFile( m_hMapping, FILE_MAP_READ, 0, 0, 0 );
+		IQMASSERT( m_pHeader != nullptr, "Error: Unable to map IQM file!" );
+#else
+		int fd = open( szFilename, O_RDONLY );
+		IQMASSERT( fd >= 0, "Error: Invalid filename provided to IQM File constructor!" );
 
-		// Read file into buffer, close file
-		IQMASSERT( uFileSize == fread( pDataBuf, 1, uFileSize, fp ), "Error: Invalid number of bytes read in from file!" );
-		fclose( fp );
-		fp = nullptr;
-
-		// Assign header to beginning of buffer
-		m_pHeader = (Header *) pDataBuf;
-
-		// Checks
-		IQMASSERT( m_pHeader, "No IQM Header loaded" );
+		struct stat st;
+		if ( fstat( fd, &st ) != 0 || st.st_size == 0 )
+		{
+			close( fd );
+			IQMASSERT( false, "Error: Empty file provided to IQM File constructor!" );
+		}
+		m_uMapSize = (size_t) st.st_size;
+
+		// The mapping keeps the file alive, so we can close it right away
+		void * pMap = mmap( nullptr, m_uMapSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+		close( fd );
+		IQMASSERT( pMap != MAP_FAILED, "Error: Unable to map IQM file!" );
+		m_pHeader = (Header *) pMap;
+#endif
+
+		// Checks (everything read through the header must lie within the file)
+		// (sizes are done in 64 bits so a large count can't wrap around)
+		auto inFile = [this] ( uint32_t ofs, uint64_t num, uint64_t size )
+		{
+			return num == 0 || ((uint64_t) ofs + num * size <= (uint64_t) m_uMapSize);
+		};
+		IQMASSERT( m_uMapSize >= sizeof( Header ), "Error: IQM file too small to hold a header" );
+		IQMASSERT( memcmp( m_pHeader->magic, IQM_MAGIC, sizeof( m_pHeader->magic ) ) == 0, "IQM File contained wrong magic number" );
 		IQMASSERT( m_pHeader->version == IQM_VERSION, "IQM file version incorrect" );
-		IQMASSERT( strcmp( m_pHeader->magic, IQM_MAGIC ) == 0, "IQM File contained wrong magic number" );
-		IQMASSERT( (size_t) m_pHeader->filesize == uFileSize, "Error: Inconsistency with file sizes reported" );
+		IQMASSERT( (size_t) m_pHeader->filesize == m_uMapSize, "Error: Inconsistency with file sizes reported" );
+		IQMASSERT( inFile( m_pHeader->ofs_text, m_pHeader->num_text, 1 ), "Error: IQM text out of bounds" );
+		IQMASSERT( inFile( m_pHeader->ofs_meshes, m_pHeader->num_meshes, sizeof( iqmmesh ) ), "Error: IQM meshes out of bounds" );
+		IQMASSERT( inFile( m_pHeader->ofs_vertexarrays, m_pHeader->num_vertexarrays, sizeof( iqmvertexarray ) ), "Error: IQM vertex arrays out of bounds" );
+		IQMASSERT( inFile( m_pHeader->ofs_triangles, m_pHeader->num_triangles, sizeof( iqmtriangle ) ), "Error: IQM triangles out of bounds" );
+		IQMASSERT( inFile( m_pHeader->ofs_joints, m_pHeader->num_joints, sizeof( iqmjoint ) ), "Error: IQM joints out of bounds" );
+		IQMASSERT( inFile( m_pHeader->ofs_poses, m_pHeader->num_poses, sizeof( iqmpose ) ), "Error: IQM poses out of bounds" );
+		IQMASSERT( inFile( m_pHeader->ofs_anims, m_pHeader->num_anims, sizeof( iqmanim ) ), "Error: IQM anims out of bounds" );
+		IQMASSERT( inFile( m_pHeader->ofs_frames, (uint64_t) m_pHeader->num_frames * m_pHeader->num_framechannels, sizeof( uint16_t ) ), "Error: IQM frames out of bounds" );
+		// Bounds() hands out at least one, even if there are no frames
+		IQMASSERT( m_pHeader->ofs_bounds == 0 || inFile( m_pHeader->ofs_bounds, std::max<uint64_t>( m_pHeader->num_frames, 1 ), sizeof( iqmbounds ) ), "Error: IQM bounds out of bounds" );
 
 		// Do a check of the vertex data to catch something odd
-		iqmvertexarray * vArrs( (iqmvertexarray *) &pDataBuf[m_pHeader->ofs_vertexarrays] );
+		const char * pData = (const char *) m_pHeader;
+		const iqmvertexarray * vArrs( (const iqmvertexarray *) &pData[m_pHeader->ofs_vertexarrays] );
 		for ( uint32_t i = 0; i < m_pHeader->num_vertexarrays; i++ )
 		{	// Check array type, cache info
-			iqmvertexarray & va( vArrs[i] );
+			const iqmvertexarray & va( vArrs[i] );
 			EType type = (EType) va.type;
 			IQM_P prim = (IQM_P) va.format;
 			switch ( type )
@@ -248,10 +308,12 @@ public:
 				case EType::TANGENT:
 				case EType::TEXCOORD:
 					IQMASSERT( prim == IQM_P::FLOAT, "Error: Type of vertex attribute incorrect, expected a float" );
+					IQMASSERT( inFile( va.offset, m_pHeader->num_vertexes, (uint64_t) va.size * sizeof( float ) ), "Error: IQM vertex attribute out of bounds" );
 					break;
 				case EType::BLENDINDEXES:
 				case EType::BLENDWEIGHTS:
 					IQMASSERT( prim == IQM_P::UBYTE, "Error: Type of vertex attribute incorrect, expected a byte" );
+					IQMASSERT( inFile( va.offset, m_pHeader->num_vertexes, va.size ), "Error: IQM vertex attribute out of bounds" );
 					break;
 				default:
 					IQMASSERT( false, "Error: Unknown vertex data type encountered in IQM File!" );
@@ -259,52 +321,47 @@ public:
 		}
 	}
 
-	// Destructor, frees buffer
+	// Destructor, unmaps the file
 	~IQMFile()
 	{
-		if ( m_pHeader )
-		{
-			free( m_pHeader );
-			m_pHeader = nullptr;
-		}
+		release();
 	}
 
-	// Operators and copy/move constructors
-	IQMFile( const IQMFile& other )
+	// The mapping can't be shared, so this is move only
+	IQMFile( const IQMFile& other ) = delete;
+	IQMFile& operator=( const IQMFile& other ) = delete;
+
+	IQMFile( IQMFile&& other ) :
+		m_pHeader( nullptr ),
+		m_uMapSize( 0 )
+#ifdef _WIN32
+		, m_hFile( INVALID_HANDLE_VALUE ),
+		m_hMapping( nullptr )
+#endif
 	{
-		m_pHeader = (Header *) malloc( other.m_pHeader->filesize );
-		if ( m_pHeader == nullptr )
-			throw std::bad_alloc();
-		memcpy( m_pHeader, other.m_pHeader, other.m_pHeader->filesize );
-	}
-
-	IQMFile( IQMFile&& other )
-	{
-		m_pHeader = other.m_pHeader;
-		other.m_pHeader = nullptr;
-	}
-
-	IQMFile& operator=( const IQMFile& other )
-	{
-		m_pHeader = (Header *) malloc( other.m_pHeader->filesize );
-		if ( m_pHeader == nullptr )
-			throw std::bad_alloc();
-		memcpy( m_pHeader, other.m_pHeader, other.m_pHeader->filesize );
-		return *this;
+		*this = std::move( other );
 	}
 
 	IQMFile& operator=( IQMFile&& other )
 	{
-		m_pHeader = other.m_pHeader;
-		other.m_pHeader = nullptr;
+		if ( this != &other )
+		{
+			release();
+			std::swap( m_pHeader, other.m_pHeader );
+			std::swap( m_uMapSize, other.m_uMapSize );
+#ifdef _WIN32
+			std::swap( m_hFile, other.m_hFile );
+			std::swap( m_hMapping, other.m_hMapping );
+#endif
+		}
 		return *this;
 	}
 
 	// Get string stored in file
-	const char * GetString( uint32_t uStringOffset )
+	const char * GetString( uint32_t uStringOffset ) const
 	{
 		if ( uStringOffset < m_pHeader->num_text )
-			return &((char *) m_pHeader)[m_pHeader->ofs_text];
+			return &((const char *) m_pHeader)[m_pHeader->ofs_text + uStringOffset];
 		return nullptr;
 	}
 
@@ -330,9 +387,9 @@ public:
 			return ratio * m_pFile->getNum( C );
 		}
 		// The size of the data in bytes
-		inline uint32_t numBytes() const noexcept
+		inline uint64_t numBytes() const noexcept
 		{
-			return count() * sizeof( T );
+			return (uint64_t) count() * sizeof( T );
 		}
 		// Type Size
 		inline size_t size() const noexcept
@@ -344,13 +401,13 @@ public:
 		{
 			return sizeof( N );
 		}
-		// Pointer to location in file
-		inline T * ptr() const noexcept
+		// Pointer to location in file (the mapping is read only)
+		inline const T * ptr() const noexcept
 		{
-			return m_pFile->getPtr<T>( C );
+			return m_pFile->getPtr<const T>( C );
 		}
 		// Array operator
-		inline T& operator[]( const uint32_t idx ) const
+		inline const T& operator[]( const uint32_t idx ) const
 		{
 			return ptr()[idx];
 		}
@@ -409,12 +466,18 @@ public:
 	IQMATTRFNGENMACRO( iqmtriangle, EType::TRI, Triangles );
 	// Returns Joints
 	IQMATTRFNGENMACRO( iqmjoint, EType::JOINT, Joints );
+	// Returns poses (one per joint, describing how frames animate it)
+	IQMATTRFNGENMACRO( iqmpose, EType::POSE, Poses );
 	// Returns anims
 	IQMATTRFNGENMACRO( iqmanim, EType::ANIM, Anims );
-	// Returns frames
+	// Returns frames (num_frames * num_framechannels ushorts, so count() only covers the first channel of each)
 	IQMATTRFNGENMACRO( uint16_t, EType::FRAME, Frames );
+	// Returns bounds (one per frame, only present for animated files)
+	IQMATTRFNGENMACRO( iqmbounds, EType::BBOX, Bounds );
 	// Returns triangles as uint32_t rather than iqmtriangle
 	auto Indices()->decltype(Triangles<uint32_t>()) { return Triangles<uint32_t>(); }
 	// Get # of frames
-	inline uint32_t getNumFrames() { return m_pHeader->num_frames; }
+	inline uint32_t getNumFrames() const { return m_pHeader->num_frames; }
+	// Get # of ushorts stored per frame
+	inline uint32_t getNumFrameChannels() const { return m_pHeader->num_framechannels; }
 };
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "GL_Includes.h"
+#include "MeshData.h"
+
+#include <vector>
+#include <stdint.h>
+
+// Meshes share one vertex buffer, one index buffer, and one VAO per
+// vertex format. Each mesh is a range of vertices and a range of
+// indices within those, drawn with a base vertex and an index offset.
+// Freed meshes leave holes until Compact, which copies the live ranges
+// into fresh buffers on the GPU (the same happens when a pool grows).
+class MeshArena
+{
+public:
+	// A slot index in the low bits and the slot's generation in the high
+	// bits; freed slots get reused, but the generation moves on, so a
+	// stale handle just stops working
+	using Handle = uint32_t;
+	static const Handle kInvalidHandle = ~0u;
+	static const uint32_t kSlotBits = 24;
+
+	// Everything needed to draw a mesh; offsets change on compaction,
+	// so look this up each frame rather than holding on to it
+	struct Mesh
+	{
+		GLuint VAO;
+		GLenum eIdxType;
+		GLuint nIdx;
+		GLuint uIdxOffset;		// In bytes
+		GLint iBaseVertex;
+	};
+
+	MeshArena();
+	~MeshArena();
+
+	// Copy the mesh into the pool for its vertex format (the position attribute
+	// goes to hPos, and skinning attributes, if the mesh has them, to the others)
+	Handle Add( const MeshData& mesh, GLint hPos, GLint hBlendIdx = -1, GLint hBlendWeight = -1 );
+
+	// Release a mesh's ranges (the space comes back on Compact)
+	bool Free( Handle hMesh );
+
+	// Null if the handle isn't live
+	const Mesh * Get( Handle hMesh ) const;
+
+	// Repack every pool that has holes
+	void Compact();
+
+	// Free every GL object (call while the context is alive)
+	void Destroy();
+
+	// Bytes held by live meshes, and bytes allocated in GL buffers
+	size_t GetUsedBytes() const;
+	size_t GetAllocatedBytes() const;
+	size_t GetNumPools() const;
+
+private:
+	// Buffers and VAO shared by every mesh with one vertex format
+	struct Pool
+	{
+		uint32_t uFormat;
+		uint32_t uStride;
+		GLint hPos;
+		GLint hBlendIdx;
+		GLint hBlendWeight;
+		GLuint VAO;
+		GLuint VBO;
+		GLuint IBO;
+		size_t uVertexCapacity;			// In vertices
+		size_t uVerticesUsed;			// High water mark, including holes
+		size_t uIndexCapacity;			// In bytes
+		size_t uIndexBytesUsed;			// High water mark, including holes
+		size_t uNumHoles;				// Freed allocations since the last repack
+	};
+
+	// Where a mesh lives
+	struct Allocation
+	{
+		uint32_t uPool;
+		uint32_t uFirstVertex;
+		uint32_t uNumVertices;
+		uint32_t uIdxBytes;				// Rounded up to 4 so every range stays aligned
+		uint32_t uGeneration;			// Bumped whenever the slot is freed
+		bool bLive;
+		Mesh mesh;
+	};
+
+	std::vector<Pool> m_vPools;
+	std::vector<Allocation> m_vAllocations;
+	std::vector<uint32_t> m_vFreeSlots;	// Slots in m_vAllocations that Add can reuse
+
+	// The live allocation a handle refers to, null if it's stale
+	Allocation * getAllocation( Handle hMesh );
+	const Allocation * getAllocation( Handle hMesh ) const;
+
+	// Mark a slot dead and make it available to Add
+	void releaseSlot( uint32_t uSlot );
+
+	// Find (or create) the pool for a vertex format
+	uint32_t getPool( uint32_t uFormat, uint32_t uStride, GLint hPos, GLint hBlendIdx, GLint hBlendWeight );
+
+	// Make new buffers with the given capacity and copy every live range into them, packed
+	void repack( uint32_t uPool, size_t uVertexCapacity, size_t uIndexCapacity );
+
+	// Point the pool's VAO at its current buffers
+	void setupVAO( Pool& pool );
+};
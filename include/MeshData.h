@@ -0,0 +1,109 @@
+#pragma once
+
+#include "GL_Includes.h"
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// A mesh in the form the GPU wants it: vertex attributes interleaved,
+// indices already narrowed to 16 bits if they fit, and bounds computed.
+// The header, vertices, and indices live in one contiguous blob, which
+// is exactly what gets written to (and read back from) a .mesh file
+// next to the source IQM file, so loading is one read and two uploads
+// (into the mesh arena, see MeshArena)
+class MeshData
+{
+public:
+	// Attributes that can be present in the vertex data, in interleaved order,
+	// and flags saying how they're packed (if quantized, see FromIQM)
+	enum EVertexAttr : uint32_t
+	{
+		Position = 1 << 0,			// 3 floats
+		Normal = 1 << 1,			// 3 floats
+		TexCoord = 1 << 2,			// 2 floats
+		QuantizedPosition = 1 << 3,	// 4 normalized ushorts (w unused) within the bounds
+		QuantizedNormal = 1 << 4,	// 4 normalized shorts (w unused)
+		HalfTexCoord = 1 << 5,		// 2 half floats
+		BlendIndexes = 1 << 6,		// 4 ubytes, joints for skinning
+		BlendWeights = 1 << 7		// 4 normalized ubytes, their weights
+	};
+
+	// What's at the front of the blob
+	struct Header
+	{
+		char magic[8];
+		uint32_t uVersion;
+		uint32_t uVertexFormat;			// EVertexAttr bits
+		uint32_t uStride;				// Bytes per vertex
+		uint32_t uNumVertices;
+		uint32_t uNumIndices;
+		uint32_t eIdxType;				// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+		float fBoundsMin[3];
+		float fBoundsMax[3];
+		uint32_t uVertexBytes;			// Vertex data follows the header
+		uint32_t uIndexBytes;			// Index data follows the vertex data
+		uint32_t uUnpackedBytes;		// What it would take with float attributes and 32 bit indices
+		uint32_t uPad;
+		uint64_t uSrcHash;				// Hash of the IQM file this came from
+		uint64_t uDataHash;				// Hash of the vertex and index data
+		uint64_t uSrcSize;				// Size and modification time of the IQM file,
+		int64_t iSrcMTime;				// so it only gets hashed again if they change
+	};
+
+	MeshData();
+
+	// Convert an IQM file. If bQuantize is set, positions become normalized
+	// ushorts spanning the bounds (undone by GetDequantMat), normals become
+	// normalized shorts, and texcoords become half floats
+	static bool FromIQM( const std::string strIqmFile, MeshData& mesh, bool bQuantize );
+
+	// Whether LoadCached quantizes (a cache made the other way gets redone)
+	static void SetQuantize( bool bQuantize );
+	static bool GetQuantize();
+
+	// Load the .mesh file next to strIqmFile if it's valid and up to date,
+	// otherwise convert the IQM file and write one for next time. The IQM
+	// file is only read if its size or modification time have changed
+	static bool LoadCached( const std::string strIqmFile, MeshData& mesh );
+
+	// Read or write a .mesh file (Load checks the data, not the source)
+	static bool Load( const std::string strMeshFile, MeshData& mesh );
+	bool Save( const std::string strMeshFile ) const;
+
+	// A file's size and modification time, false if it can't be found
+	static bool StatFile( const std::string strFile, uint64_t& uSize, int64_t& iMTime );
+
+	// Where the .mesh file for an IQM file goes
+	static std::string GetCachePath( const std::string strIqmFile );
+
+	bool IsValid() const;
+	const Header& GetHeader() const;
+	const uint8_t * GetVertices() const;
+	const uint8_t * GetIndices() const;
+	vec3 GetBoundsMin() const;
+	vec3 GetBoundsMax() const;
+
+	// Maps quantized positions back to model space (identity if not quantized)
+	bool IsQuantized() const;
+	mat4 GetDequantMat() const;
+
+	// Bytes saved by quantization and narrow indices
+	size_t GetBytesSaved() const;
+
+	// Byte offset of an attribute within a vertex (-1 if not present)
+	int GetAttrOffset( EVertexAttr eAttr ) const;
+	static int GetAttrOffset( uint32_t uFormat, EVertexAttr eAttr );
+
+	// Size of an attribute in a vertex of the given format (0 if not present)
+	static uint32_t GetAttrSize( uint32_t uFormat, EVertexAttr eAttr );
+
+private:
+	std::vector<uint8_t> m_vData;		// Header, then vertices, then indices
+
+	Header * header();
+	bool validate( size_t uNumBytes ) const;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "MeshData.h"
+#include "BackgroundLoader.h"
+
+#include <string>
+#include <list>
+
+// Loads meshes (from their .mesh cache, or the IQM file if that's stale)
+// on a background thread. Nothing here touches GL; the main thread picks
+// up finished meshes with TakeLoaded and uploads them itself.
+class MeshLoader
+{
+public:
+	// A mesh that finished loading (bSuccess is false if it failed)
+	struct Loaded
+	{
+		std::string strIqmFile;
+		MeshData mesh;
+		bool bSuccess{ false };
+	};
+
+	MeshLoader();
+
+	// Load a mesh right now
+	static void LoadMesh( const std::string& strIqmFile, Loaded& loaded );
+
+	// Queue a mesh to be loaded on the loader thread
+	void Request( const std::string strIqmFile );
+
+	// Move any finished loads into liLoaded
+	void TakeLoaded( std::list<Loaded>& liLoaded );
+
+private:
+	BackgroundLoader<std::string, Loaded> m_Loader;		// Runs LoadMesh on its thread
+};
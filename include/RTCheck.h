@@ -0,0 +1,93 @@
+#pragma once
+
+// Debug-only real-time safety checks for the audio thread.
+// When RT_CHECK_ENABLED is defined (see the RT_CHECK cmake option)
+// the thread inside SoundManager::FillAudio is marked as the audio
+// thread, and any heap allocation, free, or blocking mutex lock made
+// while it is marked gets recorded (with a backtrace) into a fixed
+// size lock-free buffer. Without the define everything here is a no-op.
+
+#include <mutex>
+#include <stddef.h>
+
+namespace RTCheck
+{
+	// The kinds of things the audio thread shouldn't be doing
+	enum class EViolation : int
+	{
+		None = 0,
+		Alloc,			// operator new / malloc / calloc / realloc
+		Free,			// operator delete / free
+		Lock			// Locking an RTCheck::Mutex (try_lock is fine, it never waits)
+	};
+
+	// Max number of frames stored per violation
+	const int kMaxFrames = 16;
+
+	// A single recorded violation
+	struct Violation
+	{
+		EViolation eType{ EViolation::None };
+		size_t uSize{ 0 };						// Allocation size, if applicable
+		int nFrames{ 0 };						// Number of valid frames in apFrames
+		void * apFrames[kMaxFrames]{ 0 };		// Return addresses at the time of the violation
+	};
+
+#ifdef RT_CHECK_ENABLED
+	// Mark / unmark the calling thread as the audio thread
+	void SetAudioThread( bool bAudioThread );
+	bool IsAudioThread();
+
+	// Record a violation if we're on the audio thread (safe to call from anywhere)
+	void Report( EViolation eType, size_t uSize = 0 );
+
+	// The number of violations reported (including those that didn't fit in the buffer)
+	size_t GetNumViolations();
+
+	// Copy out a recorded violation, returns false if idx is out of range or still being written
+	bool GetViolation( size_t uIdx, Violation& v );
+
+	// Print every recorded violation (and its backtrace) to stdout
+	void PrintViolations();
+
+	// Forget every recorded violation
+	void Reset();
+#else
+	inline void SetAudioThread( bool ) {}
+	inline bool IsAudioThread() { return false; }
+	inline void Report( EViolation, size_t = 0 ) {}
+	inline size_t GetNumViolations() { return 0; }
+	inline bool GetViolation( size_t, Violation& ) { return false; }
+	inline void PrintViolations() {}
+	inline void Reset() {}
+#endif
+
+	// Marks the calling thread as the audio thread for as long as it lives
+	class ScopedAudioThread
+	{
+	public:
+		ScopedAudioThread() { SetAudioThread( true ); }
+		~ScopedAudioThread() { SetAudioThread( false ); }
+	};
+
+	// A std::mutex that reports a violation when locked from the audio thread
+	// (the audio thread can still try_lock it, and carry on if it's taken)
+	class Mutex
+	{
+		std::mutex m_Mutex;
+	public:
+		void lock()
+		{
+			Report( EViolation::Lock );
+			m_Mutex.lock();
+		}
+		bool try_lock()
+		{
+			return m_Mutex.try_lock();
+		}
+		void unlock()
+		{
+			m_Mutex.unlock();
+		}
+	};
+}
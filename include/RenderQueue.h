@@ -0,0 +1,88 @@
+#pragma once
+
+#include "GL_Includes.h"
+#include "StreamBuffer.h"
+
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <vector>
+#include <map>
+#include <string>
+#include <tuple>
+#include <stdint.h>
+
+// Collects draw packets over a frame, sorts them by shader and VAO,
+// then by mesh, and submits them with as few
+// GL calls as possible. Consecutive packets that draw the same indices
+// with the same shader and VAO become a single instanced draw, and
+// binds that wouldn't change anything are skipped.
+class RenderQueue
+{
+public:
+	// Per instance data, read by the shader as instanced attributes
+	struct InstanceData
+	{
+		mat4 m4PMV;
+		vec4 v4Color;
+	};
+
+	// Everything needed to draw one instance of something
+	struct DrawPacket
+	{
+		uint64_t uKey;						// Sort key, see MakeKey
+		uint32_t uMesh;						// Mesh arena handle, sorted on within a key
+		GLuint Program;						// The shader program
+		GLint hInstPMV;						// Program's per instance PMV attribute (4 slots)
+		GLint hInstColor;					// Program's per instance color attribute
+		GLuint VAO;							// Vertex array
+		GLenum eIdxType;					// GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
+		GLuint nIdx;						// Number of indices to draw
+		GLuint uIdxOffset;					// Byte offset of the first index
+		GLint iBaseVertex;					// Added to every index
+		InstanceData instance;				// This instance's data
+	};
+
+	// Counters for the last flushed frame
+	struct Stats
+	{
+		int nPackets{ 0 };					// Packets submitted
+		int nDraws{ 0 };					// Draw calls issued
+		int nBinds{ 0 };					// Program, VAO and buffer binds issued
+		int nBindsSkipped{ 0 };				// Binds skipped because nothing would change
+		int nStateChanges{ 0 };				// Vertex attribute pointer / divisor changes
+	};
+
+	RenderQueue();
+
+	// Create GL resources (call once a context exists) and free them
+	bool Init();
+	void Destroy();
+
+	// Pack shader and VAO into a key (packets with equal keys are then sorted by mesh)
+	static uint64_t MakeKey( GLuint Program, GLuint VAO );
+
+	// Add a packet to this frame (equal keys draw in submission order)
+	void Submit( const DrawPacket& packet );
+
+	// Sort and draw everything submitted, then clear
+	void Flush();
+
+	const Stats& GetStats() const;
+	std::map<std::string, int> GetStatsMap() const;
+
+private:
+	std::vector<DrawPacket> m_vPackets;					// This frame's packets
+	std::vector<std::tuple<uint64_t, uint32_t, uint32_t>> m_vOrder;	// (key, mesh, packet index), sorted on flush
+	StreamBuffer m_InstanceStream;						// Ring buffer holding every instance in a frame
+	Stats m_Stats;										// Stats for the last flushed frame
+
+	// Currently bound state, so redundant binds can be skipped
+	GLuint m_CurProgram;
+	GLuint m_CurVAO;
+	GLuint m_CurArrayBuffer;
+
+	void bindProgram( GLuint Program );
+	void bindVAO( GLuint VAO );
+	void bindArrayBuffer( GLuint Buffer );
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "GL_Includes.h"
+#include "RenderQueue.h"
+#include "Animator.h"
+
+#include <SDL.h>
+
+#include <vector>
+#include <list>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+// Everything the GL side needs to draw a frame, recorded on the main
+// thread. Packets carry their baked PMV matrices and mesh ranges, and
+// skinned draws come with a copy of the palettes, so nothing in here
+// points at scene state the main thread goes on to change.
+struct FrameCommands
+{
+	// A skinned draw; the packet's instance data become uniforms
+	struct SkinnedDraw
+	{
+		RenderQueue::DrawPacket packet;
+		mat4 m4Dequant;
+	};
+
+	std::vector<RenderQueue::DrawPacket> vPackets;			// Everything that isn't skinned
+	std::vector<SkinnedDraw> vSkinned;
+	std::vector<Animator::PaletteRange> vPaletteRanges;	// One per skinned draw, into vPalettes
+	std::vector<float> vPalettes;							// The animator's palettes as of recording
+
+	// A visualizer's line strips; the spectrum's vertices follow the waveform's
+	struct VisualizerDraw
+	{
+		mat4 m4PMV;
+		vec4 v4WaveColor, v4SpectrumColor;
+		uint32_t uFirstVert;					// Into vVisualizerVerts
+		uint32_t uNumWaveVerts, uNumSpectrumVerts;
+	};
+	std::vector<VisualizerDraw> vVisualizers;
+	std::vector<float> vVisualizerVerts;					// 3 floats per vertex
+
+	void Clear();
+};
+
+// Owns the GL context on a thread of its own. The main thread records a
+// frame's FrameCommands and submits them, then goes on to the next frame
+// (events, scripts, recording) while the render thread draws and blocks
+// on vsync. There's a pending frame and an executing frame, so Submit only
+// waits if the main thread gets a whole frame ahead. Anything else that
+// needs GL (uploads, mostly) goes through RunSync.
+class RenderThread
+{
+public:
+	// Draws a frame and presents it; called on the render thread
+	using ExecuteFn = std::function<void( FrameCommands& )>;
+
+	RenderThread();
+	~RenderThread();
+
+	// Move glContext (current on the calling thread) over to a new render
+	// thread, which calls fnExecute for every submitted frame
+	bool Start( SDL_Window * pWindow, SDL_GLContext glContext, ExecuteFn fnExecute );
+
+	// Draw whatever's pending, then hand the context back to the calling thread
+	void Stop();
+	bool IsRunning() const;
+
+	// Hand a recorded frame over; cmds comes back cleared, ready for the next one
+	void Submit( FrameCommands& cmds );
+
+	// Run fn with the GL context current and wait for it: on the render thread
+	// (after the pending frame) if one is running, otherwise right here
+	static void RunSync( std::function<void()> fn );
+
+	// Times Submit had to wait for the render thread, and tasks run with RunSync
+	size_t GetNumWaits() const;
+	size_t GetNumTasks() const;
+
+private:
+	// Something RunSync is waiting on
+	struct Task
+	{
+		std::function<void()> fn;
+		bool bDone;
+	};
+
+	SDL_Window * m_pWindow;
+	SDL_GLContext m_GLContext;
+	ExecuteFn m_fnExecute;
+
+	mutable std::mutex m_muRender;			// Protects everything below
+	std::condition_variable m_cvRender;		// Signaled when the render thread has something to do
+	std::condition_variable m_cvMain;		// Signaled when a frame is picked up or a task is done
+	bool m_bQuit;							// Set when the render thread should exit
+	int m_iStartResult;						// 0 while starting, then 1 if the context was made current, -1 if not
+	bool m_bHasPending;						// Whether m_Pending holds a frame to draw
+	FrameCommands m_Pending;				// The last submitted frame
+	FrameCommands m_Executing;				// The frame being drawn (render thread only)
+	std::list<Task *> m_liTasks;			// RunSync tasks, in order
+	size_t m_uNumWaits;
+	size_t m_uNumTasks;
+	std::thread m_thRender;
+
+	// The running render thread, for RunSync
+	static RenderThread * s_pRunning;
+
+	// The render thread's function
+	void renderThread();
+};
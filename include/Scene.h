@@ -4,9 +4,18 @@
 #include "Shader.h"
 #include "SoundManager.h"
 #include "Drawable.h"
+#include "RenderQueue.h"
+#include "MeshLoader.h"
+#include "Animator.h"
+#include "RenderThread.h"
+#include "Visualizer.h"
 
 #include <pyliason.h>
 #include <memory>
+#include <list>
+#include <map>
+#include <chrono>
+#include <mutex>
 
 class Scene
 {
@@ -15,9 +24,60 @@ class Scene
 	SoundManager m_SoundManager;
 	Camera m_Camera;
 	std::vector<Drawable> m_vDrawables;
+	TransformStore m_TransformStore;			// Drawable transforms and cached model matrices
 	SDL_GLContext m_GLContext;
 	SDL_Window * m_pWindow;
 	pyl::Object m_obDriverScript;
+
+	RenderQueue m_RenderQueue;					// Sorts and batches this frame's draws
+	GLint m_hInstPMV;							// Shader handle to the per instance PMV (a mat4, so 4 attributes)
+	GLint m_hInstColor;							// Shader handle to the per instance color
+	int m_iSlotPMV, m_iSlotColor;				// Shader slots of the uniforms used when not instancing
+	bool m_bInstanceHandlesQueried;				// Whether we've looked for the above yet
+	MeshLoader m_MeshLoader;					// Loads meshes for AddDrawableAsync
+	std::list<MeshLoader::Loaded> m_liMeshUploads;	// Loaded meshes waiting to be uploaded
+	std::map<std::string, std::vector<size_t>> m_mapPendingDrawables;	// Drawables waiting on each mesh
+	int m_nVisible;								// Drawables that passed the last frustum cull
+	int m_nCulled;								// Drawables that didn't
+	Animator m_Animator;						// Skeletons and joint palettes for skinned drawables
+	Shader m_SkinShader;						// Draws skinned drawables (see shaders/skinned.vert)
+	int m_iSkinSlotPMV, m_iSkinSlotColor, m_iSkinSlotDequant;	// Its uniforms' slots
+	bool m_bSkinHandlesQueried;					// Whether we've looked for the above yet
+	std::chrono::steady_clock::time_point m_tpLastDraw;	// For animation time steps
+	RenderThread m_RenderThread;				// Owns the GL context once started (opt in)
+	FrameCommands m_FrameCommands;				// The frame being recorded
+	mutable std::mutex m_muRenderStats;			// Protects m_mapRenderStats
+	std::map<std::string, int> m_mapRenderStats;	// The render queue's stats as of the last executed frame
+	GLint m_hPos;								// Shader handle to the vertex position
+	std::vector<Visualizer> m_vVisualizers;		// Waveform and spectrum displays
+	StreamBuffer m_VisualizerStream;			// Their vertices, rewritten every frame
+	GLuint m_VisualizerVAO;						// Reads positions from m_VisualizerStream
+	int m_iVisualizerUpdateUs;					// Time spent reading audio and running FFTs last frame
+	int m_iVisualizerUploadUs;					// Time spent streaming their vertices (GL side)
+
+	// Step animations, update and cull transforms, and record what to draw
+	void recordFrame( FrameCommands& cmds );
+
+	// Draw a recorded frame and present it (on whichever thread has the context)
+	void executeFrame( FrameCommands& cmds );
+
+	// Submit every packet to the render queue and flush it
+	void drawInstanced( const FrameCommands& cmds );
+
+	// Upload some of the meshes the loader has finished (bounded per frame)
+	void uploadLoadedMeshes();
+
+	// Draw every packet individually, setting uniforms
+	void drawIndividually( const FrameCommands& cmds );
+
+	// Draw skinned drawables with the skinning shader, one palette each
+	void drawSkinned( const FrameCommands& cmds );
+
+	// Update visualizers from the audio output and record their vertices
+	void recordVisualizers( FrameCommands& cmds, const mat4& P );
+
+	// Stream visualizer vertices and draw them as line strips
+	void drawVisualizers( const FrameCommands& cmds );
 public:
 	Scene( pyl::Object obInitScript );
 	~Scene();
@@ -29,13 +89,41 @@ public:
 	bool GetQuitFlag() const;
 
 	Shader * GetShaderPtr() const;
+	Shader * GetSkinShaderPtr() const;
 	Camera * GetCameraPtr() const;
 	const SoundManager * GetSoundManagerPtr() const;
 	Drawable * GetDrawable( size_t drIdx ) const;
 
+	// Counters from the last frame's cull and render queue flush
+	std::map<std::string, int> GetRenderStats() const;
+
 	bool InitDisplay( int glMajor, int glMinor, int iScreenW, int iScreenH, vec4 v4ClearColor );
 	bool AddDrawable( std::string strIqmFile, vec2 T, vec2 S, vec4 C );
 
+	// Returns the new drawable's index right away (or -1); the mesh is
+	// loaded in the background and the drawable shows up once it's uploaded
+	int AddDrawableAsync( std::string strIqmFile, vec2 T, vec2 S, vec4 C );
+	bool IsDrawableResident( size_t drIdx ) const;
+
+	// Add a drawable skinned by the skeleton in its IQM file (loaded right
+	// away); returns its index or -1. It holds its bind pose until played
+	int AddAnimatedDrawable( std::string strIqmFile, vec2 T, vec2 S, vec4 C );
+
+	// Start a named animation on a skinned drawable, crossfading over fFadeTime seconds
+	bool PlayAnimation( size_t drIdx, std::string strAnim, float fFadeTime );
+	bool SetAnimationSpeed( size_t drIdx, float fSpeed );
+
+	// Add a display of the master output's waveform (top half) and spectrum
+	// (bottom half) filling a square of half size S at T; returns its index
+	int AddVisualizer( vec2 T, vec2 S, vec4 v4WaveColor, vec4 v4SpectrumColor );
+
+	// Draw on a thread of our own from now on, so scripts and vsync overlap
+	// (call once every shader is compiled; GL work after this goes through
+	// RenderThread::RunSync). Stop brings the context back to this thread
+	bool StartRenderThread();
+	void StopRenderThread();
+	bool IsRenderThreadRunning() const;
+
 	static void pylExpose();
 
 	// PYL stuff
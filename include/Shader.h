@@ -6,11 +6,24 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <vector>
+#include <stdint.h>
 
+// Linked programs can be kept in a binary cache (see SetBinaryCacheDir),
+// keyed by a hash of the sources and checked against the driver they
+// were made with, so later runs skip compiling. A binary the driver
+// won't take just means we compile like we would have anyway.
 class Shader
 {
-	// Private initializer
-	//int compileAndLink();
+	// Compile and link the sources, asking for a retrievable binary if bRetrievable
+	int compileAndLink( bool bRetrievable );
+
+	// Create the program from / write it to a cache file
+	bool loadBinary( const std::string strCacheFile, uint64_t uSrcHash, uint64_t uDriverHash );
+	bool saveBinary( const std::string strCacheFile, uint64_t uSrcHash, uint64_t uDriverHash ) const;
+
+	// Look up every active attribute and uniform, giving each a slot
+	void reflect();
 
 	// private constructor
 	Shader( std::string vSrc, std::string fSrc );
@@ -24,6 +37,18 @@ public:
 	bool SetSrcFiles( std::string vSrcFile, std::string fSrcFile );
 	int CompileAndLink();
 
+	// How the last CompileAndLink went
+	bool WasLoadedFromCache() const;
+	float GetLinkTime() const;			// Milliseconds
+
+	// Where program binaries are cached (empty, the default, disables the cache)
+	static void SetBinaryCacheDir( std::string strDir );
+
+	// Totals over every CompileAndLink
+	static int GetBinaryCacheHits();
+	static int GetBinaryCacheMisses();
+	static float GetTotalLinkTime();	// Milliseconds
+
 	~Shader();
 
 	void PrintHandles();
@@ -43,6 +68,24 @@ public:
 	// Public Accessors
 	GLint GetHandle( const std::string idx );
 	GLint operator[]( const std::string idx );
+	GLuint GetProgram() const;
+
+	// Every active attribute and uniform (outside of uniform blocks) is
+	// given a slot when the program is linked. Look slots up once, by
+	// name, and then use them with the setters below; -1 if inactive
+	int GetSlot( const std::string strName ) const;
+	int GetNumSlots() const;
+	GLint GetSlotLocation( int iSlot ) const;
+
+	// Set a uniform by slot (the shader must be bound); false if the
+	// slot isn't a uniform. Arrays set nCount elements from the first
+	bool SetUniform( int iSlot, int iVal );
+	bool SetUniform( int iSlot, float fVal );
+	bool SetUniform( int iSlot, const vec2& v2Val );
+	bool SetUniform( int iSlot, const vec3& v3Val );
+	bool SetUniform( int iSlot, const vec4& v4Val );
+	bool SetUniform( int iSlot, const mat4& m4Val );
+	bool SetUniform( int iSlot, const mat4 * pm4Vals, GLsizei nCount );
 
 private:
 	// Bound status, program/shaders, source, handles
@@ -51,10 +94,32 @@ private:
 	GLuint m_hVertShader;
 	GLuint m_hFragShader;
 	std::string m_VertShaderSrc, m_FragShaderSrc;
+	bool m_bFromCache;
+	float m_fLinkTime;
+
+	static std::string s_strBinaryCacheDir;
+	static int s_nBinaryCacheHits;
+	static int s_nBinaryCacheMisses;
+	static float s_fTotalLinkTime;
 
 	using HandleMap = std::map<std::string, GLint>;
 	HandleMap m_Handles;
 
+	// An active attribute or uniform, found by reflect
+	struct Variable
+	{
+		std::string strName;			// Without any trailing [0]
+		GLint iLocation;
+		GLenum eType;					// GL_FLOAT_VEC4, etc.
+		GLint nSize;					// Array length (1 if not an array)
+		bool bUniform;
+	};
+	std::vector<Variable> m_vVariables;	// Indexed by slot
+	std::map<std::string, int> m_mapSlots;
+
+	// The uniform at iSlot, or null
+	const Variable * getUniform( int iSlot ) const;
+
 	// Public scoped bind class
 	// binds shader for as long as it lives
 public:
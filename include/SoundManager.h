@@ -5,9 +5,17 @@
 
 #include <pyliason.h>
 
+#include "RTCheck.h"
+#include "AudioLog.h"
+#include "AudioClock.h"
+#include "AudioTap.h"
+#include "ClipLoader.h"
+
 #include <string>
 #include <map>
+#include <set>
 #include <list>
+#include <vector>
 #include <mutex>
 #include <stdint.h>
 
@@ -29,11 +37,15 @@ public:
 		Stop,
 		StopLoop,
 		OneShot,
+		EnableMixCache,
+		EvictClip,
 		////////////////////////////
 		// These commands are sent from the audio thread
 		BufCompleted
 	};
 	
+	struct MixCache;
+
 	struct Command
 	{
 		ECommandID eID{ ECommandID::None };
@@ -41,6 +53,20 @@ public:
 		int iData{ -1 };
 		float fData{ 1.f };
 		size_t uData{ 0 };
+		MixCache * pMixCache{ nullptr };
+	};
+
+	// A pre-rendered steady state mix of several looping voices. While every
+	// voice listed is steadily looping at its listed volume (and they started together)
+	// the audio thread plays this single buffer instead of mixing each voice
+	struct MixCache
+	{
+		std::string strName;					// The name given to the cache
+		std::vector<int> vVoiceIDs;				// The IDs of the voices it replaces
+		std::vector<float> vVolumes;			// and the volume each was rendered at
+		std::vector<float> vMixBuffer;			// One head length of the rendered mix
+		bool bActive{ false };					// Set by the audio thread each buffer
+		size_t uStartingPos{ 0 };				// The starting pos shared by the voices, if active
 	};
 	const int x = sizeof( Command );
 	SoundManager();
@@ -58,17 +84,47 @@ public:
 	// Play / Pause the audio device
 	bool PlayPause();
 
+	// Where audio thread log records get written during Update (empty string means stdout)
+	bool SetAudioLogFile( std::string strLogFile );
+
 	// Various gets
 	size_t GetMaxSampleCount() const;
 	size_t GetSampleRate() const;
 	size_t GetBufferSize() const;
 	size_t GetNumBufsCompleted() const;
+
+	// Playback position as of right now, interpolated from the audio thread's
+	// last callback without locking (so visuals can follow the audio closely)
+	double GetPlaybackTime() const;		// Seconds heard since playback started
+	float GetLoopPhase() const;			// How far into the loop we are, in [0, 1)
+	const AudioClock& GetAudioClock() const;
+
+	// The master output, as the device was given it (for visualizers)
+	const AudioTap& GetOutputTap() const;
+	uint32_t GetNumChannels() const;
 	size_t GetNumSamplesInClip( std::string strClipName, bool bTail ) const;
+
+	// A read-only memoryview of a resident clip's samples, shape (frames, channels), without
+	// copying (None if it isn't resident). The clip won't be evicted while any view of it is alive
+	pyl::Object GetClipSamples( std::string strClipName, bool bTail );
 	SDL_AudioSpec const * GetAudioSpecPtr() const;
 
 	// Add a clip to storage
 	bool RegisterClip( std::string strClipName, std::string strHeadFile, std::string strTailFile, size_t uFadeDurationMS );
 
+	// Render a steady state mix of clips (clip name, voice ID, volume) and hand it to the audio thread.
+	// Every clip must have the same head length; returns false if they don't or a clip is missing
+	using MixCacheEntry = std::tuple<std::string, int, float>;
+	bool CacheMix( std::string strMixName, std::list<MixCacheEntry> liEntries );
+
+	// Clip residency. Clips named in the reachable set are kept (or made) resident,
+	// loading in the background if needed. While we're over the memory budget
+	// any other clip may be evicted once no voice is using it. A budget of 0 means no limit
+	void SetClipMemoryBudget( size_t uNumBytes );
+	void SetReachableClips( std::set<std::string> setClipNames );
+	bool IsClipResident( std::string strClipName ) const;
+	size_t GetResidentClipBytes() const;
+
 	// SDL Audio callback
 	static void FillAudio( void * pUserData, Uint8 * pStream, int nSamplesDesired );
 
@@ -89,22 +145,56 @@ private:
 	size_t m_uNumBufsCompleted;             // The number of buffers filled by the audio thread
 	SDL_AudioSpec m_AudioSpec;				// Audio spec, describes loop format
 
-	std::mutex m_muAudioMutex;				// Mutex controlling communication between audio and main threads
+	RTCheck::Mutex m_muAudioMutex;			// Mutex controlling communication between audio and main threads
 	size_t m_uSamplePos;					// Current sample pos in playback
 	std::list<Command> m_liPublicCmdQueue;	// Anyone can put tasks here, will be read by audio thread
 	std::list<Command> m_liAudioCmdQueue;	// Audio thread's tasks, only modified by audio thread
+	std::list<Command> m_liDeferredCmds;	// Audio thread's commands waiting on a clip to load (and any after them for the same voice)
+	std::list<Command> m_liHandledCmds;		// Audio thread's finished commands, handed back on the next lock
+	std::list<Command> m_liRetiredCmds;		// Finished commands for the main thread to free
+	size_t m_uBufsUncounted;				// Buffers the audio thread hasn't been able to report yet
 	std::map<std::string, Clip> m_mapClips;	// Clip storage, right now the map is a convenience
-	std::list<Voice> m_liVoices;
+	std::map<std::string, ClipLoader::Source> m_mapClipSources;	// Where each clip was loaded from
+	std::set<std::string> m_setReachableClips;	// Clips that should be resident
+	size_t m_uClipMemoryBudget;				// Max bytes of resident clip data (0 is unlimited)
+	ClipLoader m_ClipLoader;				// Loads clips in the background
+	std::list<Voice> m_liVoices;			// Voices the audio thread is playing
+	std::list<Voice> m_liFreeVoices;		// The rest of the audio thread's voices, ready to be started
+	AudioLog m_AudioLog;					// Written to by the audio thread, drained by the main thread
+	AudioClock m_AudioClock;				// Published by the audio thread, read by anyone
+	uint64_t m_uSamplesRendered;			// Total samples rendered (audio thread only)
+	AudioTap m_OutputTap;					// Every buffer we fill is copied here
+	FILE * m_pAudioLogFile;					// Where the audio log is drained to
+	std::list<MixCache> m_liMixCaches;		// Mix cache storage, owned by the main thread
+	std::vector<MixCache *> m_vAudioMixCaches;	// Mix caches the audio thread knows about (capacity reserved)
 
 	// The actual callback function used to fill audio buffers
 	void fill_audio_impl( Uint8 * pStream, int nBytesToFill );
 
+	// Make everything the audio thread will need, so it never has to allocate
+	void reserveAudioStorage();
+
 	// Called by audio thread to get messages from main thread
 	void updateTaskQueue();
 
+	// Called by audio thread to play a voice (false if every voice is in use)
+	bool startVoice( const Voice& v );
+
+	// Called by the audio thread to see which mix caches can be used this buffer
+	void updateMixCaches();
+
+	// Whether or not a voice is being rendered by an active mix cache
+	bool isVoiceMixCached( const Voice& v ) const;
+
 	// Called from Update to find out if we've filled some buffers
 	void incNumBufsCompleted();
 
+	// Called from Update to load, free and evict clips
+	void updateClipResidency();
+
+	// Start loading any reachable clips that aren't resident
+	void requestReachableClips();
+
 	// Turn a message into something useful
 	Command translateMessage( Message& M );
 };
\ No newline at end of file
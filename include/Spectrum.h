@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+// The magnitude spectrum of a window of samples. Samples are Hann windowed
+// and run through a radix-2 FFT kept as separate real and imaginary arrays,
+// so every stage past the first two does four butterflies at a time with
+// SSE if we have it. Twiddle factors and the bit reversal are computed once.
+class Spectrum
+{
+public:
+	Spectrum();
+
+	// Set up for windows of uSize samples (a power of 2, at least 4)
+	bool Init( uint32_t uSize );
+	uint32_t GetSize() const;
+
+	// Transform GetSize() samples and write GetSize() / 2 magnitudes to pOut,
+	// in decibels relative to a full scale sine, mapped from [fFloorDB, 0] to [0, 1]
+	void Compute( const float * pSamples, float * pOut, float fFloorDB = -80.f );
+
+private:
+	uint32_t m_uSize;
+	std::vector<float> m_vWindow;			// Hann window
+	std::vector<uint32_t> m_vBitReverse;	// Where each sample goes before the first stage
+	std::vector<float> m_vTwiddleRe;		// Each stage's twiddles, one after the other
+	std::vector<float> m_vTwiddleIm;
+	std::vector<float> m_vRe, m_vIm;		// Scratch space
+
+	// Run the butterflies (on m_vRe and m_vIm, already bit reversed)
+	void transform();
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "GL_Includes.h"
+
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+// A GL buffer split into one region per in-flight frame, written by the
+// CPU once per frame. If ARB_buffer_storage is available the buffer is
+// persistently mapped; otherwise writes are staged and uploaded with
+// glBufferSubData. Each region is fenced when the frame is submitted, and
+// we only wait on a fence when we come back around to that region
+class StreamBuffer
+{
+public:
+	StreamBuffer();
+	~StreamBuffer();
+
+	// Create the buffer, with room for uBytesPerFrame in each of uNumFrames regions
+	bool Init( GLenum target, size_t uBytesPerFrame, size_t uNumFrames = 3 );
+
+	// Free the buffer (waits for nothing, GL keeps it alive while in use)
+	void Destroy();
+
+	// Make sure a frame can hold uBytes (recreates the buffer if it can't)
+	bool Reserve( size_t uBytes );
+
+	// Start writing the next region; returns a pointer to it (null if not initialized)
+	void * BeginFrame();
+
+	// Done writing uBytesWritten to the current region; uploads it if needed
+	void EndWrite( size_t uBytesWritten );
+
+	// Call once every draw reading the current region is issued; fences it and moves on
+	void EndFrame();
+
+	// The offset of the current region within the buffer
+	size_t GetFrameOffset() const;
+
+	GLuint GetBuffer() const;
+	bool IsPersistent() const;
+
+	// How many times BeginFrame had to wait on the GPU
+	size_t GetNumStalls() const;
+
+private:
+	GLuint m_Buffer;						// The GL buffer
+	GLenum m_Target;						// What it gets bound to
+	size_t m_uFrameSize;					// Bytes per region
+	size_t m_uNumFrames;					// Number of regions
+	size_t m_uFrameIdx;						// The region currently being written
+	bool m_bPersistent;						// Whether m_pMapped points at GPU memory
+	uint8_t * m_pMapped;					// Start of the mapping (or staging buffer)
+	std::vector<GLsync> m_vFences;			// One fence per region
+	std::vector<uint8_t> m_vStaging;		// Used when we can't map persistently
+	size_t m_uNumStalls;					// Number of times we had to wait
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "GL_Includes.h"
+#include "quatvec.h"
+
+#include <glm/vec2.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <array>
+#include <vector>
+#include <stdint.h>
+
+// Holds drawable transforms struct-of-arrays style, along with
+// their model matrices and world space bounding boxes. Setters mark
+// a transform dirty, and dirty matrices and bounds are rebuilt four
+// at a time (with SSE if we have it) either in Update or the first
+// time a matrix is asked for
+class TransformStore
+{
+public:
+	TransformStore();
+
+	// Add a transform, returns its index
+	uint32_t Add( const quatvec& qv, vec2 v2Scale );
+	size_t Size() const;
+	void Clear();
+
+	// Setters, each marks the transform dirty
+	void SetPos( uint32_t uIdx, vec3 T );
+	void Translate( uint32_t uIdx, vec3 T );
+	void SetRot( uint32_t uIdx, fquat Q );
+	void Rotate( uint32_t uIdx, fquat Q );
+	void SetTransform( uint32_t uIdx, const quatvec& qv );
+	void Transform( uint32_t uIdx, const quatvec& qv );
+	void SetScale( uint32_t uIdx, vec2 v2Scale );
+
+	// Set the model space bounding box (also marks the transform dirty)
+	void SetLocalBounds( uint32_t uIdx, vec3 v3Min, vec3 v3Max );
+
+	// Getters
+	quatvec GetTransform( uint32_t uIdx ) const;
+	vec2 GetScale( uint32_t uIdx ) const;
+
+	// The model matrix (rebuilt if dirty)
+	const mat4& GetMat( uint32_t uIdx );
+
+	// Rebuild every dirty matrix (and world bounds)
+	void Update();
+
+	// World space bounding box, as of the last rebuild
+	void GetWorldBounds( uint32_t uIdx, vec3& v3Min, vec3& v3Max ) const;
+
+	// Test every world bounding box against the planes (each plane's
+	// xyz points inward, see Camera::GetFrustumPlanes); returns the
+	// number of visible transforms. Call Update first.
+	size_t Cull( const std::array<vec4, 6>& arPlanes );
+	bool IsVisible( uint32_t uIdx ) const;
+
+	// How many matrices were rebuilt since the last call
+	size_t TakeNumRecomputed();
+
+private:
+	size_t m_uCount;						// Number of transforms (arrays are padded to a multiple of 4)
+
+	// Translation, rotation, and scale, one array per component
+	std::vector<float> m_vPosX, m_vPosY, m_vPosZ;
+	std::vector<float> m_vQuatX, m_vQuatY, m_vQuatZ, m_vQuatW;
+	std::vector<float> m_vScaleX, m_vScaleY;
+
+	// The translation column is A * V + B * (R * V), which
+	// covers every quatvec type: TR (1, 0), RT (0, 1), TRT (1, -1)
+	std::vector<float> m_vTransA, m_vTransB;
+	std::vector<uint8_t> m_vType;			// The quatvec type, so we can hand it back
+
+	// Bounding boxes as center and half extents, in model and world space
+	std::vector<float> m_vLocalCX, m_vLocalCY, m_vLocalCZ;
+	std::vector<float> m_vLocalEX, m_vLocalEY, m_vLocalEZ;
+	std::vector<float> m_vWorldCX, m_vWorldCY, m_vWorldCZ;
+	std::vector<float> m_vWorldEX, m_vWorldEY, m_vWorldEZ;
+	std::vector<uint8_t> m_vVisible;		// Set by Cull
+
+	std::vector<uint8_t> m_vDirty;			// One flag per transform
+	std::vector<mat4> m_vMats;				// Cached model matrices
+	size_t m_uNumRecomputed;				// Counter for TakeNumRecomputed
+
+	void setType( uint32_t uIdx, quatvec::Type eType );
+	void recomputeBlock( size_t uFirst );
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "GL_Includes.h"
+#include "AudioTap.h"
+#include "Spectrum.h"
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <vector>
+#include <stdint.h>
+
+// Shows what the audio device is playing: the latest window of the master
+// output as a waveform across the top half of a [-1, 1] square, and its
+// spectrum (log spaced bars) across the bottom half. Update reads the
+// window from the output tap and runs the FFT on the main thread; the
+// vertices are rebuilt every frame and streamed to the GPU by the scene.
+class Visualizer
+{
+public:
+	// Bars in the spectrum, spread logarithmically over the FFT's bins
+	static const uint32_t kNumBars = 96;
+
+	Visualizer();
+	Visualizer( vec2 v2Pos, vec2 v2Scale, vec4 v4WaveColor, vec4 v4SpectrumColor, uint32_t uWindowSize = 1024 );
+
+	// Read the latest uWindowSize frames (downmixing uNumChannels) and transform them
+	void Update( const AudioTap& tap, uint32_t uNumChannels );
+
+	// Append line strip vertices (3 floats each); returns the number of vertices added
+	uint32_t AppendWaveform( std::vector<float>& vVerts ) const;
+	uint32_t AppendSpectrum( std::vector<float>& vVerts ) const;
+
+	mat4 GetMV() const;
+	vec4 GetWaveColor() const;
+	vec4 GetSpectrumColor() const;
+
+	void SetPos( vec2 v2Pos );
+	void SetColors( vec4 v4WaveColor, vec4 v4SpectrumColor );
+
+private:
+	vec2 m_v2Pos, m_v2Scale;
+	vec4 m_v4WaveColor, m_v4SpectrumColor;
+	Spectrum m_Spectrum;
+	std::vector<float> m_vInterleaved;		// What we read from the tap
+	std::vector<float> m_vWindow;			// Mono samples
+	std::vector<float> m_vMagnitudes;		// From the spectrum, in [0, 1]
+	std::vector<float> m_vBars;				// Smoothed bar heights
+	std::vector<uint32_t> m_vBarBins;		// The first bin of each bar (and one past the last)
+};
@@ -27,7 +27,7 @@ public:
 	};
 
     // Construct with pointer to actual audio clip, trigger res, initial volume, and loop bool
-	Voice( const Clip const * pClip, int ID, size_t uTriggerRes, float fVolume, bool bLoop = false );
+	Voice( const Clip * pClip, int ID, size_t uTriggerRes, float fVolume, bool bLoop = false );
 
     // Construct with soundmanager command
     Voice( const SoundManager::Command cmd );
@@ -40,10 +40,21 @@ public:
 	EState GetPrevState() const;
 	float GetVolume() const;
 	int GetID() const;
+	const Clip * GetClip() const;
+	size_t GetStartingPos() const;
+
+	// True if we're looping with no leftover tail, meaning our output
+	// is periodic (one head length) until our state or volume changes
+	bool IsSteadyLooping() const;
+
+	// Mix one period (the head length) of what a steady looping voice playing pClip
+	// at fVolume renders into pMixBuffer, indexed by position within the head
+	static void RenderSteadyLoop( const Clip * const pClip, const float fVolume, float * const pMixBuffer );
 
     // Set the voice to start/stop at the trigger res
+    // (SetPending returns false if the voice is already playing)
 	void SetStopping( const size_t uTriggerRes );
-    void SetPending( const size_t uTriggerRes, bool bLoop = false );
+    bool SetPending( const size_t uTriggerRes, bool bLoop = false );
 
     // Set the volume
 	void SetVolume( const float fVol );
@@ -25,6 +25,9 @@
 #include <map>
 #include <set>
 #include <array>
+#include <memory>
+#include <cstring>
+#include <algorithm>
 
 #include <Python.h>
 
@@ -118,6 +121,63 @@ namespace pyl
         }
         return true;
     }
+	// ------------ Buffer protocol ------------
+	// Anything buffer_traits describes can cross as a buffer: a memoryview, array,
+	// bytes or numpy array coming in, a memoryview going out. That's one memcpy
+	// (or none) instead of a boxed Python object per element
+
+	// The kind of a scalar in buffer terms: 'f'loat, signed 'i'nt or 'u'nsigned int
+	template<class S> constexpr char buffer_kind() {
+		return std::is_floating_point<S>::value ? 'f' : (std::is_signed<S>::value ? 'i' : 'u');
+	}
+
+	// The struct module format character for a scalar of the given kind and size
+	const char *buffer_format(char kind, size_t size);
+
+	// Get a C contiguous view of obj if its items are scalars of the given kind and size
+	// (untyped bytes are reinterpreted as such). If not, returns false with no error set
+	bool get_scalar_buffer(PyObject *obj, char kind, size_t size, Py_buffer *view);
+
+	// Copy up to N Ts out of a buffer of their scalars
+	template<class T> bool convert_buffer(PyObject *obj, T *arr, size_t N) {
+		static_assert(is_buffer_type<T>::value, "T can't be read from a buffer");
+		using S = typename buffer_traits<T>::scalar;
+		Py_buffer view;
+		if (!get_scalar_buffer(obj, buffer_kind<S>(), sizeof(S), &view))
+			return false;
+		size_t len = std::min<size_t>(size_t(view.len) / sizeof(T), N);
+		std::memcpy(arr, view.buf, len * sizeof(T));
+		PyBuffer_Release(&view);
+		return true;
+	}
+
+	// Replace the contents of vec with the Ts in a buffer of their scalars
+	template<class T> bool convert_buffer(PyObject *obj, std::vector<T> &vec) {
+		static_assert(is_buffer_type<T>::value, "T can't be read from a buffer");
+		using S = typename buffer_traits<T>::scalar;
+		Py_buffer view;
+		if (!get_scalar_buffer(obj, buffer_kind<S>(), sizeof(S), &view))
+			return false;
+		vec.resize(size_t(view.len) / sizeof(T));
+		std::memcpy(vec.data(), view.buf, vec.size() * sizeof(T));
+		PyBuffer_Release(&view);
+		return true;
+	}
+
+	// The above for types that might not be buffer types
+	template<class T> bool try_convert_buffer(PyObject *obj, T *arr, size_t N, std::true_type) {
+		return convert_buffer(obj, arr, N);
+	}
+	template<class T> bool try_convert_buffer(PyObject *obj, std::vector<T> &vec, std::true_type) {
+		return convert_buffer(obj, vec);
+	}
+	template<class T> bool try_convert_buffer(PyObject *, T *, size_t, std::false_type) {
+		return false;
+	}
+	template<class T> bool try_convert_buffer(PyObject *, std::vector<T> &, std::false_type) {
+		return false;
+	}
+
 	// Convert a PyObject to a generic container.
 	template<class T, class C>
 	bool convert_list(PyObject *obj, C &container) {
@@ -135,13 +195,17 @@ namespace pyl
 	template<class T> bool convert(PyObject *obj, std::list<T> &lst) {
 		return convert_list<T, std::list<T>>(obj, lst);
 	}
-	// Convert a PyObject to a std::vector.
+	// Convert a PyObject to a std::vector (in one copy, if it's a buffer).
 	template<class T> bool convert(PyObject *obj, std::vector<T> &vec) {
+		if (try_convert_buffer(obj, vec, is_buffer_type<T>()))
+			return true;
 		return convert_list<T, std::vector<T>>(obj, vec);
 	}
     
     // Convert a PyObject to a contiguous buffer (very unsafe, but hey)
     template<class T> bool convert_buf(PyObject *obj, T * arr, int N){
+        if (try_convert_buffer(obj, arr, size_t(N), is_buffer_type<T>()))
+            return true;
         if (!PyList_Check(obj))
             return false;
         Py_ssize_t len = PyList_Size(obj);
@@ -225,17 +289,71 @@ namespace pyl
 	// Creates a PyFloat from a float
 	PyObject *alloc_pyobject(float num);
 
+	// Returns a new reference to a pyl::Object (None if it's empty)
+	PyObject *alloc_pyobject(const pyl::Object &obj);
+
     // I guess this is kind of a catch-all for pointer types
     template <typename T>
     PyObject * alloc_pyobject(T * ptr){
         return PyCapsule_New((voidptr_t)ptr, NULL, NULL);
     }
     
-	// Creates a PyList from a std::vector
-	template<class T> PyObject *alloc_pyobject(const std::vector<T> &container) {
+	// What a memoryview we create looks at; format must outlive it (literals are fine)
+	struct BufferInfo {
+		const void *pData{ nullptr };
+		const char *format{ "B" };
+		Py_ssize_t itemsize{ 1 };
+		int ndim{ 1 };					// At most 2
+		Py_ssize_t shape[2]{ 0, 0 };
+		Py_ssize_t strides[2]{ 0, 0 };	// In bytes
+		bool readonly{ true };
+	};
+
+	// Creates a memoryview of info; keepAlive is held until the last view of it is released
+	PyObject *alloc_buffer(const BufferInfo &info, std::shared_ptr<const void> keepAlive);
+
+	// Describes N packed Ts (as N rows of scalars if T holds more than one)
+	template<class T> BufferInfo buffer_info(const T *data, size_t N, bool readonly) {
+		static_assert(is_buffer_type<T>::value, "T can't be viewed as a buffer");
+		using S = typename buffer_traits<T>::scalar;
+		BufferInfo info;
+		info.pData = data;
+		info.format = buffer_format(buffer_kind<S>(), sizeof(S));
+		info.itemsize = sizeof(S);
+		info.ndim = buffer_traits<T>::count > 1 ? 2 : 1;
+		info.shape[0] = Py_ssize_t(N);
+		info.shape[1] = Py_ssize_t(buffer_traits<T>::count);
+		info.strides[0] = sizeof(T);
+		info.strides[1] = sizeof(S);
+		info.readonly = readonly;
+		return info;
+	}
+
+	// Creates a memoryview of N Ts that stay valid for as long as keepAlive does (no copy)
+	template<class T> PyObject *alloc_buffer_view(const T *data, size_t N, std::shared_ptr<const void> keepAlive, bool readonly = true) {
+		return alloc_buffer(buffer_info(data, N, readonly), std::move(keepAlive));
+	}
+
+	// Creates a writable memoryview of a copy of N Ts (one allocation, one memcpy)
+	template<class T> PyObject *alloc_buffer_copy(const T *data, size_t N) {
+		std::shared_ptr<char> spCopy(new char[N * sizeof(T) + 1], std::default_delete<char[]>());
+		std::memcpy(spCopy.get(), data, N * sizeof(T));
+		return alloc_buffer(buffer_info((const T *)spCopy.get(), N, false), spCopy);
+	}
+
+	// Vectors of buffer types become memoryviews, anything else a list
+	template<class T> PyObject *alloc_vector(const std::vector<T> &container, std::true_type) {
+		return alloc_buffer_copy(container.data(), container.size());
+	}
+	template<class T> PyObject *alloc_vector(const std::vector<T> &container, std::false_type) {
 		return alloc_list(container);
 	}
 
+	// Creates a memoryview or PyList from a std::vector
+	template<class T> PyObject *alloc_pyobject(const std::vector<T> &container) {
+		return alloc_vector(container, is_buffer_type<T>());
+	}
+
 	// Creates a PyList from a std::list
 	template<class T> PyObject *alloc_pyobject(const std::list<T> &container) {
 		return alloc_list(container);
@@ -39,106 +39,130 @@ namespace pyl
 	}
 
 
-	template <typename R, typename ... Args>
-	PyFunc __getPyFunc_Case1(std::function<R(Args...)> fn) {
-		PyFunc pFn = [fn](PyObject * s, PyObject * a)
-		{
-			std::tuple<Args...> tup;
-			convert(a, tup);
-			R rVal = invoke(fn, tup);
-
-			return alloc_pyobject(rVal);
-		};
-		return pFn;
+	// Python 3.7 made METH_FASTCALL public; before that we take a tuple
+#if PY_VERSION_HEX >= 0x03070000
+#define PYL_FASTCALL
+#endif
+
+	// Every entry point looks like this
+	using PyFastFunc = PyObject *(*)(PyObject *, PyObject * const *, Py_ssize_t);
+
+	// Raise a TypeError unless we got exactly as many arguments as there are parameters
+	inline bool __check_nargs(Py_ssize_t nargs, size_t expected) {
+		if (nargs == (Py_ssize_t)expected)
+			return true;
+		PyErr_Format(PyExc_TypeError, "expected %d arguments, got %d", (int)expected, (int)nargs);
+		return false;
 	}
 
-	template <typename ... Args>
-	PyFunc __getPyFunc_Case2(std::function<void(Args...)> fn) {
-		PyFunc pFn = [fn](PyObject * s, PyObject * a)
-		{
-			std::tuple<Args...> tup;
-			convert(a, tup);
-			invoke(fn, tup);
-
-			Py_INCREF(Py_None);
-			return Py_None;
-		};
-		return pFn;
+	// Convert each argument straight into its slot in the tuple (a failed
+	// conversion leaves the default value, like the tuple path always has)
+	template <typename Tup, std::size_t... index>
+	void __convert_args(PyObject * const * args, Tup& tup, std::index_sequence<index...>) {
+		using expand = int[];
+		(void)expand{ 0, ((void)convert(args[index], std::get<index>(tup)), 0)... };
 	}
 
+	// Box a call's result (None for void)
 	template <typename R>
-	PyFunc __getPyFunc_Case3(std::function<R()> fn) {
-		PyFunc pFn = [fn](PyObject * s, PyObject * a)
-		{
-			R rVal = fn();
-			return alloc_pyobject(rVal);
-		};
-		return pFn;
-	}
-
-	PyFunc __getPyFunc_Case4(std::function<void()> fn);
-
-
-	template <typename C, typename R, typename ... Args>
-	PyFunc __getPyFunc_Mem_Case1(std::function<R(Args...)> fn) {
-		PyFunc pFn = [fn](PyObject * s, PyObject * a) {
-			// the first arg is the instance pointer, contained in s
-			std::tuple<Args...> tup;
-			std::get<0>(tup) = __getCapsulePtr<C>(s);
-
-			// recurse till the first element, getting args from a
-			add_to_tuple<sizeof...(Args)-1, 1, Args...>(a, tup);
-
-			// Invoke function, get retVal	
-			R rVal = invoke(fn, tup);
-
-			// convert rVal to PyObject, return
-			return alloc_pyobject(rVal);
-		};
-		return pFn;
-	}
-
-	template <typename C, typename ... Args>
-	PyFunc __getPyFunc_Mem_Case2(std::function<void(Args...)> fn) {
-		PyFunc pFn = [fn](PyObject * s, PyObject * a) {
-			// the first arg is the instance pointer, contained in s
-			std::tuple<Args...> tup;
-			std::get<0>(tup) = __getCapsulePtr<C>(s);
-
-			// recurse till the first element, getting args from a
-			add_to_tuple<sizeof...(Args)-1, 1, Args...>(a, tup);
-
-			// invoke function
-			invoke(fn, tup);
-
-			// Return None
+	struct __box_result {
+		template <typename Call>
+		static PyObject * box(Call&& call) {
+			return alloc_pyobject(call());
+		}
+	};
+	template <>
+	struct __box_result<void> {
+		template <typename Call>
+		static PyObject * box(Call&& call) {
+			call();
 			Py_INCREF(Py_None);
 			return Py_None;
-		};
-		return pFn;
+		}
+	};
+
+	// The entry point for a function pointer fn of type Fn. Because fn is a template
+	// argument the thunk is an ordinary static function that calls it directly,
+	// so nothing has to be stored and the compiler can inline straight through
+	template <typename Fn, Fn fn>
+	struct __thunk;
+
+	// Free (or static member) functions
+	template <typename R, typename ... Args, R(*fn)(Args...)>
+	struct __thunk<R(*)(Args...), fn> {
+		template <std::size_t... index>
+		static PyObject * call(PyObject * const * args, std::index_sequence<index...> seq) {
+			std::tuple<typename std::decay<Args>::type...> tup;
+			__convert_args(args, tup, seq);
+			return __box_result<R>::box([&tup]() -> R {
+				return fn(std::get<index>(tup)...);
+			});
+		}
+
+		static PyObject * entry(PyObject * s, PyObject * const * args, Py_ssize_t nargs) {
+			if (!__check_nargs(nargs, sizeof...(Args)))
+				return nullptr;
+			return call(args, std::index_sequence_for<Args...>());
+		}
+	};
+
+	// Member functions of C; the instance pointer is in s
+	template <typename C, typename R, typename ... Args, R(C::*fn)(Args...)>
+	struct __thunk<R(C::*)(Args...), fn> {
+		using Class = C;
+
+		template <std::size_t... index>
+		static PyObject * call(C * pInst, PyObject * const * args, std::index_sequence<index...> seq) {
+			std::tuple<typename std::decay<Args>::type...> tup;
+			__convert_args(args, tup, seq);
+			return __box_result<R>::box([pInst, &tup]() -> R {
+				return (pInst->*fn)(std::get<index>(tup)...);
+			});
+		}
+
+		static PyObject * entry(PyObject * s, PyObject * const * args, Py_ssize_t nargs) {
+			if (!__check_nargs(nargs, sizeof...(Args)))
+				return nullptr;
+			return call(__getCapsulePtr<C>(s), args, std::index_sequence_for<Args...>());
+		}
+	};
+
+	// Const member functions, same as above
+	template <typename C, typename R, typename ... Args, R(C::*fn)(Args...) const>
+	struct __thunk<R(C::*)(Args...) const, fn> {
+		using Class = C;
+
+		template <std::size_t... index>
+		static PyObject * call(const C * pInst, PyObject * const * args, std::index_sequence<index...> seq) {
+			std::tuple<typename std::decay<Args>::type...> tup;
+			__convert_args(args, tup, seq);
+			return __box_result<R>::box([pInst, &tup]() -> R {
+				return (pInst->*fn)(std::get<index>(tup)...);
+			});
+		}
+
+		static PyObject * entry(PyObject * s, PyObject * const * args, Py_ssize_t nargs) {
+			if (!__check_nargs(nargs, sizeof...(Args)))
+				return nullptr;
+			return call(__getCapsulePtr<C>(s), args, std::index_sequence_for<Args...>());
+		}
+	};
+
+	// Without METH_FASTCALL, hand the tuple's items to the same entry point
+	template <PyFastFunc fastFn>
+	PyObject * __varargs_adapter(PyObject * s, PyObject * a) {
+		return fastFn(s, &PyTuple_GET_ITEM(a, 0), PyTuple_GET_SIZE(a));
 	}
 
-	template <typename C, typename R>
-	PyFunc __getPyFunc_Mem_Case3(std::function<R(C *)> fn) {
-		PyFunc pFn = [fn](PyObject * s, PyObject * a) {
-			// Nothing special here
-			R rVal = fn(__getCapsulePtr<C>(s));
-
-			return alloc_pyobject(rVal);
-		};
-		return pFn;
+	// The PyCFunction and flags to put in a method def for an entry point
+	template <PyFastFunc fastFn>
+	PyCFunction __get_method(int& flags) {
+#ifdef PYL_FASTCALL
+		flags = METH_FASTCALL;
+		return (PyCFunction)(void(*)(void))fastFn;
+#else
+		flags = METH_VARARGS;
+		return __varargs_adapter<fastFn>;
+#endif
 	}
-
-	template<typename C>
-	PyFunc __getPyFunc_Mem_Case4(std::function<void(C *)> fn) {
-		PyFunc pFn = [fn](PyObject * s, PyObject * a) {
-			// Nothing special here
-			fn(__getCapsulePtr<C>(s));
-
-			Py_INCREF(Py_None);
-			return Py_None;
-		};
-		return pFn;
-	}
-
 }
\ No newline at end of file
@@ -23,6 +23,7 @@
 #include <functional>
 #include <string>
 #include <utility>
+#include <type_traits>
 namespace pyl
 {
     // This feels gross
@@ -112,5 +113,23 @@ namespace pyl
 	// TODO
 	//rewrite the above for class member functions
 
+	// How a type is laid out as a buffer: count packed scalars of type scalar.
+	// Types that can't cross as a buffer have a count of 0
+	template<typename T, typename Enable = void>
+	struct buffer_traits {
+		using scalar = void;
+		enum : size_t { count = 0 };
+	};
+
+	// Numbers are one scalar (bool isn't, the buffer protocol has its own idea of it)
+	template<typename T>
+	struct buffer_traits<T, typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>::type> {
+		using scalar = T;
+		enum : size_t { count = 1 };
+	};
+
+	template<typename T>
+	using is_buffer_type = std::integral_constant<bool, buffer_traits<T>::count != 0>;
+
 	int GetTotalRefCount();
 }
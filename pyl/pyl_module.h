@@ -55,7 +55,6 @@ namespace pyl
 		// Private members
 	private:
 		std::map<std::type_index, ExposedClass> m_mapExposedClasses;	/*!< A map of exposable C++ class types */
-		std::list<PyFunc> m_liExposedFunctions;							/*!< A list of exposed c++ functions */
 		MethodDefinitions m_vMethodDef;									/*!< A null terminated MethodDef buffer */
 		PyModuleDef m_pyModDef;											/*!< The actual Python module def */
 		std::string m_strModDocs;										/*!< The string containing module docs */
@@ -65,35 +64,14 @@ namespace pyl
 
 	// These are internal functions used by the expose APIs that create functions
 	private:
-		// Add a new method def fo the Method Definitions of the module
-		template <typename tag>
-		void addFunction( const PyFunc pFn, const std::string methodName, const int methodFlags, const std::string docs )
-		{
-			// We need to store these where they won't move
-			m_liExposedFunctions.push_back( pFn );
-
-			// now make the function pointer (TODO figure out these ids, or do something else)
-			PyCFunction fnPtr = get_fn_ptr<tag>( m_liExposedFunctions.back() );
-
-			// You can key the methodName string to a std::function
-			m_vMethodDef.AddMethod( methodName, fnPtr, methodFlags, docs );
-		}
-
-		// Like the above but for member functions of exposed C++ clases
-		template <typename tag, class C>
-		void addMemFunction( const std::string methodName, const PyFunc pFn, const int methodFlags, const std::string docs )
+		// Add a method def for a member function of an exposed class
+		template <class C>
+		void addMemMethod( const std::string methodName, PyCFunction fnPtr, const int methodFlags, const std::string docs )
 		{
 			auto it = m_mapExposedClasses.find( typeid(C) );
 			if ( it == m_mapExposedClasses.end() )
 				return;
 
-			// We need to store these where they won't move
-			m_liExposedFunctions.push_back( pFn );
-
-			// now make the function pointer (TODO figure out these ids, or do something else)
-			PyCFunction fnPtr = get_fn_ptr<tag>( m_liExposedFunctions.back() );
-
-			// Add function
 			it->second.AddMemberFn( methodName, fnPtr, methodFlags, docs );
 		}
 
@@ -125,186 +103,57 @@ namespace pyl
 		/*! RegisterFunction
 		\brief Register some R methodName(Args...)
 
-		\tparam tag An undefined type used internally
-		\tparam R The return type
-		\tparam Args The variadic type containing all function arguments
+		\tparam Fn The type of the function pointer, i.e R(*)(Args...)
+		\tparam fn The function pointer itself
 
 		\param[in] methodName The name of the function as seen by Python
-		\param[in] fn A std::function object wrapping the function
 		\param[in] docs The optional documentation for the function, as seen by Python
 
-		Use this function to register some non-member function that would be invoked like
+		Use this function to register some non-member (or static member) function that would be invoked like
 		R returnedVal = methodName(Args...);
-		*/
-		template <typename tag, typename R, typename ... Args>
-		void RegisterFunction( std::string methodName, std::function<R( Args... )> fn, std::string docs = "" )
-		{
-			PyFunc pFn = __getPyFunc_Case1( fn );
-
-			addFunction<tag>( pFn, methodName, METH_VARARGS, docs );
-		}
-
-		/*! RegisterFunction
-		\brief Register some void methodName(Args...)
-
-		\tparam tag An undefined type used internally
-		\tparam Args The variadic type containing all function arguments
+		The PYL_FN macro spells out both template arguments, i.e RegisterFunction<PYL_FN( Foo )>( "Foo" )
 
-		\param[in] methodName The name of the function as seen by Python
-		\param[in] fn A std::function object wrapping the function
-		\param[in] docs The optional documentation for the function, as seen by Python
-
-		Use this function to register some void non-member function that would be invoked like
-		methodName(Args...);
+		The entry point Python calls is generated from fn's signature: it takes the arguments as an array
+		(METH_FASTCALL, if Python has it), converts each one straight into its parameter, and calls fn directly.
 		*/
-		template <typename tag, typename ... Args>
-		void RegisterFunction( const std::string methodName, const std::function<void( Args... )> fn, const std::string docs = "" )
-		{
-			PyFunc pFn = __getPyFunc_Case2( fn );
-
-			addFunction<tag>( pFn, methodName, METH_VARARGS, docs );
-		}
-
-		/*! RegisterFunction
-		\brief Register some void methodName(Args...)
-
-		\tparam tag An undefined type used internally
-		\tparam R The return type
-
-		\param[in] methodName The name of the function as seen by Python
-		\param[in] fn A std::function object wrapping the function
-		\param[in] docs The optional documentation for the function, as seen by Python
-
-		Use this function to register some non-member function that would be invoked like
-		R returnedVal = methodName();
-		*/
-		template <typename tag, typename R>
-		void RegisterFunction( std::string methodName, const std::function<R()> fn, const std::string docs = "" )
-		{
-			PyFunc pFn = __getPyFunc_Case3( fn );
-
-			addFunction<tag>( pFn, methodName, METH_NOARGS, docs );
-		}
-
-		/*! RegisterFunction
-		\brief Register some void methodName(Args...)
-
-		\tparam tag An undefined type used internally
-
-		\param[in] methodName The name of the function as seen by Python
-		\param[in] fn A std::function object wrapping the function
-		\param[in] docs The optional documentation for the function, as seen by Python
-
-		Use this function to register some non-member function that would be invoked like
-		methodName();
-		*/
-		template <typename tag>
-		void RegisterFunction( const std::string methodName, const std::function<void()> fn, const std::string docs = "" )
+		template <typename Fn, Fn fn>
+		void RegisterFunction( const std::string methodName, const std::string docs = "" )
 		{
-			PyFunc pFn = __getPyFunc_Case4( fn );
-
-			addFunction<tag>( pFn, methodName, METH_NOARGS, docs );
+			int methodFlags( 0 );
+			PyCFunction fnPtr = __get_method<&__thunk<Fn, fn>::entry>( methodFlags );
+			m_vMethodDef.AddMethod( methodName, fnPtr, methodFlags, docs );
 		}
 
-
 		////////////////////////////////////////////////////////////////////////////////////////////////////
 		// Functions for registering C++ class member functions
 		////////////////////////////////////////////////////////////////////////////////////////////////////
 
 		/*! RegisterMemFunction
-		\brief Register some R C::methodName(Args...)
+		\brief Register some R C::methodName(Args...) (const or not)
 
-		\tparam C The C++ class that this function is a member of
-		\tparam tag An undefined type used internally
-		\tparam R The return type
-		\tparam Args The variadic type containing all function arguments
+		\tparam MemFn The type of the member function pointer, i.e R(C::*)(Args...)
+		\tparam fn The member function pointer itself
 
 		\param[in] methodName The name of the function as seen by Python
-		\param[in] fn A std::function object wrapping the function
 		\param[in] docs The optional documentation for the function, as seen by Python
 
 		Use this function to register some member function of class C that would be invoked like
 		C instance;
 		...
 		R returnedVal = c.methodName(Args...);
+		C must already be registered with RegisterClass; the instance comes from the Python object
+		the method is called on. AddMemFnToMod uses this.
 		*/
-		template <typename C, typename tag, typename R, typename ... Args,
-			typename std::enable_if<sizeof...(Args) != 1, int>::type = 0>
-			void RegisterMemFunction( const std::string methodName, const std::function<R( Args... )> fn, const std::string docs = "" )
-		{
-			PyFunc pFn = __getPyFunc_Mem_Case1<C>( fn );
-			addMemFunction<tag, C>( methodName, pFn, METH_VARARGS, docs );
-		}
-
-		/*! RegisterMemFunction
-		\brief Register some void C::methodName(Args...)
-
-		\tparam C The C++ class that this function is a member of
-		\tparam tag An undefined type used internally
-		\tparam Args The variadic type containing all function arguments
-
-		\param[in] methodName The name of the function as seen by Python
-		\param[in] fn A std::function object wrapping the function
-		\param[in] docs The optional documentation for the function, as seen by Python
-
-		Use this function to register some member function of class C that would be invoked like
-		C instance;
-		...
-		c.methodName(Args...);
-		*/
-		template <typename C, typename tag, typename ... Args>
-		void RegisterMemFunction( const std::string methodName, std::function<void( Args... )> fn, const std::string docs = "" )
-		{
-			PyFunc pFn = __getPyFunc_Mem_Case2<C>( fn );
-			addMemFunction<tag, C>( methodName, pFn, METH_VARARGS, docs );
-		}
-
-		/*! RegisterMemFunction
-		\brief Register some void C::methodName(Args...)
-
-		\tparam C The C++ class that this function is a member of
-		\tparam tag An undefined type used internally
-		\tparam R The return type
-
-		\param[in] methodName The name of the function as seen by Python
-		\param[in] fn A std::function object wrapping the function
-		\param[in] docs The optional documentation for the function, as seen by Python
-
-		Use this function to register some member function of class C that would be invoked like
-		C instance;
-		...
-		R returnedVal = c.methodName();
-		*/
-		template <typename C, typename tag, typename R>
-		void RegisterMemFunction( const std::string methodName, std::function<R( C * )> fn, const std::string docs = "" )
+		template <typename MemFn, MemFn fn>
+		void RegisterMemFunction( const std::string methodName, const std::string docs = "" )
 		{
-			PyFunc pFn = __getPyFunc_Mem_Case3<C>( fn );
-			addMemFunction<tag, C>( methodName, pFn, METH_NOARGS, docs );
-		}
-
-		/*! RegisterMemFunction
-		\brief Register some void C::methodName()
-		\tparam C The C++ class that this function is a member of
-		\tparam tag An undefined type used internally
+			using Thunk = __thunk<MemFn, fn>;
 
-		\param[in] methodName The name of the function as seen by Python
-		\param[in] fn A std::function object wrapping the function
-		\param[in] docs The optional documentation for the function, as seen by Python
-		\param[out] success An int indicating the success of the operation, should be 0
-
-		Use this function to register some member function of class C that would be invoked like
-		C instance;
-		...
-		c.methodName();
-		*/
-		template <typename C, typename tag>
-		void RegisterMemFunction( const std::string methodName, const std::function<void( C * )> fn, const std::string docs = "" )
-		{
-			PyFunc pFn = __getPyFunc_Mem_Case4<C>( fn );
-			addMemFunction<tag, C>( methodName, pFn, METH_NOARGS, docs );
+			int methodFlags( 0 );
+			PyCFunction fnPtr = __get_method<&Thunk::entry>( methodFlags );
+			addMemMethod<typename Thunk::Class>( methodName, fnPtr, methodFlags, docs );
 		}
 
-
 		////////////////////////////////////////////////////////////////////////////////////////////////////
 		// Functions for registering C++ types with the module
 		////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -431,9 +280,12 @@ namespace pyl
 #define S1(x) #x
 #define S2(x) S1(x)
 
+// Both template arguments of RegisterFunction / RegisterMemFunction for function F
+#define PYL_FN(F) decltype(&F), &F
+
+// R and the argument types are documentation; the signature comes from F itself
 #define AddFnToMod(F, R, M, ...)\
-	M->RegisterFunction<struct __st_fn##F>(#F, pyl::make_function(F));
+	M->RegisterFunction<PYL_FN(F)>(#F);
 
 #define AddMemFnToMod(C, F, R, M, ...)\
-	std::function<R(C *, ##__VA_ARGS__)> fn##F = &C::F;\
-	M->RegisterMemFunction<C, struct __st_fn##C##F>(#F, fn##F);
\ No newline at end of file
+	M->RegisterMemFunction<PYL_FN(C::F)>(#F);
\ No newline at end of file
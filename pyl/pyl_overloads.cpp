@@ -20,4 +20,15 @@ namespace pyl
 	{
 		return convert_buf( o, &v[0], 4 );
 	}
+	bool convert( PyObject * o, glm::mat4& m )
+	{
+		return convert_buf( o, &m[0][0], 16 );
+	}
+
+	// buffer_traits promises these are tightly packed
+	static_assert( sizeof( glm::vec2 ) == 2 * sizeof( float ), "glm::vec2 isn't packed" );
+	static_assert( sizeof( glm::vec3 ) == 3 * sizeof( float ), "glm::vec3 isn't packed" );
+	static_assert( sizeof( glm::vec4 ) == 4 * sizeof( float ), "glm::vec4 isn't packed" );
+	static_assert( sizeof( glm::fquat ) == 4 * sizeof( float ), "glm::fquat isn't packed" );
+	static_assert( sizeof( glm::mat4 ) == 16 * sizeof( float ), "glm::mat4 isn't packed" );
 }
\ No newline at end of file
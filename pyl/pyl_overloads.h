@@ -1,6 +1,7 @@
 #pragma once
 
 #include "pyliason.h"
+#include "pyl_misc.h"
 #include <glm/fwd.hpp>
 
 namespace pyl
@@ -9,4 +10,12 @@ namespace pyl
 	bool convert( PyObject * o, glm::vec3& v );
 	bool convert( PyObject * o, glm::vec4& v );
 	bool convert( PyObject * o, glm::fquat& v );
+	bool convert( PyObject * o, glm::mat4& m );	// 16 floats, column major
+
+	// glm types are packed floats, so they (and vectors of them) can cross as buffers
+	template<> struct buffer_traits<glm::vec2> { using scalar = float; enum : size_t { count = 2 }; };
+	template<> struct buffer_traits<glm::vec3> { using scalar = float; enum : size_t { count = 3 }; };
+	template<> struct buffer_traits<glm::vec4> { using scalar = float; enum : size_t { count = 4 }; };
+	template<> struct buffer_traits<glm::fquat> { using scalar = float; enum : size_t { count = 4 }; };
+	template<> struct buffer_traits<glm::mat4> { using scalar = float; enum : size_t { count = 16 }; };
 }
\ No newline at end of file
@@ -20,6 +20,7 @@
 
 #include <algorithm>
 #include <fstream>
+#include <new>
 
 #include "pyliason.h"
 
@@ -176,6 +177,149 @@ namespace pyl
 		return PyFloat_FromDouble(d_num);
 	}
 
+	PyObject *alloc_pyobject(const pyl::Object &obj) {
+		PyObject *ptr(obj.get() ? obj.get() : Py_None);
+		Py_INCREF(ptr);
+		return ptr;
+	}
+
+	// Buffer protocol
+
+	const char *buffer_format(char kind, size_t size) {
+		switch (kind) {
+		case 'f':
+			return size == sizeof(double) ? "d" : "f";
+		case 'i':
+			return size == 1 ? "b" : size == 2 ? "h" : size == 4 ? "i" : "q";
+		default:
+			return size == 1 ? "B" : size == 2 ? "H" : size == 4 ? "I" : "Q";
+		}
+	}
+
+	// The kind of a struct module format character (0 if it isn't a number)
+	static char format_kind(char fmt) {
+		switch (fmt) {
+		case 'e': case 'f': case 'd':
+			return 'f';
+		case 'b': case 'h': case 'i': case 'l': case 'q': case 'n':
+			return 'i';
+		case 'B': case 'H': case 'I': case 'L': case 'Q': case 'N':
+			return 'u';
+		default:
+			return 0;
+		}
+	}
+
+	bool get_scalar_buffer(PyObject *obj, char kind, size_t size, Py_buffer *view) {
+		if (!PyObject_CheckBuffer(obj))
+			return false;
+		if (PyObject_GetBuffer(obj, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+			PyErr_Clear();
+			return false;
+		}
+
+		// Native (or explicitly little endian, which native is for us) single items only
+		const char *fmt = view->format ? view->format : "B";
+		if (*fmt == '@' || *fmt == '=' || *fmt == '<')
+			fmt++;
+
+		bool bMatch = false;
+		if (fmt[0] && !fmt[1]) {
+			// Items of the right kind and size, or untyped bytes that divide evenly
+			if (format_kind(fmt[0]) == kind && size_t(view->itemsize) == size)
+				bMatch = true;
+			else if ((fmt[0] == 'B' || fmt[0] == 'c') && size_t(view->len) % size == 0)
+				bMatch = true;
+		}
+
+		if (!bMatch)
+			PyBuffer_Release(view);
+		return bMatch;
+	}
+
+	// The object a memoryview from alloc_buffer looks at
+	struct BufferExport {
+		PyObject_HEAD
+		BufferInfo info;
+		std::shared_ptr<const void> keepAlive;
+	};
+
+	static int BufferExport_getbuffer(PyObject *self, Py_buffer *view, int flags) {
+		const BufferInfo& info = ((BufferExport *)self)->info;
+		view->obj = nullptr;
+		if ((flags & PyBUF_WRITABLE) && info.readonly) {
+			PyErr_SetString(PyExc_BufferError, "buffer is read-only");
+			return -1;
+		}
+
+		// Anyone who doesn't take strides needs us to be C contiguous
+		Py_ssize_t len(info.itemsize);
+		bool bContiguous(true);
+		for (int i = info.ndim - 1; i >= 0; i--) {
+			bContiguous = bContiguous && (info.shape[i] < 2 || info.strides[i] == len);
+			len *= info.shape[i];
+		}
+		if ((flags & PyBUF_STRIDES) != PyBUF_STRIDES && !bContiguous) {
+			PyErr_SetString(PyExc_BufferError, "buffer is not C contiguous");
+			return -1;
+		}
+
+		view->obj = self;
+		Py_INCREF(self);
+		view->buf = (void *)info.pData;
+		view->len = len;
+		view->readonly = info.readonly;
+		view->itemsize = info.itemsize;
+		view->format = (flags & PyBUF_FORMAT) ? (char *)info.format : nullptr;
+		view->ndim = info.ndim;
+		view->shape = (flags & PyBUF_ND) ? (Py_ssize_t *)info.shape : nullptr;
+		view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? (Py_ssize_t *)info.strides : nullptr;
+		view->suboffsets = nullptr;
+		view->internal = nullptr;
+		return 0;
+	}
+
+	static void BufferExport_dealloc(PyObject *self) {
+		((BufferExport *)self)->keepAlive.~shared_ptr();
+		PyObject_Del(self);
+	}
+
+	// Readied on first use
+	static PyTypeObject *get_buffer_export_type() {
+		static PyBufferProcs s_BufferProcs{ BufferExport_getbuffer, nullptr };
+		static PyTypeObject s_TypeObject{ PyVarObject_HEAD_INIT(NULL, 0) };
+		if (s_TypeObject.tp_name == nullptr) {
+			s_TypeObject.tp_name = "pyl.Buffer";
+			s_TypeObject.tp_doc = "Memory owned by C++, seen through a memoryview";
+			s_TypeObject.tp_basicsize = sizeof(BufferExport);
+			s_TypeObject.tp_flags = Py_TPFLAGS_DEFAULT;
+			s_TypeObject.tp_dealloc = BufferExport_dealloc;
+			s_TypeObject.tp_as_buffer = &s_BufferProcs;
+			if (PyType_Ready(&s_TypeObject) < 0) {
+				s_TypeObject.tp_name = nullptr;
+				return nullptr;
+			}
+		}
+		return &s_TypeObject;
+	}
+
+	PyObject *alloc_buffer(const BufferInfo &info, std::shared_ptr<const void> keepAlive) {
+		PyTypeObject *pType = get_buffer_export_type();
+		if (pType == nullptr)
+			return nullptr;
+
+		BufferExport *pExport = PyObject_New(BufferExport, pType);
+		if (pExport == nullptr)
+			return nullptr;
+		new (&pExport->info) BufferInfo(info);
+		new (&pExport->keepAlive) std::shared_ptr<const void>(std::move(keepAlive));
+
+		// The memoryview holds the only reference to the export
+		PyObject *pView = PyMemoryView_FromObject((PyObject *)pExport);
+		Py_DECREF(pExport);
+		return pView;
+	}
+
 	bool is_py_int(PyObject *obj) {
 		return PyLong_Check(obj);
 	}
@@ -18,6 +18,19 @@ from LoopManager import *
 from StateGraph import StateGraph
 from InputManager import *
 
+# Draw on a render thread, so scripts run while the last frame waits on
+# vsync (the frame on screen is then one behind what scripts have set).
+# If the thread can't be started we just draw on this one
+bUseRenderThread = True
+
+# Tell the sound manager which clips should stay resident: those used by
+# the active state and every state reachable from it, plus any extras
+# (it may evict the rest if it's given a memory budget)
+def HintReachableClips(cSM, SG, extraClipNames = set()):
+    states = [SG.activeState] + list(SG.G.neighbors(SG.activeState))
+    clipNames = {l.name for s in states for lSeq in s.diLoopSequences.values() for l in lSeq.loops}
+    cSM.SetReachableClips(clipNames | set(extraClipNames))
+
 # Function to create state graph
 def InitLoopManager(cScene):
     # Create cSM wrapper
@@ -118,6 +131,14 @@ def InitLoopManager(cScene):
                     voiceID += 1
                 l.voiceID = diLoopToVoiceID[l]
 
+    # States whose sequences each play a single loop have a fixed steady state
+    # mix, so let the sound manager pre-render it (this fails harmlessly if
+    # the loops don't share a length, and the voices are mixed individually)
+    for loopState in nodes:
+        liLoops = [lSeq.loops[0] for lSeq in loopState.diLoopSequences.values() if len(lSeq.loops) == 1]
+        if len(liLoops) == len(loopState.diLoopSequences):
+            cSM.CacheMix(loopState.name, [(l.name, l.voiceID, l.vol) for l in liLoops])
+
     # This dict maps the number keys to edge vectors defined in diEdges
     # (provided there are less than 10 nodes...)
     # the edge vectors are used during state advancement for the graph
@@ -164,6 +185,10 @@ def InitLoopManager(cScene):
     # Create the sound manager
     loopManager = LoopManager(cScene, SG, inputManager)
 
+    # Let the sound manager know what clips we'll need, now and whenever the state changes
+    HintReachableClips(cSM, SG, {arpClip.name})
+    SG.SetStateChangedCallback(lambda SG: HintReachableClips(cSM, SG, {arpClip.name}))
+
     # Start the active loop seq
     activeState = loopManager.GetStateGraph().GetActiveState()
     messageList = [(pylSoundManager.CMDStartLoop, (l.name, l.voiceID, l.vol, 0)) for l in activeState.GetActiveLoopGen()]
@@ -182,34 +207,47 @@ def InitScene(pScene):
     # Init the display 
     # TODO Window name, maybe do camera here as well
     glVerMajor = 3
-    glVerMinor = 0
+    glVerMinor = 3
     screenW = 800
     screenH = 800
     glBackgroundColor = [0.15, 0.15, 0.15, 1.]
     cScene.InitDisplay(glVerMajor, glVerMinor, screenW, screenH, glBackgroundColor)
 
+    # Keep linked programs around so later runs skip compiling
+    pylShader.SetBinaryCacheDir('../shaders/')
+
     # After GL context has started, create the Shader
     cShader = pylShader.Shader(cScene.GetShaderPtr())
-    strVertSrc = 'simple.vert'
-    strFragSrc = 'simple.frag'
+    strVertSrc = '../shaders/instanced.vert'
+    strFragSrc = '../shaders/instanced.frag'
     if cShader.SetSrcFiles(strVertSrc, strFragSrc):
         if cShader.CompileAndLink() != 0:
             raise RuntimeError('Shader failed to compile!')
     else:
         raise RuntimeError('Error: Shader source not loaded')
 
-    # The shader must be bound while creating drawables
-    # This isn't strictly true, it's just that I need the handles
-    # to some shader variables. What I should do is cache every shader
-    # variable in a std::map<GLint, string> on compilation. 
+    # Skinned drawables get their own shader; its joint attributes
+    # are handed to drawables so skinned meshes' VAOs can feed them
+    cSkinShader = pylShader.Shader(cScene.GetSkinShaderPtr())
+    if cSkinShader.SetSrcFiles('../shaders/skinned.vert', strFragSrc):
+        if cSkinShader.CompileAndLink() != 0:
+            raise RuntimeError('Skinning shader failed to compile!')
+        cSkinShader.Bind()
+        pylDrawable.SetBlendHandles(cSkinShader.GetHandle('a_BlendIdx'), cSkinShader.GetHandle('a_BlendWeight'))
+        cSkinShader.Unbind()
+
+    # Every active shader variable is looked up when the program is
+    # linked, so handles no longer need the shader bound; we still
+    # bind it while creating drawables, to be safe
     cShader.Bind()
 
-    # Get the position and color handles, set static drawable vars
+    # Get the position handle, set static drawable var
+    # (PMV and color are per instance attributes the scene sets up)
     pylDrawable.SetPosHandle(cShader.GetHandle('a_Pos'))
-    pylDrawable.SetColorHandle(cShader.GetHandle('u_Color'))
-    
-    # Set static PMV handle for camera
-    pylCamera.SetProjHandle(cShader.GetHandle('u_PMV'))
+
+    # Store mesh positions as normalized shorts (the scene
+    # folds the dequantization into each drawable's matrix)
+    pylDrawable.SetQuantizeMeshes(True)
 
     # Init camera (TODO give this screen dims or aspect ratio)
     cCamera = pylCamera.Camera(cScene.GetCameraPtr())
@@ -232,15 +270,24 @@ def InitScene(pScene):
         else:
             clr = DrawableLoopState.clrOff
 
-        # Construct drawable
+        # Construct drawable (the mesh loads in the background,
+        # and the drawable shows up once it's been uploaded)
         th = drIdx * dTH - math.pi/2
-        if cScene.AddDrawable('quad.iqm', [camDim[0]*math.cos(th)/2, camDim[0]*math.sin(th)/2], [.8, .8], clr):
+        newIdx = cScene.AddDrawableAsync('quad.iqm', [camDim[0]*math.cos(th)/2, camDim[0]*math.sin(th)/2], [.8, .8], clr)
+        if newIdx >= 0:
             # Cache drawable index in state class
-            nodes[drIdx].drIdx = drIdx
+            nodes[drIdx].drIdx = newIdx
+
+    # Show the output's waveform and spectrum in the middle of the circle
+    cScene.AddVisualizer([0., 0.], [3., 2.], [.9, .9, .9, 1.], [.2, .7, 1., 1.])
 
     # Unbind the shader
     cShader.Unbind()
 
+    # Every shader is compiled, so the GL context can move to its own thread
+    if bUseRenderThread and not cScene.StartRenderThread():
+        print('Warning: unable to start the render thread, drawing on this one')
+
     # Start SDL audio
     loopManager.PlayPause()
 
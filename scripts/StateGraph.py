@@ -30,6 +30,9 @@ class StateGraph:
         self.G = graph
         self.activeState = initialState
         self._fnAdvance = fnAdvance
+
+        # Called with the graph whenever the active state changes
+        self._fnStateChanged = None
         
         # A coroutine that manages active state contexts
         def stateCoro(self):
@@ -41,6 +44,8 @@ class StateGraph:
 
             while True:
                 self.activeState = nextState
+                if self._fnStateChanged is not None:
+                    self._fnStateChanged(self)
                 with self.activeState.Activate(self, prevState):
                     while nextState is self.activeState:
                         yield self.activeState
@@ -55,6 +60,10 @@ class StateGraph:
             for k, v in kwargs.items():
                 setattr(self, k, v)
 
+    # Set a function called with the graph whenever the active state changes
+    def SetStateChangedCallback(self, fnStateChanged):
+        self._fnStateChanged = fnStateChanged
+
     # Returns the current active state
     def GetActiveState(self):
         return self.activeState
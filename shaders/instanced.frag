@@ -0,0 +1,10 @@
+#version 330
+
+in vec4 v_Color;
+
+out vec4 outColor;
+
+void main()
+{
+	outColor = v_Color;
+}
@@ -0,0 +1,16 @@
+#version 330
+
+// Per vertex (explicit locations, since mesh VAOs are shared with skinned.vert)
+layout( location = 0 ) in vec3 a_Pos;
+
+// Per instance
+layout( location = 1 ) in mat4 a_PMV;
+layout( location = 5 ) in vec4 a_Color;
+
+out vec4 v_Color;
+
+void main()
+{
+	gl_Position = a_PMV * vec4( a_Pos, 1 );
+	v_Color = a_Color;
+}
@@ -0,0 +1,37 @@
+#version 330
+
+// Per vertex (a_Pos matches instanced.vert, the rest sit past its attributes)
+layout( location = 0 ) in vec3 a_Pos;
+layout( location = 6 ) in uvec4 a_BlendIdx;
+layout( location = 7 ) in vec4 a_BlendWeight;
+
+// Per drawable
+uniform mat4 u_PMV;
+uniform vec4 u_Color;
+uniform mat4 u_Dequant;
+
+// Three rows of a 3x4 matrix per joint (the size matches Animator::kMaxJoints)
+layout( std140 ) uniform JointPalette
+{
+	vec4 u_Joints[3 * 128];
+};
+
+out vec4 v_Color;
+
+void main()
+{
+	// Blend the rows of each joint's matrix by weight
+	vec4 r0 = vec4( 0 ), r1 = vec4( 0 ), r2 = vec4( 0 );
+	for ( int i = 0; i < 4; i++ )
+	{
+		int j = 3 * int( a_BlendIdx[i] );
+		r0 += a_BlendWeight[i] * u_Joints[j];
+		r1 += a_BlendWeight[i] * u_Joints[j + 1];
+		r2 += a_BlendWeight[i] * u_Joints[j + 2];
+	}
+
+	// Positions may be quantized, in which case u_Dequant undoes that
+	vec4 p = u_Dequant * vec4( a_Pos, 1 );
+	gl_Position = u_PMV * vec4( dot( r0, p ), dot( r1, p ), dot( r2, p ), 1 );
+	v_Color = u_Color;
+}
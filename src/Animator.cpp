@@ -0,0 +1,579 @@
+#include "Animator.h"
+#include "IqmFile.h"
+#include "Trace.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+#define ANIMATOR_SSE
+#include <xmmintrin.h>
+#endif
+
+// Translation xyz, rotation xyzw, scale xyz; the same order as IQM pose channels
+static const uint32_t kNumChannels = 10;
+
+// A 3x4 matrix, stored as three rows
+static const uint32_t kMatFloats = 12;
+
+// Set every joint in a pose to the identity (so padding joints stay harmless)
+static void setIdentityPose( float * pPose, uint32_t uNumJoints4 )
+{
+	for ( uint32_t c = 0; c < kNumChannels; c++ )
+		std::fill( pPose + c * uNumJoints4, pPose + (c + 1) * uNumJoints4, (c == 6 || c >= 7) ? 1.f : 0.f );
+}
+
+// Normalize the rotation of one joint in a pose
+static void normalizeRotation( float * pPose, uint32_t uNumJoints4, uint32_t uJoint )
+{
+	float * q[4] = { &pPose[3 * uNumJoints4 + uJoint], &pPose[4 * uNumJoints4 + uJoint], &pPose[5 * uNumJoints4 + uJoint], &pPose[6 * uNumJoints4 + uJoint] };
+	const float fLen = sqrtf( *q[0] * *q[0] + *q[1] * *q[1] + *q[2] * *q[2] + *q[3] * *q[3] );
+	if ( fLen > 0.f )
+		for ( float * pC : q )
+			*pC /= fLen;
+}
+
+// pOut = A + (B - A) * fT for translation and scale, and a normalized lerp
+// (the short way around) for rotation. pOut may be pA or pB.
+static void blendPoses( const float * pA, const float * pB, float fT, float * pOut, uint32_t uNumJoints4 )
+{
+	const uint32_t N = uNumJoints4;
+#ifdef ANIMATOR_SSE
+	const __m128 t = _mm_set1_ps( fT );
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 signMask = _mm_set1_ps( -0.f );
+	for ( uint32_t j = 0; j < N; j += 4 )
+	{
+		for ( uint32_t c : { 0u, 1u, 2u, 7u, 8u, 9u } )
+		{
+			const __m128 a = _mm_loadu_ps( &pA[c * N + j] );
+			const __m128 b = _mm_loadu_ps( &pB[c * N + j] );
+			_mm_storeu_ps( &pOut[c * N + j], _mm_add_ps( a, _mm_mul_ps( _mm_sub_ps( b, a ), t ) ) );
+		}
+
+		__m128 qa[4], qb[4];
+		for ( uint32_t c = 0; c < 4; c++ )
+		{
+			qa[c] = _mm_loadu_ps( &pA[(3 + c) * N + j] );
+			qb[c] = _mm_loadu_ps( &pB[(3 + c) * N + j] );
+		}
+
+		// Flip B wherever it's more than 90 degrees from A
+		__m128 dot = zero;
+		for ( uint32_t c = 0; c < 4; c++ )
+			dot = _mm_add_ps( dot, _mm_mul_ps( qa[c], qb[c] ) );
+		const __m128 flip = _mm_and_ps( _mm_cmplt_ps( dot, zero ), signMask );
+
+		__m128 q[4], len2 = zero;
+		for ( uint32_t c = 0; c < 4; c++ )
+		{
+			q[c] = _mm_add_ps( qa[c], _mm_mul_ps( _mm_sub_ps( _mm_xor_ps( qb[c], flip ), qa[c] ), t ) );
+			len2 = _mm_add_ps( len2, _mm_mul_ps( q[c], q[c] ) );
+		}
+
+		const __m128 invLen = _mm_div_ps( _mm_set1_ps( 1.f ), _mm_sqrt_ps( len2 ) );
+		for ( uint32_t c = 0; c < 4; c++ )
+			_mm_storeu_ps( &pOut[(3 + c) * N + j], _mm_mul_ps( q[c], invLen ) );
+	}
+#else
+	for ( uint32_t j = 0; j < N; j++ )
+	{
+		for ( uint32_t c : { 0u, 1u, 2u, 7u, 8u, 9u } )
+			pOut[c * N + j] = pA[c * N + j] + (pB[c * N + j] - pA[c * N + j]) * fT;
+
+		float qa[4], qb[4], fDot( 0 );
+		for ( uint32_t c = 0; c < 4; c++ )
+		{
+			qa[c] = pA[(3 + c) * N + j];
+			qb[c] = pB[(3 + c) * N + j];
+			fDot += qa[c] * qb[c];
+		}
+
+		const float fSign = fDot < 0.f ? -1.f : 1.f;
+		float q[4], fLen2( 0 );
+		for ( uint32_t c = 0; c < 4; c++ )
+		{
+			q[c] = qa[c] + (fSign * qb[c] - qa[c]) * fT;
+			fLen2 += q[c] * q[c];
+		}
+
+		const float fInvLen = 1.f / sqrtf( fLen2 );
+		for ( uint32_t c = 0; c < 4; c++ )
+			pOut[(3 + c) * N + j] = q[c] * fInvLen;
+	}
+#endif
+}
+
+// pOut = A * B, for 3x4 matrices (an implied last row of 0, 0, 0, 1); pOut can't be pA or pB
+static void mul34( const float * pA, const float * pB, float * pOut )
+{
+#ifdef ANIMATOR_SSE
+	const __m128 b0 = _mm_loadu_ps( pB );
+	const __m128 b1 = _mm_loadu_ps( pB + 4 );
+	const __m128 b2 = _mm_loadu_ps( pB + 8 );
+	const __m128 b3 = _mm_set_ps( 1.f, 0.f, 0.f, 0.f );
+	for ( uint32_t r = 0; r < 3; r++ )
+	{
+		const float * a = pA + 4 * r;
+		__m128 row = _mm_mul_ps( _mm_set1_ps( a[0] ), b0 );
+		row = _mm_add_ps( row, _mm_mul_ps( _mm_set1_ps( a[1] ), b1 ) );
+		row = _mm_add_ps( row, _mm_mul_ps( _mm_set1_ps( a[2] ), b2 ) );
+		row = _mm_add_ps( row, _mm_mul_ps( _mm_set1_ps( a[3] ), b3 ) );
+		_mm_storeu_ps( pOut + 4 * r, row );
+	}
+#else
+	for ( uint32_t r = 0; r < 3; r++ )
+	{
+		const float * a = pA + 4 * r;
+		for ( uint32_t c = 0; c < 4; c++ )
+			pOut[4 * r + c] = a[0] * pB[c] + a[1] * pB[4 + c] + a[2] * pB[8 + c] + (c == 3 ? a[3] : 0.f);
+	}
+#endif
+}
+
+Animator::Animator() :
+	m_uNumJointsEvaluated( 0 ),
+	m_uUboAlignment( 256 )
+{
+}
+
+bool Animator::Init()
+{
+	GLint iAlignment( 0 );
+	glGetIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &iAlignment );
+	m_uUboAlignment = std::max<size_t>( (size_t) iAlignment, 16 );
+
+	// Room for a handful of full palettes to start with, it grows as needed
+	return m_PaletteStream.Init( GL_UNIFORM_BUFFER, 16 * kMaxJoints * kMatFloats * sizeof( float ), 3 );
+}
+
+void Animator::Destroy()
+{
+	m_PaletteStream.Destroy();
+}
+
+int Animator::LoadSkeleton( const std::string strIqmFile )
+{
+	for ( size_t i = 0; i < m_vSkeletons.size(); i++ )
+		if ( m_vSkeletons[i].strSrcFile == strIqmFile )
+			return (int) i;
+
+	try
+	{
+		IQMFile f( strIqmFile.c_str() );
+		auto joints = f.Joints();
+		auto poses = f.Poses();
+		auto anims = f.Anims();
+		auto frames = f.Frames();
+
+		const uint32_t uNumJoints = joints.count();
+		if ( joints.ptr() == nullptr || uNumJoints == 0 || uNumJoints > kMaxJoints )
+		{
+			std::cout << "Error: " << strIqmFile << " has no skeleton, or more than " << kMaxJoints << " joints" << std::endl;
+			return -1;
+		}
+
+		Skeleton skel;
+		skel.strSrcFile = strIqmFile;
+		skel.uNumJoints = uNumJoints;
+		skel.uNumJoints4 = (uNumJoints + 3) & ~3u;
+		const uint32_t N = skel.uNumJoints4;
+		const size_t uPoseFloats = kNumChannels * N;
+
+		// The bind pose, and the inverse of each joint's model space bind transform
+		skel.vParents.resize( uNumJoints );
+		skel.vInvBase.resize( uNumJoints * kMatFloats );
+		skel.vBindPose.resize( uPoseFloats );
+		setIdentityPose( skel.vBindPose.data(), N );
+		std::vector<mat4> vBase( uNumJoints );
+		for ( uint32_t j = 0; j < uNumJoints; j++ )
+		{
+			const IQMFile::iqmjoint& joint = joints[j];
+			if ( joint.parent >= (int) j )
+			{
+				std::cout << "Error: " << strIqmFile << " has a joint before its parent" << std::endl;
+				return -1;
+			}
+			skel.vParents[j] = joint.parent;
+
+			for ( uint32_t c = 0; c < 3; c++ )
+			{
+				skel.vBindPose[c * N + j] = joint.translate[c];
+				skel.vBindPose[(7 + c) * N + j] = joint.scale[c];
+			}
+			for ( uint32_t c = 0; c < 4; c++ )
+				skel.vBindPose[(3 + c) * N + j] = joint.rotate[c];
+			normalizeRotation( skel.vBindPose.data(), N, j );
+
+			const glm::fquat q = glm::normalize( glm::fquat( joint.rotate[3], joint.rotate[0], joint.rotate[1], joint.rotate[2] ) );
+			const mat4 m4Local = glm::translate( vec3( joint.translate[0], joint.translate[1], joint.translate[2] ) ) *
+				glm::mat4_cast( q ) * glm::scale( vec3( joint.scale[0], joint.scale[1], joint.scale[2] ) );
+			vBase[j] = joint.parent >= 0 ? vBase[joint.parent] * m4Local : m4Local;
+
+			const mat4 m4InvBase = glm::inverse( vBase[j] );
+			for ( uint32_t r = 0; r < 3; r++ )
+				for ( uint32_t c = 0; c < 4; c++ )
+					skel.vInvBase[j * kMatFloats + 4 * r + c] = m4InvBase[c][r];
+		}
+
+		// Decode every frame: each channel is the pose's offset, plus
+		// a scaled ushort from the frame data if the pose's mask says so
+		const uint32_t uNumFrames = f.getNumFrames();
+		if ( poses.ptr() && anims.ptr() && frames.ptr() && uNumFrames )
+		{
+			uint32_t uNumMasked( 0 );
+			for ( uint32_t p = 0; p < poses.count(); p++ )
+				for ( uint32_t c = 0; c < kNumChannels; c++ )
+					uNumMasked += (poses[p].mask >> c) & 1;
+			if ( poses.count() != uNumJoints || uNumMasked != f.getNumFrameChannels() )
+			{
+				std::cout << "Error: " << strIqmFile << " has poses that don't match its skeleton" << std::endl;
+				return -1;
+			}
+
+			const uint16_t * pFrameData = frames.ptr();
+			skel.vFrames.resize( uNumFrames * uPoseFloats );
+			for ( uint32_t fr = 0; fr < uNumFrames; fr++ )
+			{
+				float * pFrame = &skel.vFrames[fr * uPoseFloats];
+				setIdentityPose( pFrame, N );
+				for ( uint32_t p = 0; p < uNumJoints; p++ )
+				{
+					const IQMFile::iqmpose& pose = poses[p];
+					for ( uint32_t c = 0; c < kNumChannels; c++ )
+					{
+						float fVal = pose.channeloffset[c];
+						if ( pose.mask & (1 << c) )
+							fVal += *pFrameData++ * pose.channelscale[c];
+						pFrame[c * N + p] = fVal;
+					}
+					normalizeRotation( pFrame, N, p );
+				}
+			}
+
+			for ( uint32_t a = 0; a < anims.count(); a++ )
+			{
+				const IQMFile::iqmanim& anim = anims[a];
+				if ( anim.num_frames == 0 || anim.first_frame + anim.num_frames > uNumFrames )
+					continue;
+
+				const char * szName = f.GetString( anim.name );
+				skel.mapAnims[szName ? szName : ""] = (int) skel.vAnims.size();
+				skel.vAnims.push_back( { anim.first_frame, anim.num_frames, anim.framerate > 0.f ? anim.framerate : 30.f, (anim.flags & IQMFile::IQM_LOOP) != 0 } );
+			}
+		}
+
+		m_vSkeletons.push_back( std::move( skel ) );
+		return (int) (m_vSkeletons.size() - 1);
+	}
+	catch ( std::runtime_error& e )
+	{
+		std::cout << e.what() << std::endl;
+		return -1;
+	}
+}
+
+int Animator::AddInstance( int iSkeleton )
+{
+	if ( iSkeleton < 0 || iSkeleton >= (int) m_vSkeletons.size() )
+		return -1;
+
+	const Skeleton& skel = m_vSkeletons[iSkeleton];
+
+	Instance inst;
+	inst.iSkeleton = iSkeleton;
+	inst.trCur = { -1, 0.f };
+	inst.trPrev = { -1, 0.f };
+	inst.fFade = 1.f;
+	inst.fFadeRate = 0.f;
+	inst.fSpeed = 1.f;
+	inst.uPaletteOfs = m_vPalettes.size();
+	m_vPalettes.resize( m_vPalettes.size() + skel.uNumJoints * kMatFloats, 0.f );
+
+	m_vInstances.push_back( inst );
+	return (int) (m_vInstances.size() - 1);
+}
+
+bool Animator::Play( int iInstance, const std::string strAnim, float fFadeTime )
+{
+	if ( iInstance < 0 || iInstance >= (int) m_vInstances.size() )
+		return false;
+
+	Instance& inst = m_vInstances[iInstance];
+	const Skeleton& skel = m_vSkeletons[inst.iSkeleton];
+	auto it = skel.mapAnims.find( strAnim );
+	if ( it == skel.mapAnims.end() )
+		return false;
+
+	inst.trPrev = inst.trCur;
+	inst.trCur = { it->second, 0.f };
+	if ( fFadeTime > 0.f )
+	{
+		inst.fFade = 0.f;
+		inst.fFadeRate = 1.f / fFadeTime;
+	}
+	else
+		inst.fFade = 1.f;
+
+	return true;
+}
+
+bool Animator::SetSpeed( int iInstance, float fSpeed )
+{
+	if ( iInstance < 0 || iInstance >= (int) m_vInstances.size() )
+		return false;
+
+	m_vInstances[iInstance].fSpeed = fSpeed;
+	return true;
+}
+
+void Animator::sampleTrack( const Skeleton& skel, const Track& tr, float * pOut ) const
+{
+	const size_t uPoseFloats = kNumChannels * skel.uNumJoints4;
+	if ( tr.iAnim < 0 )
+	{
+		memcpy( pOut, skel.vBindPose.data(), uPoseFloats * sizeof( float ) );
+		return;
+	}
+
+	// Find the two frames we're between
+	const Anim& anim = skel.vAnims[tr.iAnim];
+	const float fNumFrames = (float) anim.uNumFrames;
+	float fFrame = tr.fTime * anim.fFrameRate;
+	uint32_t uFrame0( 0 ), uFrame1( 0 );
+	if ( anim.bLoop )
+	{
+		fFrame = fmodf( fFrame, fNumFrames );
+		if ( fFrame < 0.f )
+			fFrame += fNumFrames;
+		uFrame0 = std::min( (uint32_t) fFrame, anim.uNumFrames - 1 );
+		uFrame1 = (uFrame0 + 1) % anim.uNumFrames;
+	}
+	else
+	{
+		fFrame = glm::clamp( fFrame, 0.f, fNumFrames - 1.f );
+		uFrame0 = (uint32_t) fFrame;
+		uFrame1 = std::min( uFrame0 + 1, anim.uNumFrames - 1 );
+	}
+
+	const float * pFrame0 = &skel.vFrames[(anim.uFirstFrame + uFrame0) * uPoseFloats];
+	const float * pFrame1 = &skel.vFrames[(anim.uFirstFrame + uFrame1) * uPoseFloats];
+	blendPoses( pFrame0, pFrame1, fFrame - floorf( fFrame ), pOut, skel.uNumJoints4 );
+}
+
+void Animator::buildPalette( const Skeleton& skel, const float * pPose, float * pPalette )
+{
+	const uint32_t N = skel.uNumJoints4;
+	m_vLocalMats.resize( N * kMatFloats );
+	m_vWorldMats.resize( N * kMatFloats );
+	float * pLocal = m_vLocalMats.data();
+	float * pWorld = m_vWorldMats.data();
+
+	// Local transforms (T * R * S) as 3x4 matrices, four joints at a time
+#ifdef ANIMATOR_SSE
+	const __m128 one = _mm_set1_ps( 1.f );
+	const __m128 two = _mm_set1_ps( 2.f );
+	for ( uint32_t j = 0; j < N; j += 4 )
+	{
+		const __m128 tx = _mm_loadu_ps( &pPose[0 * N + j] );
+		const __m128 ty = _mm_loadu_ps( &pPose[1 * N + j] );
+		const __m128 tz = _mm_loadu_ps( &pPose[2 * N + j] );
+		const __m128 qx = _mm_loadu_ps( &pPose[3 * N + j] );
+		const __m128 qy = _mm_loadu_ps( &pPose[4 * N + j] );
+		const __m128 qz = _mm_loadu_ps( &pPose[5 * N + j] );
+		const __m128 qw = _mm_loadu_ps( &pPose[6 * N + j] );
+		const __m128 sx = _mm_loadu_ps( &pPose[7 * N + j] );
+		const __m128 sy = _mm_loadu_ps( &pPose[8 * N + j] );
+		const __m128 sz = _mm_loadu_ps( &pPose[9 * N + j] );
+
+		const __m128 xx = _mm_mul_ps( qx, qx ), yy = _mm_mul_ps( qy, qy ), zz = _mm_mul_ps( qz, qz );
+		const __m128 xy = _mm_mul_ps( qx, qy ), xz = _mm_mul_ps( qx, qz ), yz = _mm_mul_ps( qy, qz );
+		const __m128 wx = _mm_mul_ps( qw, qx ), wy = _mm_mul_ps( qw, qy ), wz = _mm_mul_ps( qw, qz );
+
+		// Rows of the rotation, with the scale applied to each column
+		__m128 rows[3][4] = {
+			{ _mm_mul_ps( _mm_sub_ps( one, _mm_mul_ps( two, _mm_add_ps( yy, zz ) ) ), sx ),
+			  _mm_mul_ps( _mm_mul_ps( two, _mm_sub_ps( xy, wz ) ), sy ),
+			  _mm_mul_ps( _mm_mul_ps( two, _mm_add_ps( xz, wy ) ), sz ), tx },
+			{ _mm_mul_ps( _mm_mul_ps( two, _mm_add_ps( xy, wz ) ), sx ),
+			  _mm_mul_ps( _mm_sub_ps( one, _mm_mul_ps( two, _mm_add_ps( xx, zz ) ) ), sy ),
+			  _mm_mul_ps( _mm_mul_ps( two, _mm_sub_ps( yz, wx ) ), sz ), ty },
+			{ _mm_mul_ps( _mm_mul_ps( two, _mm_sub_ps( xz, wy ) ), sx ),
+			  _mm_mul_ps( _mm_mul_ps( two, _mm_add_ps( yz, wx ) ), sy ),
+			  _mm_mul_ps( _mm_sub_ps( one, _mm_mul_ps( two, _mm_add_ps( xx, yy ) ) ), sz ), tz }
+		};
+
+		// Each row holds one element for four joints; transpose to get each joint's row
+		for ( uint32_t r = 0; r < 3; r++ )
+		{
+			_MM_TRANSPOSE4_PS( rows[r][0], rows[r][1], rows[r][2], rows[r][3] );
+			for ( uint32_t k = 0; k < 4; k++ )
+				_mm_storeu_ps( &pLocal[(j + k) * kMatFloats + 4 * r], rows[r][k] );
+		}
+	}
+#else
+	for ( uint32_t j = 0; j < N; j++ )
+	{
+		const float x = pPose[3 * N + j], y = pPose[4 * N + j], z = pPose[5 * N + j], w = pPose[6 * N + j];
+		const float s[3] = { pPose[7 * N + j], pPose[8 * N + j], pPose[9 * N + j] };
+		const float R[3][3] = {
+			{ 1.f - 2.f * (y * y + z * z), 2.f * (x * y - w * z), 2.f * (x * z + w * y) },
+			{ 2.f * (x * y + w * z), 1.f - 2.f * (x * x + z * z), 2.f * (y * z - w * x) },
+			{ 2.f * (x * z - w * y), 2.f * (y * z + w * x), 1.f - 2.f * (x * x + y * y) }
+		};
+
+		float * pMat = &pLocal[j * kMatFloats];
+		for ( uint32_t r = 0; r < 3; r++ )
+		{
+			for ( uint32_t c = 0; c < 3; c++ )
+				pMat[4 * r + c] = R[r][c] * s[c];
+			pMat[4 * r + 3] = pPose[r * N + j];
+		}
+	}
+#endif
+
+	// Walk down the hierarchy (parents come first), then
+	// undo the bind pose so the palette applies to mesh vertices
+	for ( uint32_t j = 0; j < skel.uNumJoints; j++ )
+	{
+		float * pJointWorld = &pWorld[j * kMatFloats];
+		const int iParent = skel.vParents[j];
+		if ( iParent >= 0 )
+			mul34( &pWorld[iParent * kMatFloats], &pLocal[j * kMatFloats], pJointWorld );
+		else
+			memcpy( pJointWorld, &pLocal[j * kMatFloats], kMatFloats * sizeof( float ) );
+
+		mul34( pJointWorld, &skel.vInvBase[j * kMatFloats], &pPalette[j * kMatFloats] );
+	}
+}
+
+void Animator::Update( float fDT )
+{
+	m_uNumJointsEvaluated = 0;
+	if ( m_vInstances.empty() )
+		return;
+
+	TRACE_SCOPE( "Animator::Update" );
+
+	// Keep looping tracks near zero so float time doesn't lose precision
+	auto advance = [] ( const Skeleton& skel, Track& tr, float fStep )
+	{
+		tr.fTime += fStep;
+		if ( tr.iAnim >= 0 && skel.vAnims[tr.iAnim].bLoop )
+		{
+			const float fDuration = skel.vAnims[tr.iAnim].uNumFrames / skel.vAnims[tr.iAnim].fFrameRate;
+			tr.fTime = fmodf( tr.fTime, fDuration );
+		}
+	};
+
+	for ( Instance& inst : m_vInstances )
+	{
+		const Skeleton& skel = m_vSkeletons[inst.iSkeleton];
+		const size_t uPoseFloats = kNumChannels * skel.uNumJoints4;
+
+		const float fStep = fDT * inst.fSpeed;
+		advance( skel, inst.trCur, fStep );
+		advance( skel, inst.trPrev, fStep );
+		if ( inst.fFade < 1.f )
+			inst.fFade = std::min( 1.f, inst.fFade + fDT * inst.fFadeRate );
+
+		m_vPoseCur.resize( uPoseFloats );
+		sampleTrack( skel, inst.trCur, m_vPoseCur.data() );
+
+		// Crossfade from the animation we're leaving
+		if ( inst.fFade < 1.f )
+		{
+			m_vPosePrev.resize( uPoseFloats );
+			sampleTrack( skel, inst.trPrev, m_vPosePrev.data() );
+			blendPoses( m_vPosePrev.data(), m_vPoseCur.data(), inst.fFade, m_vPoseCur.data(), skel.uNumJoints4 );
+		}
+
+		buildPalette( skel, m_vPoseCur.data(), &m_vPalettes[inst.uPaletteOfs] );
+		m_uNumJointsEvaluated += skel.uNumJoints;
+	}
+}
+
+const std::vector<float>& Animator::GetPalettes() const
+{
+	return m_vPalettes;
+}
+
+Animator::PaletteRange Animator::GetPaletteRange( int iInstance ) const
+{
+	if ( iInstance < 0 || iInstance >= (int) m_vInstances.size() )
+		return{ 0, 0 };
+
+	const Instance& inst = m_vInstances[iInstance];
+	return{ inst.uPaletteOfs, m_vSkeletons[inst.iSkeleton].uNumJoints };
+}
+
+bool Animator::Upload( const std::vector<float>& vPalettes, const std::vector<PaletteRange>& vRanges )
+{
+	if ( vRanges.empty() )
+		return false;
+
+	// Every palette starts aligned, and the shader's block covers kMaxJoints
+	// joints, so leave that much room after the last one
+	const size_t uBlockBytes = kMaxJoints * kMatFloats * sizeof( float );
+	size_t uNumBytes( 0 );
+	m_vUploadOfs.resize( vRanges.size() );
+	for ( size_t i = 0; i < vRanges.size(); i++ )
+	{
+		m_vUploadOfs[i] = uNumBytes;
+		const size_t uPaletteBytes = vRanges[i].uNumJoints * kMatFloats * sizeof( float );
+		uNumBytes += (uPaletteBytes + m_uUboAlignment - 1) / m_uUboAlignment * m_uUboAlignment;
+	}
+	uNumBytes += uBlockBytes;
+
+	uint8_t * pDst = nullptr;
+	if ( m_PaletteStream.Reserve( uNumBytes ) )
+		pDst = (uint8_t *) m_PaletteStream.BeginFrame();
+	if ( pDst == nullptr )
+		return false;
+
+	for ( size_t i = 0; i < vRanges.size(); i++ )
+	{
+		const PaletteRange& range = vRanges[i];
+		if ( range.uOfs + range.uNumJoints * kMatFloats <= vPalettes.size() )
+			memcpy( pDst + m_vUploadOfs[i], &vPalettes[range.uOfs], range.uNumJoints * kMatFloats * sizeof( float ) );
+	}
+	m_PaletteStream.EndWrite( uNumBytes );
+
+	// Offsets into the whole buffer
+	const size_t uFrameOfs = m_PaletteStream.GetFrameOffset();
+	for ( size_t& uOfs : m_vUploadOfs )
+		uOfs += uFrameOfs;
+
+	return true;
+}
+
+bool Animator::BindPalette( size_t uRange, GLuint uBinding ) const
+{
+	if ( uRange >= m_vUploadOfs.size() )
+		return false;
+
+	const size_t uBlockBytes = kMaxJoints * kMatFloats * sizeof( float );
+	glBindBufferRange( GL_UNIFORM_BUFFER, uBinding, m_PaletteStream.GetBuffer(), (GLintptr) m_vUploadOfs[uRange], (GLsizeiptr) uBlockBytes );
+	return true;
+}
+
+void Animator::EndFrame()
+{
+	m_PaletteStream.EndFrame();
+}
+
+size_t Animator::GetNumInstances() const
+{
+	return m_vInstances.size();
+}
+
+size_t Animator::GetNumJointsEvaluated() const
+{
+	return m_uNumJointsEvaluated;
+}
@@ -0,0 +1,108 @@
+#include "AudioClock.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+AudioClock::AudioClock() :
+	m_uSeq( 0 ),
+	m_uSamplesRendered( 0 ),
+	m_uLoopPos( 0 ),
+	m_uLoopLength( 0 ),
+	m_iTimestampNs( 0 ),
+	m_uSamplesPerSecond( 0 ),
+	m_uSamplesPerBuffer( 0 ),
+	m_uNumRetries( 0 )
+{
+}
+
+void AudioClock::SetRate( uint64_t uSamplesPerSecond, uint64_t uSamplesPerBuffer )
+{
+	m_uSamplesPerSecond.store( uSamplesPerSecond, std::memory_order_relaxed );
+	m_uSamplesPerBuffer.store( uSamplesPerBuffer, std::memory_order_relaxed );
+}
+
+void AudioClock::Publish( uint64_t uSamplesRendered, uint64_t uLoopPos, uint64_t uLoopLength )
+{
+	const int64_t iNowNs = Now();
+
+	// Odd while we write; the fence keeps the writes below from moving above it
+	const uint32_t uSeq = m_uSeq.load( std::memory_order_relaxed );
+	m_uSeq.store( uSeq + 1, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_release );
+
+	m_uSamplesRendered.store( uSamplesRendered, std::memory_order_relaxed );
+	m_uLoopPos.store( uLoopPos, std::memory_order_relaxed );
+	m_uLoopLength.store( uLoopLength, std::memory_order_relaxed );
+	m_iTimestampNs.store( iNowNs, std::memory_order_relaxed );
+
+	// Even again, releasing the writes above
+	m_uSeq.store( uSeq + 2, std::memory_order_release );
+}
+
+bool AudioClock::Read( Snapshot& snap ) const
+{
+	while ( true )
+	{
+		const uint32_t uSeq = m_uSeq.load( std::memory_order_acquire );
+		if ( (uSeq & 1) == 0 )
+		{
+			snap.uSamplesRendered = m_uSamplesRendered.load( std::memory_order_relaxed );
+			snap.uLoopPos = m_uLoopPos.load( std::memory_order_relaxed );
+			snap.uLoopLength = m_uLoopLength.load( std::memory_order_relaxed );
+			snap.iTimestampNs = m_iTimestampNs.load( std::memory_order_relaxed );
+
+			// Keep the reads above from moving below the recheck
+			std::atomic_thread_fence( std::memory_order_acquire );
+			if ( m_uSeq.load( std::memory_order_relaxed ) == uSeq )
+				return uSeq != 0;
+		}
+
+		m_uNumRetries.fetch_add( 1, std::memory_order_relaxed );
+	}
+}
+
+double AudioClock::GetTime() const
+{
+	Snapshot snap;
+	const uint64_t uSamplesPerSecond = m_uSamplesPerSecond.load( std::memory_order_relaxed );
+	if ( uSamplesPerSecond == 0 || Read( snap ) == false )
+		return 0;
+
+	const double dSamples = (double) snap.uSamplesRendered + samplesSince( snap, Now() );
+	return std::max( dSamples, 0. ) / (double) uSamplesPerSecond;
+}
+
+float AudioClock::GetLoopPhase() const
+{
+	Snapshot snap;
+	if ( Read( snap ) == false || snap.uLoopLength == 0 )
+		return 0;
+
+	// Wrap back into the loop (we can be behind its start, being a buffer behind)
+	const double dLength = (double) snap.uLoopLength;
+	double dPos = std::fmod( (double) snap.uLoopPos + samplesSince( snap, Now() ), dLength );
+	if ( dPos < 0 )
+		dPos += dLength;
+
+	return (float) (dPos / dLength);
+}
+
+size_t AudioClock::GetNumRetries() const
+{
+	return m_uNumRetries.load( std::memory_order_relaxed );
+}
+
+/*static*/ int64_t AudioClock::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+double AudioClock::samplesSince( const Snapshot& snap, int64_t iNowNs ) const
+{
+	const double dSamplesPerBuffer = (double) m_uSamplesPerBuffer.load( std::memory_order_relaxed );
+	const double dSamplesPerNs = (double) m_uSamplesPerSecond.load( std::memory_order_relaxed ) * 1e-9;
+
+	const double dElapsed = std::max( (double) (iNowNs - snap.iTimestampNs), 0. ) * dSamplesPerNs;
+	return std::min( dElapsed, dSamplesPerBuffer ) - dSamplesPerBuffer;
+}
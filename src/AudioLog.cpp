@@ -0,0 +1,86 @@
+#include "AudioLog.h"
+
+#include <stdarg.h>
+
+AudioLog::AudioLog( size_t uCapacity /*= 256*/ ) :
+	m_uMask( 0 ),
+	m_uWritePos( 0 ),
+	m_uReadPos( 0 ),
+	m_uNumDropped( 0 ),
+	m_uNumDroppedReported( 0 ),
+	m_uNextSeq( 0 )
+{
+	// Round capacity up to a power of two so we can mask indices
+	size_t uPow2Capacity = 1;
+	while ( uPow2Capacity < uCapacity )
+		uPow2Capacity <<= 1;
+
+	// Everything is allocated up front, the writer never allocates
+	m_pRecords.reset( new Record[uPow2Capacity] );
+	m_uMask = uPow2Capacity - 1;
+}
+
+bool AudioLog::Write( const char * szFmt, ... )
+{
+	const size_t uWritePos = m_uWritePos.load( std::memory_order_relaxed );
+	const size_t uReadPos = m_uReadPos.load( std::memory_order_acquire );
+
+	// If the ring is full, drop the record
+	if ( uWritePos - uReadPos > m_uMask )
+	{
+		m_uNumDropped.fetch_add( 1, std::memory_order_relaxed );
+		m_uNextSeq++;
+		return false;
+	}
+
+	// Format directly into the record (vsnprintf truncates, never allocates a buffer)
+	Record& rec = m_pRecords[uWritePos & m_uMask];
+	rec.uSeq = m_uNextSeq++;
+
+	va_list args;
+	va_start( args, szFmt );
+	vsnprintf( rec.szMsg, kMaxRecordLength, szFmt, args );
+	va_end( args );
+
+	// Publish it
+	m_uWritePos.store( uWritePos + 1, std::memory_order_release );
+
+	return true;
+}
+
+size_t AudioLog::Drain( FILE * fp )
+{
+	if ( fp == nullptr )
+		return 0;
+
+	// Let the reader know if anything got dropped since last time
+	const size_t uNumDropped = m_uNumDropped.load( std::memory_order_relaxed );
+	if ( uNumDropped != m_uNumDroppedReported )
+	{
+		fprintf( fp, "[audio] %zu log records dropped\n", uNumDropped - m_uNumDroppedReported );
+		m_uNumDroppedReported = uNumDropped;
+	}
+
+	const size_t uReadPos = m_uReadPos.load( std::memory_order_relaxed );
+	const size_t uWritePos = m_uWritePos.load( std::memory_order_acquire );
+
+	// Print everything between the read and write positions
+	for ( size_t uPos = uReadPos; uPos != uWritePos; uPos++ )
+	{
+		const Record& rec = m_pRecords[uPos & m_uMask];
+		fprintf( fp, "[audio %u] %s\n", rec.uSeq, rec.szMsg );
+	}
+
+	// Hand the records back to the writer
+	m_uReadPos.store( uWritePos, std::memory_order_release );
+
+	if ( uWritePos != uReadPos )
+		fflush( fp );
+
+	return uWritePos - uReadPos;
+}
+
+size_t AudioLog::GetNumDropped() const
+{
+	return m_uNumDropped.load( std::memory_order_relaxed );
+}
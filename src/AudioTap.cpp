@@ -0,0 +1,81 @@
+#include "AudioTap.h"
+
+#include <algorithm>
+#include <cstring>
+
+// How many times a reader tries before settling for what it got
+static const int kMaxReadAttempts = 3;
+
+AudioTap::AudioTap( size_t uCapacity /*= 1 << 15*/ ) :
+	m_uMask( 0 ),
+	m_uWritePos( 0 )
+{
+	// Round capacity up to a power of two so we can mask indices
+	size_t uPow2Capacity = 1;
+	while ( uPow2Capacity < uCapacity )
+		uPow2Capacity <<= 1;
+
+	// Everything is allocated up front, the writer never allocates
+	m_pSamples.reset( new float[uPow2Capacity]() );
+	m_uMask = uPow2Capacity - 1;
+}
+
+void AudioTap::Write( const float * pSamples, size_t uNumSamples )
+{
+	if ( pSamples == nullptr || uNumSamples == 0 )
+		return;
+
+	// Only the last capacity's worth would survive anyway
+	const size_t uCapacity = m_uMask + 1;
+	uint64_t uWritePos = m_uWritePos.load( std::memory_order_relaxed );
+	if ( uNumSamples > uCapacity )
+	{
+		uWritePos += uNumSamples - uCapacity;
+		pSamples += uNumSamples - uCapacity;
+		uNumSamples = uCapacity;
+	}
+
+	// At most two copies, split where the ring wraps
+	const size_t uStart = (size_t) uWritePos & m_uMask;
+	const size_t uFirst = std::min( uNumSamples, uCapacity - uStart );
+	memcpy( &m_pSamples[uStart], pSamples, uFirst * sizeof( float ) );
+	memcpy( &m_pSamples[0], pSamples + uFirst, (uNumSamples - uFirst) * sizeof( float ) );
+
+	// Publish the samples
+	m_uWritePos.store( uWritePos + uNumSamples, std::memory_order_release );
+}
+
+size_t AudioTap::ReadLatest( float * pOut, size_t uNumSamples ) const
+{
+	if ( pOut == nullptr )
+		return 0;
+
+	uNumSamples = std::min( uNumSamples, GetCapacity() );
+	for ( int iAttempt = 0; ; iAttempt++ )
+	{
+		const uint64_t uWritePos = m_uWritePos.load( std::memory_order_acquire );
+		const size_t uNumRead = (size_t) std::min<uint64_t>( uNumSamples, uWritePos );
+		const uint64_t uReadPos = uWritePos - uNumRead;
+		copyOut( uReadPos, pOut, uNumRead );
+
+		// If the writer got all the way around to where we started, we may have
+		// copied some new samples over old ones; it's a visualizer, so don't try forever
+		std::atomic_thread_fence( std::memory_order_acquire );
+		const uint64_t uNewWritePos = m_uWritePos.load( std::memory_order_relaxed );
+		if ( uNewWritePos - uReadPos <= GetCapacity() || iAttempt + 1 == kMaxReadAttempts )
+			return uNumRead;
+	}
+}
+
+size_t AudioTap::GetCapacity() const
+{
+	return m_uMask + 1;
+}
+
+void AudioTap::copyOut( uint64_t uPos, float * pOut, size_t uNumSamples ) const
+{
+	const size_t uStart = (size_t) uPos & m_uMask;
+	const size_t uFirst = std::min( uNumSamples, GetCapacity() - uStart );
+	memcpy( pOut, &m_pSamples[uStart], uFirst * sizeof( float ) );
+	memcpy( pOut + uFirst, &m_pSamples[0], (uNumSamples - uFirst) * sizeof( float ) );
+}
@@ -8,13 +8,16 @@ using glm::normalize;
 
 Camera::Camera() :
 	m_v2Pos( 0 ),
-	m_m4Proj( 1 )
+	m_m4Proj( 1 ),
+	m_m4Mat( 1 ),
+	m_bMatDirty( false )
 {
 }
 
 void Camera::InitOrtho( vec2 X, vec2 Y )
 {
 	m_m4Proj = glm::ortho( X[0], X[1], Y[0], Y[1], Y[0], Y[1] );
+	m_bMatDirty = true;
 }
 
 // Why am I inverting the translation but not the rotation?
@@ -27,17 +30,24 @@ mat4 Camera::GetMat()
 {
 	// The camera is always at the origin.
 	// We're really moving and rotating everyone else
-	return m_m4Proj * GetTransform();
+	if ( m_bMatDirty )
+	{
+		m_m4Mat = m_m4Proj * GetTransform();
+		m_bMatDirty = false;
+	}
+	return m_m4Mat;
 }
 
 void Camera::Translate( vec2 T )
 {
 	m_v2Pos += T;
+	m_bMatDirty = true;
 }
 
 void Camera::Reset()
 {
 	m_v2Pos = vec2( 0 );
+	m_bMatDirty = true;
 }
 
 mat4 Camera::GetProj()
@@ -45,6 +55,27 @@ mat4 Camera::GetProj()
 	return m_m4Proj;
 }
 
+std::array<vec4, 6> Camera::GetFrustumPlanes()
+{
+	// A point p is inside if -w <= (M*p).i <= w for each axis i,
+	// so each plane is the bottom row plus or minus another row
+	const mat4 M = GetMat();
+	const vec4 r0( M[0][0], M[1][0], M[2][0], M[3][0] );
+	const vec4 r1( M[0][1], M[1][1], M[2][1], M[3][1] );
+	const vec4 r2( M[0][2], M[1][2], M[2][2], M[3][2] );
+	const vec4 r3( M[0][3], M[1][3], M[2][3], M[3][3] );
+
+	std::array<vec4, 6> arPlanes{ { r3 + r0, r3 - r0, r3 + r1, r3 - r1, r3 + r2, r3 - r2 } };
+	for ( vec4& plane : arPlanes )
+	{
+		const float fLen = glm::length( vec3( plane ) );
+		if ( fLen > 0.f )
+			plane /= fLen;
+	}
+
+	return arPlanes;
+}
+
 /*static*/ GLint Camera::GetPosHandle()
 {
 	return s_PosHandle;
@@ -76,5 +107,5 @@ mat4 Camera::GetProj()
 	pCameraModDef->RegisterClass<Camera>( "Camera" );
 	
 	AddMemFnToMod( Camera, InitOrtho, void, pCameraModDef, vec2, vec2 );
-	pCameraModDef->RegisterFunction<struct st_fnCamSetPH>( "SetProjHandle", pyl::make_function( Camera::SetProjHandle ) );
+	pCameraModDef->RegisterFunction<PYL_FN( Camera::SetProjHandle )>( "SetProjHandle" );
 }
\ No newline at end of file
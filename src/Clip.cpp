@@ -4,10 +4,39 @@
 // Default constructor tries to init to a sane state
 Clip::Clip() :
 	m_uSamplesInHead( 0 ),
-	m_uFadeSamples( 0 )
+	m_uTotalSamples( 0 ),
+	m_uFadeSamples( 0 ),
+	m_eResidency( EResidency::NotResident )
 {
 }
 
+Clip::Clip( const Clip& other ) :
+	m_uSamplesInHead( other.m_uSamplesInHead ),
+	m_uTotalSamples( other.m_uTotalSamples ),
+	m_uFadeSamples( other.m_uFadeSamples ),
+	m_strName( other.m_strName ),
+	m_vAudioBuffer( other.m_vAudioBuffer ),
+	m_eResidency( other.GetResidency() )
+{
+}
+
+Clip::~Clip()
+{
+	releaseSampleViews();
+}
+
+Clip& Clip::operator=( const Clip& other )
+{
+	releaseSampleViews();
+	m_uSamplesInHead = other.m_uSamplesInHead;
+	m_uTotalSamples = other.m_uTotalSamples;
+	m_uFadeSamples = other.m_uFadeSamples;
+	m_strName = other.m_strName;
+	m_vAudioBuffer = other.m_vAudioBuffer;
+	SetResidency( other.GetResidency() );
+	return *this;
+}
+
 // More interesting
 Clip::Clip( const std::string strName,				// The friendly name of the loop
 			const float * const pHeadBuffer,		// The head buffer
@@ -55,6 +84,8 @@ Clip::Clip( const std::string strName,				// The friendly name of the loop
 
 		// Shrink audio buffer, it won't be resized
 		m_vAudioBuffer.shrink_to_fit();
+		m_uTotalSamples = m_vAudioBuffer.size();
+		m_eResidency = EResidency::Resident;
 	}
 }
 
@@ -66,7 +97,7 @@ std::string Clip::GetName() const
 size_t Clip::GetNumSamples( bool bTail /*= false*/ ) const
 {
 	if ( bTail )
-		return m_vAudioBuffer.size();
+		return m_uTotalSamples;
 	return m_uSamplesInHead;
 }
 
@@ -78,4 +109,73 @@ size_t Clip::GetNumFadeSamples() const
 float const * Clip::GetAudioData() const
 {
 	return m_vAudioBuffer.empty() ? nullptr : m_vAudioBuffer.data();
+}
+
+Clip::EResidency Clip::GetResidency() const
+{
+	return m_eResidency.load( std::memory_order_acquire );
+}
+
+void Clip::SetResidency( EResidency eResidency )
+{
+	m_eResidency.store( eResidency, std::memory_order_release );
+}
+
+bool Clip::IsResident() const
+{
+	return GetResidency() == EResidency::Resident;
+}
+
+bool Clip::ChangeResidency( EResidency eFrom, EResidency eTo )
+{
+	return m_eResidency.compare_exchange_strong( eFrom, eTo, std::memory_order_acq_rel );
+}
+
+bool Clip::IsLoadPending() const
+{
+	const EResidency eResidency = GetResidency();
+	return eResidency == EResidency::Loading || eResidency == EResidency::Evicting || eResidency == EResidency::Evicted;
+}
+
+size_t Clip::GetNumResidentBytes() const
+{
+	return m_vAudioBuffer.capacity() * sizeof( float );
+}
+
+void Clip::Evict()
+{
+	releaseSampleViews();
+
+	// Swap with an empty vector to actually release the memory
+	std::vector<float>().swap( m_vAudioBuffer );
+}
+
+void Clip::Restore( Clip& staged )
+{
+	releaseSampleViews();
+	m_uSamplesInHead = staged.m_uSamplesInHead;
+	m_uTotalSamples = staged.m_uTotalSamples;
+	m_uFadeSamples = staged.m_uFadeSamples;
+	m_vAudioBuffer.swap( staged.m_vAudioBuffer );
+}
+
+std::shared_ptr<const void> Clip::GetSampleViewToken()
+{
+	if ( m_spViewToken == nullptr )
+		m_spViewToken = std::make_shared<std::vector<float>>();
+	return m_spViewToken;
+}
+
+bool Clip::HasSampleViews() const
+{
+	return m_spViewToken != nullptr && m_spViewToken.use_count() > 1;
+}
+
+void Clip::releaseSampleViews()
+{
+	// Swapping vectors doesn't move their elements, so
+	// anyone looking at our samples can keep looking
+	if ( HasSampleViews() )
+		m_spViewToken->swap( m_vAudioBuffer );
+	m_spViewToken.reset();
 }
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "ClipLoader.h"
+
+ClipLoader::ClipLoader() :
+	m_Loader( &ClipLoader::loadJob )
+{
+}
+
+/*static*/ bool ClipLoader::LoadClip( const std::string strName, const Source& src, const SDL_AudioSpec& refSpec, Clip& clip )
+{
+	float * pSoundBuffer( nullptr );
+	Uint32 uNumBytesInHead( 0 );
+	float * pTailBuffer( nullptr );
+	Uint32 uNumBytesInTail( 0 );
+	SDL_AudioSpec wavSpec{ 0 };
+	auto checkAudioSpec = [&refSpec, &wavSpec] ()
+	{
+		return (refSpec.freq == wavSpec.freq &&
+				 refSpec.format == wavSpec.format &&
+				 refSpec.channels == wavSpec.channels &&
+				 refSpec.samples == wavSpec.samples);
+	};
+
+	if ( SDL_LoadWAV( src.strHeadFile.c_str(), &wavSpec, (Uint8 **) &pSoundBuffer, &uNumBytesInHead ) == nullptr )
+		return false;
+
+	if ( checkAudioSpec() == false )
+	{
+		SDL_FreeWAV( (Uint8 *) pSoundBuffer );
+		return false;
+	}
+
+	if ( SDL_LoadWAV( src.strTailFile.c_str(), &wavSpec, (Uint8 **) &pTailBuffer, &uNumBytesInTail ) )
+	{
+		if ( checkAudioSpec() == false )
+		{
+			SDL_FreeWAV( (Uint8 *) pTailBuffer );
+			pTailBuffer = nullptr;
+			uNumBytesInTail = 0;
+		}
+	}
+
+	// The clip copies the samples, so we can free the WAV buffers
+	const size_t uNumSamplesInHead = uNumBytesInHead / sizeof( float );
+	const size_t uNumSamplesInTail = uNumBytesInTail / sizeof( float );
+	clip = Clip( strName, pSoundBuffer, uNumSamplesInHead, pTailBuffer, uNumSamplesInTail, src.uFadeSamples );
+
+	SDL_FreeWAV( (Uint8 *) pSoundBuffer );
+	if ( pTailBuffer )
+		SDL_FreeWAV( (Uint8 *) pTailBuffer );
+
+	return true;
+}
+
+/*static*/ void ClipLoader::loadJob( const Job& job, Loaded& loaded )
+{
+	loaded.strName = job.strName;
+	loaded.bSuccess = LoadClip( job.strName, job.src, job.spec, loaded.clip );
+}
+
+void ClipLoader::Request( const std::string strName, const Source& src, const SDL_AudioSpec& refSpec )
+{
+	m_Loader.Request( { strName, src, refSpec } );
+}
+
+void ClipLoader::TakeLoaded( std::list<Loaded>& liLoaded )
+{
+	m_Loader.TakeLoaded( liLoaded );
+}
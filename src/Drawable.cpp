@@ -1,32 +1,52 @@
 #include "Drawable.h"
-#include "IqmFile.h"
+#include "MeshData.h"
+#include "RenderThread.h"
 
 #include <glm/gtx/transform.hpp>
 
-#include <array>
 #include <pyliason.h>
 
 GLint Drawable::s_PosHandle( -1 );
 GLint Drawable::s_ColorHandle( -1 );
-std::map<std::string, std::array<GLuint, 2> > Drawable::s_VAOCache;
+GLint Drawable::s_BlendIdxHandle( -1 );
+GLint Drawable::s_BlendWeightHandle( -1 );
+std::map<std::string, Drawable::MeshInfo> Drawable::s_MeshCache;
+MeshArena Drawable::s_MeshArena;
 std::map<std::string, Drawable > Drawable::s_PrimitiveMap;
 
 Drawable::Drawable() :
-	m_VAO( 0 ),
-	m_nIdx( 0 ),
+	m_hMesh( MeshArena::kInvalidHandle ),
+	m_bQuantized( false ),
+	m_m4Dequant( 1 ),
+	m_v3BoundsMin( 0 ),
+	m_v3BoundsMax( 0 ),
 	m_Color( 1 ),
-	m_Scale( 1 )
+	m_Scale( 1 ),
+	m_pTransformStore( nullptr ),
+	m_uTransformIdx( 0 ),
+	m_iAnimInstance( -1 )
 {
 }
 
 // This will probably have to be a bit more flexible
 Drawable::Drawable( std::string iqmFileName, vec4 color, quatvec qv, vec2 scale ) :
+	Drawable( iqmFileName, color, qv, scale, true )
+{
+}
+
+Drawable::Drawable( std::string iqmFileName, vec4 color, quatvec qv, vec2 scale, bool bLoadMesh ) :
 	m_SrcFile( iqmFileName ),
-	m_VAO( 0 ),
-	m_nIdx( 0 ),
+	m_hMesh( MeshArena::kInvalidHandle ),
+	m_bQuantized( false ),
+	m_m4Dequant( 1 ),
+	m_v3BoundsMin( 0 ),
+	m_v3BoundsMax( 0 ),
 	m_Color( color ),
 	m_QV( qv ),
-	m_Scale( scale )
+	m_Scale( scale ),
+	m_pTransformStore( nullptr ),
+	m_uTransformIdx( 0 ),
+	m_iAnimInstance( -1 )
 {
 	if ( Drawable::s_PosHandle < 0 )
 		throw std::runtime_error( "Error: you haven't initialized the static pos handle for drawables!" );
@@ -35,88 +55,215 @@ Drawable::Drawable( std::string iqmFileName, vec4 color, quatvec qv, vec2 scale
 	m_SrcFile = m_SrcFile.substr( 0, m_SrcFile.find( ".iqm" ) );
 
 	// See if we've loaded this Iqm File before
-	if ( s_VAOCache.find( m_SrcFile ) == s_VAOCache.end() )
+	if ( bLoadMesh && IsMeshCached( iqmFileName ) == false )
 	{
-		GLuint VAO( 0 ), nIdx( 0 );
+		// Load the preprocessed mesh next to the IQM file (made on first run)
+		MeshData mesh;
+		if ( MeshData::LoadCached( iqmFileName, mesh ) == false )
+			throw std::runtime_error( "Error: unable to load mesh " + iqmFileName );
 
-		// Lambda to generate a VBO
-		auto makeVBO = []
-			( GLuint buf, GLint handle, void * ptr, GLsizeiptr numBytes, GLuint dim, GLuint type )
-		{
-			glBindBuffer( GL_ARRAY_BUFFER, buf );
-			glBufferData( GL_ARRAY_BUFFER, numBytes, ptr, GL_STATIC_DRAW );
-			glEnableVertexAttribArray( handle );
-			glVertexAttribPointer( handle, dim, type, 0, 0, 0 );
-			//Disable?
-		};
+		CacheMesh( iqmFileName, mesh );
+	}
 
-		IQMFile f( iqmFileName.c_str() );
+	ResolveMesh();
+}
 
-		std::array<GLuint, 2> vboBuf{ {0, 0} };
+/*static*/ Drawable Drawable::Deferred( std::string iqmSrc, vec4 clr, quatvec qv, vec2 scale )
+{
+	return Drawable( iqmSrc, clr, qv, scale, false );
+}
 
-		glGenVertexArrays( 1, &VAO );
-		glBindVertexArray( VAO );
+/*static*/ bool Drawable::IsMeshCached( std::string iqmSrc )
+{
+	return s_MeshCache.count( iqmSrc.substr( 0, iqmSrc.find( ".iqm" ) ) ) != 0;
+}
 
-		glGenBuffers( vboBuf.size(), vboBuf.data() );
+/*static*/ bool Drawable::CacheMesh( std::string iqmSrc, const MeshData& mesh )
+{
+	// The arena uploads, so this happens wherever the GL context is
+	MeshArena::Handle hMesh( MeshArena::kInvalidHandle );
+	RenderThread::RunSync( [&] ()
+	{
+		hMesh = s_MeshArena.Add( mesh, s_PosHandle, s_BlendIdxHandle, s_BlendWeightHandle );
+	} );
+	if ( hMesh == MeshArena::kInvalidHandle )
+		return false;
 
-		GLuint bufIdx( 0 );
-		auto pos = f.Positions();
-		makeVBO( vboBuf[bufIdx++], s_PosHandle, pos.ptr(), pos.numBytes(), pos.nativeSize() / sizeof( float ), GL_FLOAT );
+	// If we're replacing a mesh, free the old one
+	const std::string strKey = iqmSrc.substr( 0, iqmSrc.find( ".iqm" ) );
+	auto it = s_MeshCache.find( strKey );
+	if ( it != s_MeshCache.end() )
+		s_MeshArena.Free( it->second.hMesh );
 
-		auto idx = f.Indices();
-		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, vboBuf[bufIdx] );
-		glBufferData( GL_ELEMENT_ARRAY_BUFFER, idx.numBytes(), idx.ptr(), GL_STATIC_DRAW );
+	s_MeshCache[strKey] = MeshInfo{ hMesh, mesh.GetBoundsMin(), mesh.GetBoundsMax(), mesh.IsQuantized(), mesh.GetDequantMat(), mesh.GetBytesSaved() };
+	return true;
+}
 
-		glBindVertexArray( 0 );
+/*static*/ void Drawable::SetQuantizeMeshes( bool bQuantize )
+{
+	MeshData::SetQuantize( bQuantize );
+}
 
-		nIdx = idx.count();
+/*static*/ int Drawable::GetMeshBytesSaved( std::string iqmSrc )
+{
+	auto it = s_MeshCache.find( iqmSrc.substr( 0, iqmSrc.find( ".iqm" ) ) );
+	if ( it == s_MeshCache.end() )
+		return -1;
+	return (int) it->second.uBytesSaved;
+}
 
-		s_VAOCache.emplace( m_SrcFile, std::array<GLuint, 2>{ {VAO, nIdx}} );
-	}
+/*static*/ size_t Drawable::GetTotalMeshBytesSaved()
+{
+	size_t uBytesSaved( 0 );
+	for ( auto& itMesh : s_MeshCache )
+		uBytesSaved += itMesh.second.uBytesSaved;
+	return uBytesSaved;
+}
 
-	m_VAO = s_VAOCache[m_SrcFile][0];
-	m_nIdx = s_VAOCache[m_SrcFile][1];
+/*static*/ bool Drawable::FreeMesh( std::string iqmSrc )
+{
+	// Drawables using it stop drawing (until it's cached again and they're resolved)
+	auto it = s_MeshCache.find( iqmSrc.substr( 0, iqmSrc.find( ".iqm" ) ) );
+	if ( it == s_MeshCache.end() )
+		return false;
+
+	s_MeshArena.Free( it->second.hMesh );
+	s_MeshCache.erase( it );
+	return true;
+}
+
+/*static*/ void Drawable::CompactMeshes()
+{
+	RenderThread::RunSync( [] () { s_MeshArena.Compact(); } );
+}
+
+/*static*/ void Drawable::DestroyMeshes()
+{
+	RenderThread::RunSync( [] () { s_MeshArena.Destroy(); } );
+	s_MeshCache.clear();
+}
+
+/*static*/ const MeshArena& Drawable::GetMeshArena()
+{
+	return s_MeshArena;
+}
+
+bool Drawable::ResolveMesh()
+{
+	auto it = s_MeshCache.find( m_SrcFile );
+	if ( it == s_MeshCache.end() )
+		return false;
+
+	const MeshInfo& mesh = it->second;
+	m_hMesh = mesh.hMesh;
+	m_bQuantized = mesh.bQuantized;
+	m_m4Dequant = mesh.m4Dequant;
+	m_v3BoundsMin = mesh.v3BoundsMin;
+	m_v3BoundsMax = mesh.v3BoundsMax;
+
+	// The store needs our bounds for culling
+	if ( m_pTransformStore )
+		m_pTransformStore->SetLocalBounds( m_uTransformIdx, m_v3BoundsMin, m_v3BoundsMax );
+
+	return true;
+}
+
+bool Drawable::IsResident() const
+{
+	return s_MeshArena.Get( m_hMesh ) != nullptr;
 }
 
 mat4 Drawable::GetMV() const
 {
+	// The store caches this, and only rebuilds it if we've moved
+	if ( m_pTransformStore )
+		return m_pTransformStore->GetMat( m_uTransformIdx );
 	return m_QV.ToMat4() * glm::scale( vec3( m_Scale, 1.f ) );
 }
 
+mat4 Drawable::GetDrawMV() const
+{
+	if ( m_bQuantized )
+		return GetMV() * m_m4Dequant;
+	return GetMV();
+}
+
+mat4 Drawable::GetDequantMat() const
+{
+	return m_bQuantized ? m_m4Dequant : mat4( 1 );
+}
+
 vec4 Drawable::GetColor() const
 {
 	return m_Color;
 }
 
+const MeshArena::Mesh * Drawable::GetMesh() const
+{
+	return s_MeshArena.Get( m_hMesh );
+}
+
+MeshArena::Handle Drawable::GetMeshHandle() const
+{
+	return m_hMesh;
+}
+
+bool Drawable::IsVisible() const
+{
+	if ( m_pTransformStore )
+		return m_pTransformStore->IsVisible( m_uTransformIdx );
+	return true;
+}
+
 // Todo correct these by type
 void Drawable::Translate( vec3 T )
 {
-	m_QV.V += T;
+	if ( m_pTransformStore )
+		m_pTransformStore->Translate( m_uTransformIdx, T );
+	else
+		m_QV.V += T;
 }
 
 void Drawable::SetPos( vec3 T )
 {
-	m_QV.V = T;
+	if ( m_pTransformStore )
+		m_pTransformStore->SetPos( m_uTransformIdx, T );
+	else
+		m_QV.V = T;
 }
 
 void Drawable::Rotate( fquat Q )
 {
-	m_QV.Q = Q * m_QV.Q;
+	if ( m_pTransformStore )
+		m_pTransformStore->Rotate( m_uTransformIdx, Q );
+	else
+		m_QV.Q = Q * m_QV.Q;
 }
 
 void Drawable::SetRot( fquat Q )
 {
-	m_QV.Q = Q;
+	if ( m_pTransformStore )
+		m_pTransformStore->SetRot( m_uTransformIdx, Q );
+	else
+		m_QV.Q = Q;
 }
 
 void Drawable::SetTransform( quatvec QV )
 {
-	m_QV = QV;
+	if ( m_pTransformStore )
+		m_pTransformStore->SetTransform( m_uTransformIdx, QV );
+	else
+		m_QV = QV;
 }
 
 void Drawable::Transform( quatvec QV )
 {
 	// TODO
+	if ( m_pTransformStore )
+	{
+		m_pTransformStore->Transform( m_uTransformIdx, QV );
+		return;
+	}
 	m_QV.V += QV.V;
 	m_QV.Q = QV.Q*m_QV.Q;
 }
@@ -126,12 +273,49 @@ void Drawable::SetColor( vec4 C )
 	m_Color = glm::clamp( C, vec4( 0 ), vec4( 1 ) );
 }
 
+void Drawable::AttachTransformStore( TransformStore * pStore )
+{
+	// Hand our current transform over to the store (or take it back)
+	if ( m_pTransformStore )
+	{
+		m_QV = m_pTransformStore->GetTransform( m_uTransformIdx );
+		m_Scale = m_pTransformStore->GetScale( m_uTransformIdx );
+	}
+
+	m_pTransformStore = pStore;
+	if ( m_pTransformStore )
+	{
+		m_uTransformIdx = m_pTransformStore->Add( m_QV, m_Scale );
+		m_pTransformStore->SetLocalBounds( m_uTransformIdx, m_v3BoundsMin, m_v3BoundsMax );
+	}
+}
+
+void Drawable::SetAnimInstance( int iAnimInstance )
+{
+	m_iAnimInstance = iAnimInstance;
+}
+
+int Drawable::GetAnimInstance() const
+{
+	return m_iAnimInstance;
+}
+
+bool Drawable::IsSkinned() const
+{
+	return m_iAnimInstance >= 0;
+}
+
 void Drawable::Draw()
 {
-	// Bind VAO, draw
-	glBindVertexArray( m_VAO );
-	glDrawElements( GL_TRIANGLES, m_nIdx, GL_UNSIGNED_INT, NULL );
-	glBindVertexArray( m_VAO );
+	// Nothing to draw until our mesh is resident
+	const MeshArena::Mesh * pMesh = GetMesh();
+	if ( pMesh == nullptr )
+		return;
+
+	// Bind VAO, draw our range of it
+	glBindVertexArray( pMesh->VAO );
+	glDrawElementsBaseVertex( GL_TRIANGLES, pMesh->nIdx, pMesh->eIdxType, (GLvoid *) (size_t) pMesh->uIdxOffset, pMesh->iBaseVertex );
+	glBindVertexArray( 0 );
 }
 
 /*static*/ void Drawable::SetPosHandle( GLint pH )
@@ -144,6 +328,12 @@ void Drawable::Draw()
 	s_ColorHandle = cH;
 }
 
+/*static*/ void Drawable::SetBlendHandles( GLint hBlendIdx, GLint hBlendWeight )
+{
+	s_BlendIdxHandle = hBlendIdx;
+	s_BlendWeightHandle = hBlendWeight;
+}
+
 /*static*/ bool Drawable::DrawPrimitive( std::string prim )
 {
 	auto it = s_PrimitiveMap.find( prim );
@@ -163,8 +353,13 @@ void Drawable::Draw()
 
 	pDrawableModDef->RegisterClass<Drawable>( "Drawable" );
 
-	pDrawableModDef->RegisterFunction<struct st_fnDrSetPosH>( "SetPosHandle", pyl::make_function( Drawable::SetPosHandle ) );
-	pDrawableModDef->RegisterFunction<struct st_fnDrSetClrH>( "SetColorHandle", pyl::make_function( Drawable::SetColorHandle ) );
+	pDrawableModDef->RegisterFunction<PYL_FN( Drawable::SetPosHandle )>( "SetPosHandle" );
+	pDrawableModDef->RegisterFunction<PYL_FN( Drawable::SetColorHandle )>( "SetColorHandle" );
+	pDrawableModDef->RegisterFunction<PYL_FN( Drawable::SetBlendHandles )>( "SetBlendHandles" );
+	pDrawableModDef->RegisterFunction<PYL_FN( Drawable::FreeMesh )>( "FreeMesh" );
+	pDrawableModDef->RegisterFunction<PYL_FN( Drawable::CompactMeshes )>( "CompactMeshes" );
+	pDrawableModDef->RegisterFunction<PYL_FN( Drawable::SetQuantizeMeshes )>( "SetQuantizeMeshes" );
+	pDrawableModDef->RegisterFunction<PYL_FN( Drawable::GetMeshBytesSaved )>( "GetMeshBytesSaved" );
 
 	AddMemFnToMod( Drawable, SetColor, void, pDrawableModDef, vec4 );
 }
\ No newline at end of file
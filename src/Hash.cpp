@@ -0,0 +1,30 @@
+#include "Hash.h"
+
+#include <stdio.h>
+
+uint64_t FnvHash( const void * pData, size_t uNumBytes, uint64_t uHash /*= kFnvOffsetBasis*/ )
+{
+	const uint8_t * pBytes = (const uint8_t *) pData;
+	for ( size_t i = 0; i < uNumBytes; i++ )
+	{
+		uHash ^= pBytes[i];
+		uHash *= 1099511628211ull;
+	}
+	return uHash;
+}
+
+bool FnvHashFile( const std::string strFile, uint64_t& uHash )
+{
+	FILE * fp = fopen( strFile.c_str(), "rb" );
+	if ( fp == nullptr )
+		return false;
+
+	uHash = kFnvOffsetBasis;
+	uint8_t buf[1 << 16];
+	size_t uRead( 0 );
+	while ( (uRead = fread( buf, 1, sizeof( buf ), fp )) > 0 )
+		uHash = FnvHash( buf, uRead, uHash );
+
+	fclose( fp );
+	return true;
+}
@@ -0,0 +1,284 @@
+#include "MeshArena.h"
+
+#include <algorithm>
+
+// Masks for the two halves of a handle
+static const uint32_t kSlotMask = (1u << MeshArena::kSlotBits) - 1;
+static const uint32_t kGenerationMask = (1u << (32 - MeshArena::kSlotBits)) - 1;
+
+// Smallest pool we'll make, so small meshes don't cause a string of regrows
+static const size_t kMinPoolVertices = 4096;
+static const size_t kMinPoolIndexBytes = 3 * kMinPoolVertices * sizeof( uint32_t );
+
+MeshArena::MeshArena()
+{
+}
+
+MeshArena::~MeshArena()
+{
+	// GL objects are freed in Destroy, since the context
+	// may be gone by the time we're destructed
+}
+
+MeshArena::Handle MeshArena::Add( const MeshData& mesh, GLint hPos, GLint hBlendIdx, GLint hBlendWeight )
+{
+	if ( mesh.IsValid() == false )
+		return kInvalidHandle;
+
+	const MeshData::Header& h = mesh.GetHeader();
+	const uint32_t uPool = getPool( h.uVertexFormat, h.uStride, hPos, hBlendIdx, hBlendWeight );
+
+	// Keep every index range 4 byte aligned
+	const size_t uIdxBytes = (h.uIndexBytes + 3) & ~(size_t) 3;
+
+	// Grow if we're out of room (repacking drops any holes while we're at it)
+	{
+		Pool& pool = m_vPools[uPool];
+		if ( pool.uVerticesUsed + h.uNumVertices > pool.uVertexCapacity ||
+			 pool.uIndexBytesUsed + uIdxBytes > pool.uIndexCapacity )
+		{
+			const size_t uVertexCapacity = std::max( { kMinPoolVertices, 2 * pool.uVertexCapacity, pool.uVerticesUsed + h.uNumVertices } );
+			const size_t uIndexCapacity = std::max( { kMinPoolIndexBytes, 2 * pool.uIndexCapacity, pool.uIndexBytesUsed + uIdxBytes } );
+			repack( uPool, uVertexCapacity, uIndexCapacity );
+		}
+	}
+
+	// Reuse a dead slot if there is one (its generation was bumped when it died)
+	uint32_t uSlot( 0 );
+	if ( m_vFreeSlots.empty() == false )
+	{
+		uSlot = m_vFreeSlots.back();
+		m_vFreeSlots.pop_back();
+	}
+	else
+	{
+		uSlot = (uint32_t) m_vAllocations.size();
+		if ( uSlot > kSlotMask )
+			return kInvalidHandle;
+		m_vAllocations.push_back( Allocation{} );
+	}
+
+	Pool& pool = m_vPools[uPool];
+
+	Allocation& alloc = m_vAllocations[uSlot];
+	alloc.uPool = uPool;
+	alloc.uFirstVertex = (uint32_t) pool.uVerticesUsed;
+	alloc.uNumVertices = h.uNumVertices;
+	alloc.uIdxBytes = (uint32_t) uIdxBytes;
+	alloc.bLive = true;
+	alloc.mesh.VAO = pool.VAO;
+	alloc.mesh.eIdxType = h.eIdxType;
+	alloc.mesh.nIdx = h.uNumIndices;
+	alloc.mesh.uIdxOffset = (GLuint) pool.uIndexBytesUsed;
+	alloc.mesh.iBaseVertex = (GLint) alloc.uFirstVertex;
+
+	// Upload through the copy target so no VAO's element binding is disturbed
+	glBindBuffer( GL_COPY_WRITE_BUFFER, pool.VBO );
+	glBufferSubData( GL_COPY_WRITE_BUFFER, alloc.uFirstVertex * pool.uStride, h.uVertexBytes, mesh.GetVertices() );
+	glBindBuffer( GL_COPY_WRITE_BUFFER, pool.IBO );
+	glBufferSubData( GL_COPY_WRITE_BUFFER, alloc.mesh.uIdxOffset, h.uIndexBytes, mesh.GetIndices() );
+	glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+
+	pool.uVerticesUsed += alloc.uNumVertices;
+	pool.uIndexBytesUsed += alloc.uIdxBytes;
+
+	return (Handle) ((alloc.uGeneration << kSlotBits) | uSlot);
+}
+
+bool MeshArena::Free( Handle hMesh )
+{
+	Allocation * pAlloc = getAllocation( hMesh );
+	if ( pAlloc == nullptr )
+		return false;
+
+	m_vPools[pAlloc->uPool].uNumHoles++;
+	releaseSlot( hMesh & kSlotMask );
+
+	return true;
+}
+
+const MeshArena::Mesh * MeshArena::Get( Handle hMesh ) const
+{
+	const Allocation * pAlloc = getAllocation( hMesh );
+	return pAlloc ? &pAlloc->mesh : nullptr;
+}
+
+MeshArena::Allocation * MeshArena::getAllocation( Handle hMesh )
+{
+	const uint32_t uSlot = hMesh & kSlotMask;
+	if ( hMesh == kInvalidHandle || uSlot >= m_vAllocations.size() )
+		return nullptr;
+
+	Allocation& alloc = m_vAllocations[uSlot];
+	if ( alloc.bLive == false || alloc.uGeneration != (hMesh >> kSlotBits) )
+		return nullptr;
+	return &alloc;
+}
+
+const MeshArena::Allocation * MeshArena::getAllocation( Handle hMesh ) const
+{
+	return const_cast<MeshArena *>( this )->getAllocation( hMesh );
+}
+
+void MeshArena::releaseSlot( uint32_t uSlot )
+{
+	// Skip the generation that would make kInvalidHandle
+	Allocation& alloc = m_vAllocations[uSlot];
+	alloc.bLive = false;
+	alloc.uGeneration = (alloc.uGeneration + 1) & kGenerationMask;
+	if ( ((alloc.uGeneration << kSlotBits) | uSlot) == kInvalidHandle )
+		alloc.uGeneration = 0;
+	m_vFreeSlots.push_back( uSlot );
+}
+
+void MeshArena::Compact()
+{
+	for ( uint32_t uPool = 0; uPool < m_vPools.size(); uPool++ )
+	{
+		const Pool& pool = m_vPools[uPool];
+		if ( pool.uNumHoles )
+			repack( uPool, pool.uVertexCapacity, pool.uIndexCapacity );
+	}
+}
+
+void MeshArena::Destroy()
+{
+	for ( Pool& pool : m_vPools )
+	{
+		glDeleteVertexArrays( 1, &pool.VAO );
+		glDeleteBuffers( 1, &pool.VBO );
+		glDeleteBuffers( 1, &pool.IBO );
+	}
+
+	// Nothing is live anymore
+	m_vPools.clear();
+	for ( uint32_t uSlot = 0; uSlot < m_vAllocations.size(); uSlot++ )
+		if ( m_vAllocations[uSlot].bLive )
+			releaseSlot( uSlot );
+}
+
+size_t MeshArena::GetUsedBytes() const
+{
+	size_t uBytes( 0 );
+	for ( const Allocation& alloc : m_vAllocations )
+		if ( alloc.bLive )
+			uBytes += alloc.uNumVertices * m_vPools[alloc.uPool].uStride + alloc.uIdxBytes;
+	return uBytes;
+}
+
+size_t MeshArena::GetAllocatedBytes() const
+{
+	size_t uBytes( 0 );
+	for ( const Pool& pool : m_vPools )
+		uBytes += pool.uVertexCapacity * pool.uStride + pool.uIndexCapacity;
+	return uBytes;
+}
+
+size_t MeshArena::GetNumPools() const
+{
+	return m_vPools.size();
+}
+
+uint32_t MeshArena::getPool( uint32_t uFormat, uint32_t uStride, GLint hPos, GLint hBlendIdx, GLint hBlendWeight )
+{
+	for ( uint32_t uPool = 0; uPool < m_vPools.size(); uPool++ )
+	{
+		const Pool& pool = m_vPools[uPool];
+		if ( pool.uFormat == uFormat && pool.uStride == uStride && pool.hPos == hPos &&
+			 pool.hBlendIdx == hBlendIdx && pool.hBlendWeight == hBlendWeight )
+			return uPool;
+	}
+
+	// Buffers get made on the first repack
+	Pool pool{};
+	pool.uFormat = uFormat;
+	pool.uStride = uStride;
+	pool.hPos = hPos;
+	pool.hBlendIdx = hBlendIdx;
+	pool.hBlendWeight = hBlendWeight;
+	glGenVertexArrays( 1, &pool.VAO );
+
+	m_vPools.push_back( pool );
+	return (uint32_t) (m_vPools.size() - 1);
+}
+
+void MeshArena::repack( uint32_t uPool, size_t uVertexCapacity, size_t uIndexCapacity )
+{
+	Pool& pool = m_vPools[uPool];
+
+	GLuint newBuffers[2] = { 0, 0 };
+	glGenBuffers( 2, newBuffers );
+	glBindBuffer( GL_COPY_WRITE_BUFFER, newBuffers[0] );
+	glBufferData( GL_COPY_WRITE_BUFFER, uVertexCapacity * pool.uStride, nullptr, GL_STATIC_DRAW );
+	glBindBuffer( GL_COPY_WRITE_BUFFER, newBuffers[1] );
+	glBufferData( GL_COPY_WRITE_BUFFER, uIndexCapacity, nullptr, GL_STATIC_DRAW );
+
+	// Copy every live range down into the new buffers, GPU side
+	size_t uVertexCursor( 0 ), uIndexCursor( 0 );
+	for ( Allocation& alloc : m_vAllocations )
+	{
+		if ( alloc.bLive == false || alloc.uPool != uPool )
+			continue;
+
+		glBindBuffer( GL_COPY_READ_BUFFER, pool.VBO );
+		glBindBuffer( GL_COPY_WRITE_BUFFER, newBuffers[0] );
+		glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, alloc.uFirstVertex * pool.uStride, uVertexCursor * pool.uStride, alloc.uNumVertices * pool.uStride );
+
+		glBindBuffer( GL_COPY_READ_BUFFER, pool.IBO );
+		glBindBuffer( GL_COPY_WRITE_BUFFER, newBuffers[1] );
+		glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, alloc.mesh.uIdxOffset, uIndexCursor, alloc.uIdxBytes );
+
+		alloc.uFirstVertex = (uint32_t) uVertexCursor;
+		alloc.mesh.iBaseVertex = (GLint) uVertexCursor;
+		alloc.mesh.uIdxOffset = (GLuint) uIndexCursor;
+		uVertexCursor += alloc.uNumVertices;
+		uIndexCursor += alloc.uIdxBytes;
+	}
+
+	glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+	glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+
+	// GL keeps the old buffers alive until pending draws are done with them
+	if ( pool.VBO )
+		glDeleteBuffers( 1, &pool.VBO );
+	if ( pool.IBO )
+		glDeleteBuffers( 1, &pool.IBO );
+
+	pool.VBO = newBuffers[0];
+	pool.IBO = newBuffers[1];
+	pool.uVertexCapacity = uVertexCapacity;
+	pool.uVerticesUsed = uVertexCursor;
+	pool.uIndexCapacity = uIndexCapacity;
+	pool.uIndexBytesUsed = uIndexCursor;
+	pool.uNumHoles = 0;
+
+	setupVAO( pool );
+}
+
+void MeshArena::setupVAO( Pool& pool )
+{
+	// Positions are always first in the interleaved vertex; quantized
+	// ones are normalized ushorts, and the draw matrix undoes the rest
+	glBindVertexArray( pool.VAO );
+	glBindBuffer( GL_ARRAY_BUFFER, pool.VBO );
+	glEnableVertexAttribArray( pool.hPos );
+	if ( pool.uFormat & MeshData::QuantizedPosition )
+		glVertexAttribPointer( pool.hPos, 3, GL_UNSIGNED_SHORT, GL_TRUE, pool.uStride, 0 );
+	else
+		glVertexAttribPointer( pool.hPos, 3, GL_FLOAT, GL_FALSE, pool.uStride, 0 );
+
+	// Joint indices stay integers, weights come in as [0, 1]
+	if ( (pool.uFormat & MeshData::BlendIndexes) && pool.hBlendIdx >= 0 && pool.hBlendWeight >= 0 )
+	{
+		const size_t uIdxOfs = (size_t) MeshData::GetAttrOffset( pool.uFormat, MeshData::BlendIndexes );
+		const size_t uWgtOfs = (size_t) MeshData::GetAttrOffset( pool.uFormat, MeshData::BlendWeights );
+		glEnableVertexAttribArray( pool.hBlendIdx );
+		glVertexAttribIPointer( pool.hBlendIdx, 4, GL_UNSIGNED_BYTE, pool.uStride, (GLvoid *) uIdxOfs );
+		glEnableVertexAttribArray( pool.hBlendWeight );
+		glVertexAttribPointer( pool.hBlendWeight, 4, GL_UNSIGNED_BYTE, GL_TRUE, pool.uStride, (GLvoid *) uWgtOfs );
+	}
+
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, pool.IBO );
+	glBindVertexArray( 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
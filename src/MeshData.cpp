@@ -0,0 +1,460 @@
+#include "MeshData.h"
+#include "IqmFile.h"
+#include "Hash.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static const char kMeshMagic[8] = "SDLMESH";
+static const uint32_t kMeshVersion = 4;
+
+// Read by the mesh loader thread
+static std::atomic<bool> s_bQuantize( false );
+
+// Float to half float, rounding to nearest
+static uint16_t toHalf( float f )
+{
+	uint32_t x( 0 );
+	memcpy( &x, &f, sizeof( x ) );
+
+	const uint32_t uSign = (x >> 16) & 0x8000;
+	const uint32_t uExp = (x >> 23) & 0xFF;
+	uint32_t uMant = x & 0x7FFFFF;
+
+	// Inf / NaN
+	if ( uExp == 0xFF )
+		return (uint16_t) (uSign | 0x7C00 | (uMant ? 0x200 : 0));
+
+	const int iExp = (int) uExp - 127 + 15;
+	if ( iExp >= 31 )
+		return (uint16_t) (uSign | 0x7C00);
+
+	// Too small for a normal half, make it subnormal (or zero)
+	if ( iExp <= 0 )
+	{
+		if ( iExp < -10 )
+			return (uint16_t) uSign;
+		uMant |= 0x800000;
+		const uint32_t uShift = (uint32_t) (14 - iExp);
+		uint32_t uHalf = uMant >> uShift;
+		if ( (uMant >> (uShift - 1)) & 1 )
+			uHalf++;
+		return (uint16_t) (uSign | uHalf);
+	}
+
+	// Rounding may carry into the exponent, which is what we want
+	uint32_t uHalf = uSign | ((uint32_t) iExp << 10) | (uMant >> 13);
+	if ( uMant & 0x1000 )
+		uHalf++;
+	return (uint16_t) uHalf;
+}
+
+// [-1, 1] to a normalized short
+static int16_t toSNorm16( float f )
+{
+	f = std::max( -1.f, std::min( 1.f, f ) );
+	return (int16_t) std::lround( f * 32767.f );
+}
+
+// [0, 1] to a normalized ushort
+static uint16_t toUNorm16( float f )
+{
+	f = std::max( 0.f, std::min( 1.f, f ) );
+	return (uint16_t) std::lround( f * 65535.f );
+}
+
+MeshData::MeshData()
+{
+}
+
+/*static*/ bool MeshData::StatFile( const std::string strFile, uint64_t& uSize, int64_t& iMTime )
+{
+	struct stat st;
+	if ( stat( strFile.c_str(), &st ) != 0 )
+		return false;
+
+	uSize = (uint64_t) st.st_size;
+	iMTime = (int64_t) st.st_mtime;
+	return true;
+}
+
+/*static*/ std::string MeshData::GetCachePath( const std::string strIqmFile )
+{
+	return strIqmFile.substr( 0, strIqmFile.find( ".iqm" ) ) + ".mesh";
+}
+
+/*static*/ void MeshData::SetQuantize( bool bQuantize )
+{
+	s_bQuantize = bQuantize;
+}
+
+/*static*/ bool MeshData::GetQuantize()
+{
+	return s_bQuantize;
+}
+
+/*static*/ uint32_t MeshData::GetAttrSize( uint32_t uFormat, EVertexAttr eAttr )
+{
+	if ( (uFormat & eAttr) == 0 )
+		return 0;
+
+	switch ( eAttr )
+	{
+		case Position:
+			return (uFormat & QuantizedPosition) ? 4 * sizeof( uint16_t ) : 3 * sizeof( float );
+		case Normal:
+			return (uFormat & QuantizedNormal) ? 4 * sizeof( int16_t ) : 3 * sizeof( float );
+		case TexCoord:
+			return (uFormat & HalfTexCoord) ? 2 * sizeof( uint16_t ) : 2 * sizeof( float );
+		case BlendIndexes:
+		case BlendWeights:
+			return 4 * sizeof( uint8_t );
+		default:
+			return 0;
+	}
+}
+
+/*static*/ bool MeshData::FromIQM( const std::string strIqmFile, MeshData& mesh, bool bQuantize )
+{
+	uint64_t uSrcHash( 0 ), uSrcSize( 0 );
+	int64_t iSrcMTime( 0 );
+	if ( StatFile( strIqmFile, uSrcSize, iSrcMTime ) == false || FnvHashFile( strIqmFile, uSrcHash ) == false )
+		return false;
+
+	try
+	{
+		IQMFile f( strIqmFile.c_str() );
+		auto pos = f.Positions();
+		auto nrm = f.Normals();
+		auto tex = f.TexCoords();
+		auto bIdx = f.BlendIndices();
+		auto bWgt = f.BlendWeights();
+		auto idx = f.Indices();
+		if ( pos.ptr() == nullptr || pos.count() == 0 || idx.ptr() == nullptr )
+			return false;
+
+		// Figure out the vertex layout
+		uint32_t uFormat = Position;
+		if ( nrm.ptr() )
+			uFormat |= Normal;
+		if ( tex.ptr() )
+			uFormat |= TexCoord;
+		if ( bIdx.ptr() && bWgt.ptr() )
+			uFormat |= BlendIndexes | BlendWeights;
+		if ( bQuantize )
+			uFormat |= QuantizedPosition | QuantizedNormal | HalfTexCoord;
+		uint32_t uStride( 0 );
+		for ( EVertexAttr eAttr : { Position, Normal, TexCoord, BlendIndexes, BlendWeights } )
+			uStride += GetAttrSize( uFormat, eAttr );
+
+		// Use 16 bit indices if every vertex can be addressed with them
+		const uint32_t uNumVertices = pos.count();
+		const uint32_t uNumIndices = idx.count();
+		const bool bShortIndices = uNumVertices <= 0x10000;
+		const uint32_t uIdxSize = bShortIndices ? sizeof( uint16_t ) : sizeof( uint32_t );
+
+		const uint32_t uVertexBytes = uNumVertices * uStride;
+		const uint32_t uIndexBytes = uNumIndices * uIdxSize;
+		mesh.m_vData.assign( sizeof( Header ) + uVertexBytes + uIndexBytes, 0 );
+
+		Header * pHeader = mesh.header();
+		memcpy( pHeader->magic, kMeshMagic, sizeof( pHeader->magic ) );
+		pHeader->uVersion = kMeshVersion;
+		pHeader->uVertexFormat = uFormat;
+		pHeader->uStride = uStride;
+		pHeader->uNumVertices = uNumVertices;
+		pHeader->uNumIndices = uNumIndices;
+		pHeader->eIdxType = bShortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		pHeader->uVertexBytes = uVertexBytes;
+		pHeader->uIndexBytes = uIndexBytes;
+		const uint32_t uUnpackedFormat = uFormat & ~(QuantizedPosition | QuantizedNormal | HalfTexCoord);
+		uint32_t uUnpackedStride( 0 );
+		for ( EVertexAttr eAttr : { Position, Normal, TexCoord, BlendIndexes, BlendWeights } )
+			uUnpackedStride += GetAttrSize( uUnpackedFormat, eAttr );
+		pHeader->uUnpackedBytes = uNumVertices * uUnpackedStride + uNumIndices * sizeof( uint32_t );
+		pHeader->uSrcHash = uSrcHash;
+		pHeader->uSrcSize = uSrcSize;
+		pHeader->iSrcMTime = iSrcMTime;
+
+		// Find the bounds of the positions, and grow them to the file's bounds if
+		// it has them (quantized positions have to fit, so we can't just use those)
+		vec3 v3Min( pos[0].x, pos[0].y, pos[0].z ), v3Max( v3Min );
+		for ( uint32_t i = 1; i < uNumVertices; i++ )
+		{
+			const vec3 p( pos[i].x, pos[i].y, pos[i].z );
+			v3Min = glm::min( v3Min, p );
+			v3Max = glm::max( v3Max, p );
+		}
+		auto bounds = f.Bounds();
+		if ( bounds.ptr() )
+		{
+			v3Min = glm::min( v3Min, vec3( bounds[0].bbmin[0], bounds[0].bbmin[1], bounds[0].bbmin[2] ) );
+			v3Max = glm::max( v3Max, vec3( bounds[0].bbmax[0], bounds[0].bbmax[1], bounds[0].bbmax[2] ) );
+		}
+		for ( int i = 0; i < 3; i++ )
+		{
+			pHeader->fBoundsMin[i] = v3Min[i];
+			pHeader->fBoundsMax[i] = v3Max[i];
+		}
+
+		// Quantized positions are stored relative to the bounds
+		const vec3 v3Extent = v3Max - v3Min;
+		const vec3 v3InvExtent( v3Extent.x > 0 ? 1.f / v3Extent.x : 0.f,
+								v3Extent.y > 0 ? 1.f / v3Extent.y : 0.f,
+								v3Extent.z > 0 ? 1.f / v3Extent.z : 0.f );
+
+		// Interleave the vertex attributes
+		uint8_t * pVertex = &mesh.m_vData[sizeof( Header )];
+		for ( uint32_t v = 0; v < uNumVertices; v++ )
+		{
+			if ( uFormat & QuantizedPosition )
+			{
+				const vec3 p = (vec3( pos[v].x, pos[v].y, pos[v].z ) - v3Min) * v3InvExtent;
+				const uint16_t q[4] = { toUNorm16( p.x ), toUNorm16( p.y ), toUNorm16( p.z ), 0 };
+				memcpy( pVertex, q, sizeof( q ) );
+			}
+			else
+				memcpy( pVertex, &pos[v], sizeof( IQMFile::iqmposition ) );
+			pVertex += GetAttrSize( uFormat, Position );
+
+			if ( uFormat & Normal )
+			{
+				if ( uFormat & QuantizedNormal )
+				{
+					const int16_t q[4] = { toSNorm16( nrm[v].nX ), toSNorm16( nrm[v].nY ), toSNorm16( nrm[v].nZ ), 0 };
+					memcpy( pVertex, q, sizeof( q ) );
+				}
+				else
+					memcpy( pVertex, &nrm[v], sizeof( IQMFile::iqmnormal ) );
+				pVertex += GetAttrSize( uFormat, Normal );
+			}
+
+			if ( uFormat & TexCoord )
+			{
+				if ( uFormat & HalfTexCoord )
+				{
+					const uint16_t q[2] = { toHalf( tex[v].u ), toHalf( tex[v].v ) };
+					memcpy( pVertex, q, sizeof( q ) );
+				}
+				else
+					memcpy( pVertex, &tex[v], sizeof( IQMFile::iqmtexcoord ) );
+				pVertex += GetAttrSize( uFormat, TexCoord );
+			}
+
+			// Skinning data is already as small as it gets
+			if ( uFormat & BlendIndexes )
+			{
+				memcpy( pVertex, &bIdx[v], sizeof( IQMFile::iqmblendidx ) );
+				pVertex += GetAttrSize( uFormat, BlendIndexes );
+				memcpy( pVertex, &bWgt[v], sizeof( IQMFile::iqmblendweight ) );
+				pVertex += GetAttrSize( uFormat, BlendWeights );
+			}
+		}
+
+		// Copy or narrow the indices
+		uint8_t * pIndices = &mesh.m_vData[sizeof( Header ) + uVertexBytes];
+		if ( bShortIndices )
+		{
+			for ( uint32_t i = 0; i < uNumIndices; i++ )
+				((uint16_t *) pIndices)[i] = (uint16_t) idx[i];
+		}
+		else
+			memcpy( pIndices, idx.ptr(), uIndexBytes );
+
+		pHeader->uDataHash = FnvHash( &mesh.m_vData[sizeof( Header )], uVertexBytes + uIndexBytes );
+	}
+	catch ( std::runtime_error )
+	{
+		mesh.m_vData.clear();
+		return false;
+	}
+
+	return true;
+}
+
+/*static*/ bool MeshData::LoadCached( const std::string strIqmFile, MeshData& mesh )
+{
+	uint64_t uSrcSize( 0 );
+	int64_t iSrcMTime( 0 );
+	if ( StatFile( strIqmFile, uSrcSize, iSrcMTime ) == false )
+		return false;
+
+	// The cache has to be quantized (or not) the way we want
+	const bool bQuantize = s_bQuantize;
+	const std::string strMeshFile = GetCachePath( strIqmFile );
+	if ( Load( strMeshFile, mesh ) && mesh.IsQuantized() == bQuantize )
+	{
+		// If the source looks the same as when the cache was made, it's good
+		Header * pHeader = mesh.header();
+		if ( pHeader->uSrcSize == uSrcSize && pHeader->iSrcMTime == iSrcMTime )
+			return true;
+
+		// Otherwise see if its contents changed (it may have only been touched)
+		uint64_t uSrcHash( 0 );
+		if ( FnvHashFile( strIqmFile, uSrcHash ) && pHeader->uSrcHash == uSrcHash )
+		{
+			// Stamp the cache so we don't hash it again next time
+			pHeader->uSrcSize = uSrcSize;
+			pHeader->iSrcMTime = iSrcMTime;
+			if ( mesh.Save( strMeshFile ) == false )
+				std::cout << "Warning: unable to write mesh cache " << strMeshFile << std::endl;
+			return true;
+		}
+	}
+
+	if ( FromIQM( strIqmFile, mesh, bQuantize ) == false )
+		return false;
+
+	// Not being able to write the cache isn't an error
+	if ( mesh.Save( strMeshFile ) == false )
+		std::cout << "Warning: unable to write mesh cache " << strMeshFile << std::endl;
+
+	return true;
+}
+
+/*static*/ bool MeshData::Load( const std::string strMeshFile, MeshData& mesh )
+{
+	FILE * fp = fopen( strMeshFile.c_str(), "rb" );
+	if ( fp == nullptr )
+		return false;
+
+	// Read the whole thing in one go
+	fseek( fp, 0, SEEK_END );
+	const long lFileSize = ftell( fp );
+	fseek( fp, 0, SEEK_SET );
+
+	bool bSuccess = false;
+	if ( lFileSize > 0 )
+	{
+		mesh.m_vData.resize( (size_t) lFileSize );
+		bSuccess = fread( mesh.m_vData.data(), 1, mesh.m_vData.size(), fp ) == mesh.m_vData.size() &&
+			mesh.validate( mesh.m_vData.size() );
+	}
+	fclose( fp );
+
+	if ( bSuccess == false )
+		mesh.m_vData.clear();
+
+	return bSuccess;
+}
+
+bool MeshData::Save( const std::string strMeshFile ) const
+{
+	if ( IsValid() == false )
+		return false;
+
+	FILE * fp = fopen( strMeshFile.c_str(), "wb" );
+	if ( fp == nullptr )
+		return false;
+
+	const bool bSuccess = fwrite( m_vData.data(), 1, m_vData.size(), fp ) == m_vData.size();
+	fclose( fp );
+
+	return bSuccess;
+}
+
+bool MeshData::validate( size_t uNumBytes ) const
+{
+	if ( uNumBytes < sizeof( Header ) )
+		return false;
+
+	const Header& h = GetHeader();
+	if ( memcmp( h.magic, kMeshMagic, sizeof( h.magic ) ) != 0 || h.uVersion != kMeshVersion )
+		return false;
+
+	if ( (h.uVertexFormat & Position) == 0 || h.uStride == 0 )
+		return false;
+
+	const size_t uIdxSize = h.eIdxType == GL_UNSIGNED_SHORT ? sizeof( uint16_t ) : sizeof( uint32_t );
+	if ( (size_t) h.uVertexBytes != (size_t) h.uNumVertices * h.uStride ||
+		 (size_t) h.uIndexBytes != (size_t) h.uNumIndices * uIdxSize ||
+		 sizeof( Header ) + h.uVertexBytes + h.uIndexBytes != uNumBytes )
+		return false;
+
+	return FnvHash( GetVertices(), h.uVertexBytes + h.uIndexBytes ) == h.uDataHash;
+}
+
+bool MeshData::IsValid() const
+{
+	return m_vData.size() >= sizeof( Header );
+}
+
+const MeshData::Header& MeshData::GetHeader() const
+{
+	return *(const Header *) m_vData.data();
+}
+
+MeshData::Header * MeshData::header()
+{
+	return (Header *) m_vData.data();
+}
+
+const uint8_t * MeshData::GetVertices() const
+{
+	return m_vData.data() + sizeof( Header );
+}
+
+const uint8_t * MeshData::GetIndices() const
+{
+	return GetVertices() + GetHeader().uVertexBytes;
+}
+
+vec3 MeshData::GetBoundsMin() const
+{
+	const Header& h = GetHeader();
+	return vec3( h.fBoundsMin[0], h.fBoundsMin[1], h.fBoundsMin[2] );
+}
+
+vec3 MeshData::GetBoundsMax() const
+{
+	const Header& h = GetHeader();
+	return vec3( h.fBoundsMax[0], h.fBoundsMax[1], h.fBoundsMax[2] );
+}
+
+bool MeshData::IsQuantized() const
+{
+	return (GetHeader().uVertexFormat & QuantizedPosition) != 0;
+}
+
+mat4 MeshData::GetDequantMat() const
+{
+	// Normalized ushorts come in as [0, 1] across the bounds
+	if ( IsQuantized() == false )
+		return mat4( 1 );
+	return glm::translate( GetBoundsMin() ) * glm::scale( GetBoundsMax() - GetBoundsMin() );
+}
+
+size_t MeshData::GetBytesSaved() const
+{
+	const Header& h = GetHeader();
+	return h.uUnpackedBytes - (h.uVertexBytes + h.uIndexBytes);
+}
+
+int MeshData::GetAttrOffset( EVertexAttr eAttr ) const
+{
+	return GetAttrOffset( GetHeader().uVertexFormat, eAttr );
+}
+
+/*static*/ int MeshData::GetAttrOffset( uint32_t uFormat, EVertexAttr eAttr )
+{
+	if ( (uFormat & eAttr) == 0 )
+		return -1;
+
+	// Attributes are packed in enum order
+	int iOffset( 0 );
+	for ( EVertexAttr eCur : { Position, Normal, TexCoord, BlendIndexes, BlendWeights } )
+	{
+		if ( eCur == eAttr )
+			return iOffset;
+		iOffset += GetAttrSize( uFormat, eCur );
+	}
+	return -1;
+}
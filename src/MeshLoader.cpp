@@ -0,0 +1,22 @@
+#include "MeshLoader.h"
+
+MeshLoader::MeshLoader() :
+	m_Loader( &MeshLoader::LoadMesh )
+{
+}
+
+/*static*/ void MeshLoader::LoadMesh( const std::string& strIqmFile, Loaded& loaded )
+{
+	loaded.strIqmFile = strIqmFile;
+	loaded.bSuccess = MeshData::LoadCached( strIqmFile, loaded.mesh );
+}
+
+void MeshLoader::Request( const std::string strIqmFile )
+{
+	m_Loader.Request( strIqmFile );
+}
+
+void MeshLoader::TakeLoaded( std::list<Loaded>& liLoaded )
+{
+	m_Loader.TakeLoaded( liLoaded );
+}
@@ -0,0 +1,254 @@
+#include "RTCheck.h"
+
+// Nothing in here gets compiled unless the RT_CHECK option is on
+#ifdef RT_CHECK_ENABLED
+
+#include <atomic>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <execinfo.h>
+#include <unistd.h>
+#endif
+
+// On glibc we can get at the real allocator and hook malloc as well
+#ifdef __GLIBC__
+extern "C" void * __libc_malloc( size_t );
+extern "C" void * __libc_calloc( size_t, size_t );
+extern "C" void * __libc_realloc( void *, size_t );
+extern "C" void __libc_free( void * );
+#endif
+
+namespace RTCheck
+{
+	// The size of the violation buffer; anything past this is counted but dropped
+	const size_t kMaxViolations = 256;
+
+	// Each slot gets a flag so readers don't see half written records
+	struct ViolationSlot
+	{
+		std::atomic<bool> bReady{ false };
+		Violation V;
+	};
+
+	static ViolationSlot s_aViolations[kMaxViolations];
+	static std::atomic<size_t> s_uNumViolations( 0 );
+
+	// Whether this thread is the audio thread, and whether we're already reporting
+	// (capturing a backtrace can allocate, and we don't want to recurse on that)
+	static thread_local bool tl_bAudioThread( false );
+	static thread_local bool tl_bInReport( false );
+
+	static int captureBacktrace( void ** ppFrames, int nMaxFrames )
+	{
+#ifdef _WIN32
+		return (int) CaptureStackBackTrace( 0, (DWORD) nMaxFrames, ppFrames, nullptr );
+#else
+		return backtrace( ppFrames, nMaxFrames );
+#endif
+	}
+
+	// The first call to backtrace may load libgcc (and allocate), so get that out of the way at startup
+	static const int s_nPrimeBacktrace = [] ()
+	{
+		void * apFrames[1];
+		return captureBacktrace( apFrames, 1 );
+	}();
+
+	void SetAudioThread( bool bAudioThread )
+	{
+		tl_bAudioThread = bAudioThread;
+	}
+
+	bool IsAudioThread()
+	{
+		return tl_bAudioThread;
+	}
+
+	void Report( EViolation eType, size_t uSize /*= 0*/ )
+	{
+		if ( tl_bAudioThread == false || tl_bInReport )
+			return;
+
+		tl_bInReport = true;
+
+		// Grab a slot, and fill it if it's in range
+		const size_t uIdx = s_uNumViolations.fetch_add( 1 );
+		if ( uIdx < kMaxViolations )
+		{
+			ViolationSlot& slot = s_aViolations[uIdx];
+			slot.V.eType = eType;
+			slot.V.uSize = uSize;
+			slot.V.nFrames = captureBacktrace( slot.V.apFrames, kMaxFrames );
+			slot.bReady.store( true, std::memory_order_release );
+		}
+
+		tl_bInReport = false;
+	}
+
+	size_t GetNumViolations()
+	{
+		return s_uNumViolations.load();
+	}
+
+	bool GetViolation( size_t uIdx, Violation& v )
+	{
+		if ( uIdx >= kMaxViolations || uIdx >= s_uNumViolations.load() )
+			return false;
+
+		const ViolationSlot& slot = s_aViolations[uIdx];
+		if ( slot.bReady.load( std::memory_order_acquire ) == false )
+			return false;
+
+		v = slot.V;
+		return true;
+	}
+
+	void PrintViolations()
+	{
+		const size_t uNumViolations = GetNumViolations();
+		printf( "%zu real-time violations on the audio thread\n", uNumViolations );
+
+		for ( size_t uIdx = 0; uIdx < uNumViolations && uIdx < kMaxViolations; uIdx++ )
+		{
+			Violation v;
+			if ( GetViolation( uIdx, v ) == false )
+				continue;
+
+			const char * szType = "unknown";
+			switch ( v.eType )
+			{
+				case EViolation::Alloc:
+					szType = "alloc";
+					break;
+				case EViolation::Free:
+					szType = "free";
+					break;
+				case EViolation::Lock:
+					szType = "lock";
+					break;
+				default:
+					break;
+			}
+
+			printf( "Violation %zu: %s (%zu bytes)\n", uIdx, szType, v.uSize );
+			fflush( stdout );
+#ifdef _WIN32
+			for ( int i = 0; i < v.nFrames; i++ )
+				printf( "\t%p\n", v.apFrames[i] );
+#else
+			backtrace_symbols_fd( v.apFrames, v.nFrames, STDOUT_FILENO );
+#endif
+		}
+
+		if ( uNumViolations > kMaxViolations )
+			printf( "(%zu violations dropped)\n", uNumViolations - kMaxViolations );
+	}
+
+	// Only call this while the audio thread isn't running
+	void Reset()
+	{
+		for ( ViolationSlot& slot : s_aViolations )
+			slot.bReady.store( false );
+		s_uNumViolations.store( 0 );
+	}
+}
+
+// Raw allocation functions that don't go through the hooks below
+static void * rawMalloc( size_t uSize )
+{
+#ifdef __GLIBC__
+	return __libc_malloc( uSize );
+#else
+	return malloc( uSize );
+#endif
+}
+
+static void rawFree( void * ptr )
+{
+#ifdef __GLIBC__
+	__libc_free( ptr );
+#else
+	free( ptr );
+#endif
+}
+
+// Global operator new / delete replacements
+void * operator new( size_t uSize )
+{
+	RTCheck::Report( RTCheck::EViolation::Alloc, uSize );
+	if ( void * ptr = rawMalloc( uSize ? uSize : 1 ) )
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void * operator new[]( size_t uSize )
+{
+	RTCheck::Report( RTCheck::EViolation::Alloc, uSize );
+	if ( void * ptr = rawMalloc( uSize ? uSize : 1 ) )
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete( void * ptr ) noexcept
+{
+	if ( ptr )
+		RTCheck::Report( RTCheck::EViolation::Free );
+	rawFree( ptr );
+}
+
+void operator delete[]( void * ptr ) noexcept
+{
+	if ( ptr )
+		RTCheck::Report( RTCheck::EViolation::Free );
+	rawFree( ptr );
+}
+
+void operator delete( void * ptr, size_t uSize ) noexcept
+{
+	if ( ptr )
+		RTCheck::Report( RTCheck::EViolation::Free, uSize );
+	rawFree( ptr );
+}
+
+void operator delete[]( void * ptr, size_t uSize ) noexcept
+{
+	if ( ptr )
+		RTCheck::Report( RTCheck::EViolation::Free, uSize );
+	rawFree( ptr );
+}
+
+// On glibc the C allocator can be replaced as well, which catches
+// anything allocating through malloc directly (SDL, python, etc.)
+#ifdef __GLIBC__
+extern "C" void * malloc( size_t uSize )
+{
+	RTCheck::Report( RTCheck::EViolation::Alloc, uSize );
+	return __libc_malloc( uSize );
+}
+
+extern "C" void * calloc( size_t uNum, size_t uSize )
+{
+	RTCheck::Report( RTCheck::EViolation::Alloc, uNum * uSize );
+	return __libc_calloc( uNum, uSize );
+}
+
+extern "C" void * realloc( void * ptr, size_t uSize )
+{
+	RTCheck::Report( RTCheck::EViolation::Alloc, uSize );
+	return __libc_realloc( ptr, uSize );
+}
+
+extern "C" void free( void * ptr )
+{
+	if ( ptr )
+		RTCheck::Report( RTCheck::EViolation::Free );
+	__libc_free( ptr );
+}
+#endif // __GLIBC__
+
+#endif // RT_CHECK_ENABLED
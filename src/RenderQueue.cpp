@@ -0,0 +1,177 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstddef>
+
+// Used when we don't know what's bound
+static const GLuint kUnknownBinding = ~0u;
+
+RenderQueue::RenderQueue() :
+	m_CurProgram( kUnknownBinding ),
+	m_CurVAO( kUnknownBinding ),
+	m_CurArrayBuffer( kUnknownBinding )
+{
+}
+
+bool RenderQueue::Init()
+{
+	// Ring buffer for per instance data, three frames in flight
+	return m_InstanceStream.Init( GL_ARRAY_BUFFER, 256 * sizeof( InstanceData ), 3 );
+}
+
+void RenderQueue::Destroy()
+{
+	m_InstanceStream.Destroy();
+}
+
+/*static*/ uint64_t RenderQueue::MakeKey( GLuint Program, GLuint VAO )
+{
+	// Most expensive state change in the highest bits; both
+	// names fit whole, so different state never shares a key
+	return ((uint64_t) Program << 32) | (uint64_t) VAO;
+}
+
+void RenderQueue::Submit( const DrawPacket& packet )
+{
+	m_vOrder.emplace_back( packet.uKey, packet.uMesh, (uint32_t) m_vPackets.size() );
+	m_vPackets.push_back( packet );
+}
+
+void RenderQueue::bindProgram( GLuint Program )
+{
+	if ( Program == m_CurProgram )
+	{
+		m_Stats.nBindsSkipped++;
+		return;
+	}
+
+	glUseProgram( Program );
+	m_CurProgram = Program;
+	m_Stats.nBinds++;
+}
+
+void RenderQueue::bindVAO( GLuint VAO )
+{
+	if ( VAO == m_CurVAO )
+	{
+		m_Stats.nBindsSkipped++;
+		return;
+	}
+
+	glBindVertexArray( VAO );
+	m_CurVAO = VAO;
+	m_Stats.nBinds++;
+}
+
+void RenderQueue::bindArrayBuffer( GLuint Buffer )
+{
+	if ( Buffer == m_CurArrayBuffer )
+	{
+		m_Stats.nBindsSkipped++;
+		return;
+	}
+
+	glBindBuffer( GL_ARRAY_BUFFER, Buffer );
+	m_CurArrayBuffer = Buffer;
+	m_Stats.nBinds++;
+}
+
+void RenderQueue::Flush()
+{
+	m_Stats = Stats();
+	m_Stats.nPackets = (int) m_vPackets.size();
+	if ( m_vPackets.empty() )
+		return;
+
+	// Sort by key, then mesh, ties broken by submission order
+	std::sort( m_vOrder.begin(), m_vOrder.end() );
+
+	// Write instance data in sorted order, so runs are contiguous
+	const size_t uNumBytes = m_vPackets.size() * sizeof( InstanceData );
+	InstanceData * pInstanceData = nullptr;
+	if ( m_InstanceStream.Reserve( uNumBytes ) )
+		pInstanceData = (InstanceData *) m_InstanceStream.BeginFrame();
+	if ( pInstanceData == nullptr )
+	{
+		m_vPackets.clear();
+		m_vOrder.clear();
+		return;
+	}
+
+	for ( size_t uIdx = 0; uIdx < m_vOrder.size(); uIdx++ )
+		pInstanceData[uIdx] = m_vPackets[std::get<2>( m_vOrder[uIdx] )].instance;
+	m_InstanceStream.EndWrite( uNumBytes );
+
+	// We don't know what's bound coming in
+	m_CurProgram = m_CurVAO = m_CurArrayBuffer = kUnknownBinding;
+	bindArrayBuffer( m_InstanceStream.GetBuffer() );
+
+	// Two packets can share a draw call if they only differ by instance data
+	auto sameDraw = [] ( const DrawPacket& a, const DrawPacket& b )
+	{
+		return a.Program == b.Program && a.VAO == b.VAO && a.eIdxType == b.eIdxType &&
+			a.nIdx == b.nIdx && a.uIdxOffset == b.uIdxOffset && a.iBaseVertex == b.iBaseVertex;
+	};
+
+	for ( size_t uRunBegin = 0; uRunBegin < m_vOrder.size(); )
+	{
+		// Find the end of the run of packets drawing the same thing
+		const DrawPacket& packet = m_vPackets[std::get<2>( m_vOrder[uRunBegin] )];
+		size_t uRunEnd = uRunBegin + 1;
+		while ( uRunEnd < m_vOrder.size() && sameDraw( packet, m_vPackets[std::get<2>( m_vOrder[uRunEnd] )] ) )
+			uRunEnd++;
+
+		bindProgram( packet.Program );
+		bindVAO( packet.VAO );
+
+		// Point the instance attributes at this run's data (a mat4 takes 4 attribute slots)
+		const size_t uBaseOffset = m_InstanceStream.GetFrameOffset() + uRunBegin * sizeof( InstanceData );
+		for ( GLuint uCol = 0; uCol < 4; uCol++ )
+		{
+			const GLuint uAttr = packet.hInstPMV + uCol;
+			glEnableVertexAttribArray( uAttr );
+			glVertexAttribPointer( uAttr, 4, GL_FLOAT, GL_FALSE, sizeof( InstanceData ), (GLvoid *) (uBaseOffset + uCol * sizeof( vec4 )) );
+			glVertexAttribDivisor( uAttr, 1 );
+			m_Stats.nStateChanges++;
+		}
+		glEnableVertexAttribArray( packet.hInstColor );
+		glVertexAttribPointer( packet.hInstColor, 4, GL_FLOAT, GL_FALSE, sizeof( InstanceData ), (GLvoid *) (uBaseOffset + offsetof( InstanceData, v4Color )) );
+		glVertexAttribDivisor( packet.hInstColor, 1 );
+		m_Stats.nStateChanges++;
+
+		const GLsizei nInstances = (GLsizei) (uRunEnd - uRunBegin);
+		if ( packet.iBaseVertex )
+			glDrawElementsInstancedBaseVertex( GL_TRIANGLES, packet.nIdx, packet.eIdxType, (GLvoid *) (size_t) packet.uIdxOffset, nInstances, packet.iBaseVertex );
+		else
+			glDrawElementsInstanced( GL_TRIANGLES, packet.nIdx, packet.eIdxType, (GLvoid *) (size_t) packet.uIdxOffset, nInstances );
+		m_Stats.nDraws++;
+
+		uRunBegin = uRunEnd;
+	}
+
+	// Leave things unbound
+	bindVAO( 0 );
+	bindArrayBuffer( 0 );
+
+	// Fence this frame's region so we don't overwrite it while it's in flight
+	m_InstanceStream.EndFrame();
+
+	m_vPackets.clear();
+	m_vOrder.clear();
+}
+
+const RenderQueue::Stats& RenderQueue::GetStats() const
+{
+	return m_Stats;
+}
+
+std::map<std::string, int> RenderQueue::GetStatsMap() const
+{
+	return{
+		{ "packets", m_Stats.nPackets },
+		{ "draws", m_Stats.nDraws },
+		{ "binds", m_Stats.nBinds },
+		{ "bindsSkipped", m_Stats.nBindsSkipped },
+		{ "stateChanges", m_Stats.nStateChanges }
+	};
+}
@@ -0,0 +1,197 @@
+#include "RenderThread.h"
+#include "Trace.h"
+
+/*static*/ RenderThread * RenderThread::s_pRunning( nullptr );
+
+void FrameCommands::Clear()
+{
+	// Keep the capacity around, it'll be about the same next frame
+	vPackets.clear();
+	vSkinned.clear();
+	vPaletteRanges.clear();
+	vPalettes.clear();
+	vVisualizers.clear();
+	vVisualizerVerts.clear();
+}
+
+RenderThread::RenderThread() :
+	m_pWindow( nullptr ),
+	m_GLContext( nullptr ),
+	m_bQuit( false ),
+	m_iStartResult( 0 ),
+	m_bHasPending( false ),
+	m_uNumWaits( 0 ),
+	m_uNumTasks( 0 )
+{
+}
+
+RenderThread::~RenderThread()
+{
+	Stop();
+}
+
+bool RenderThread::Start( SDL_Window * pWindow, SDL_GLContext glContext, ExecuteFn fnExecute )
+{
+	if ( IsRunning() || s_pRunning || pWindow == nullptr || glContext == nullptr || !fnExecute )
+		return false;
+
+	m_pWindow = pWindow;
+	m_GLContext = glContext;
+	m_fnExecute = fnExecute;
+	m_bQuit = false;
+	m_iStartResult = 0;
+	m_bHasPending = false;
+
+	// A context can only be current on one thread at a time
+	if ( SDL_GL_MakeCurrent( m_pWindow, nullptr ) != 0 )
+		return false;
+
+	m_thRender = std::thread( &RenderThread::renderThread, this );
+
+	// Wait to hear whether the render thread got the context
+	bool bStarted( false );
+	{
+		std::unique_lock<std::mutex> lk( m_muRender );
+		m_cvMain.wait( lk, [this] () { return m_iStartResult != 0; } );
+		bStarted = m_iStartResult > 0;
+	}
+
+	if ( bStarted == false )
+	{
+		std::cout << "Error: unable to make the GL context current on the render thread: " << SDL_GetError() << std::endl;
+		m_thRender.join();
+		SDL_GL_MakeCurrent( m_pWindow, m_GLContext );
+		return false;
+	}
+
+	s_pRunning = this;
+	return true;
+}
+
+void RenderThread::Stop()
+{
+	if ( IsRunning() == false )
+		return;
+
+	// The render thread finishes what it has before exiting
+	{
+		std::lock_guard<std::mutex> lg( m_muRender );
+		m_bQuit = true;
+	}
+	m_cvRender.notify_all();
+	m_thRender.join();
+
+	s_pRunning = nullptr;
+	SDL_GL_MakeCurrent( m_pWindow, m_GLContext );
+}
+
+bool RenderThread::IsRunning() const
+{
+	return m_thRender.joinable();
+}
+
+void RenderThread::Submit( FrameCommands& cmds )
+{
+	{
+		std::unique_lock<std::mutex> lk( m_muRender );
+
+		// Only wait if the last frame hasn't even been picked up
+		if ( m_bHasPending )
+		{
+			TRACE_SCOPE( "RenderThread::Wait" );
+			m_uNumWaits++;
+			m_cvMain.wait( lk, [this] () { return m_bHasPending == false; } );
+		}
+
+		// We get back the buffers of an older frame to record into
+		std::swap( cmds, m_Pending );
+		m_bHasPending = true;
+	}
+	m_cvRender.notify_one();
+
+	cmds.Clear();
+}
+
+/*static*/ void RenderThread::RunSync( std::function<void()> fn )
+{
+	// Without a render thread (or if we're on it), the context is ours
+	RenderThread * pRT = s_pRunning;
+	if ( pRT == nullptr || std::this_thread::get_id() == pRT->m_thRender.get_id() )
+	{
+		fn();
+		return;
+	}
+
+	Task task{ fn, false };
+	std::unique_lock<std::mutex> lk( pRT->m_muRender );
+	pRT->m_liTasks.push_back( &task );
+	pRT->m_cvRender.notify_one();
+	pRT->m_cvMain.wait( lk, [&task] () { return task.bDone; } );
+}
+
+size_t RenderThread::GetNumWaits() const
+{
+	std::lock_guard<std::mutex> lg( m_muRender );
+	return m_uNumWaits;
+}
+
+size_t RenderThread::GetNumTasks() const
+{
+	std::lock_guard<std::mutex> lg( m_muRender );
+	return m_uNumTasks;
+}
+
+void RenderThread::renderThread()
+{
+	Trace::SetThreadName( "render" );
+
+	const bool bCurrent = SDL_GL_MakeCurrent( m_pWindow, m_GLContext ) == 0;
+	{
+		std::lock_guard<std::mutex> lg( m_muRender );
+		m_iStartResult = bCurrent ? 1 : -1;
+	}
+	m_cvMain.notify_all();
+	if ( bCurrent == false )
+		return;
+
+	std::unique_lock<std::mutex> lk( m_muRender );
+	while ( true )
+	{
+		// Wait for something to do
+		m_cvRender.wait( lk, [this] () { return m_bQuit || m_bHasPending || m_liTasks.empty() == false; } );
+
+		// The pending frame goes first; it was submitted before any task
+		// waiting now (the main thread blocks in RunSync), and a task can
+		// move meshes around in ways the frame wasn't recorded against
+		if ( m_bHasPending )
+		{
+			std::swap( m_Pending, m_Executing );
+			m_bHasPending = false;
+			lk.unlock();
+			m_cvMain.notify_all();
+
+			m_fnExecute( m_Executing );
+
+			lk.lock();
+		}
+		else if ( m_liTasks.empty() == false )
+		{
+			Task * pTask = m_liTasks.front();
+			m_liTasks.pop_front();
+			lk.unlock();
+
+			pTask->fn();
+
+			lk.lock();
+			pTask->bDone = true;
+			m_uNumTasks++;
+			m_cvMain.notify_all();
+		}
+		else if ( m_bQuit )
+			break;
+	}
+	lk.unlock();
+
+	// Give the context back so Stop can make it current again
+	SDL_GL_MakeCurrent( m_pWindow, nullptr );
+}
@@ -1,18 +1,49 @@
 #include "Scene.h"
+#include "Trace.h"
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <cstring>
+
 Scene::Scene( pyl::Object obInitScript ) :
 	m_bQuitFlag( false ),
 	m_GLContext( nullptr ),
 	m_pWindow( nullptr ),
-	m_obDriverScript( obInitScript )
+	m_obDriverScript( obInitScript ),
+	m_hInstPMV( -1 ),
+	m_hInstColor( -1 ),
+	m_iSlotPMV( -1 ),
+	m_iSlotColor( -1 ),
+	m_bInstanceHandlesQueried( false ),
+	m_nVisible( 0 ),
+	m_nCulled( 0 ),
+	m_iSkinSlotPMV( -1 ),
+	m_iSkinSlotColor( -1 ),
+	m_iSkinSlotDequant( -1 ),
+	m_bSkinHandlesQueried( false ),
+	m_tpLastDraw( std::chrono::steady_clock::now() ),
+	m_hPos( -1 ),
+	m_VisualizerVAO( 0 ),
+	m_iVisualizerUpdateUs( 0 ),
+	m_iVisualizerUploadUs( 0 )
 {
 	m_obDriverScript.call_function( "Initialize", this );
 }
 
 Scene::~Scene()
 {
+	// Get the context back, then free GL objects while it's alive
+	m_RenderThread.Stop();
+	m_RenderQueue.Destroy();
+	m_Animator.Destroy();
+	m_VisualizerStream.Destroy();
+	if ( m_VisualizerVAO )
+	{
+		glDeleteVertexArrays( 1, &m_VisualizerVAO );
+		m_VisualizerVAO = 0;
+	}
+	Drawable::DestroyMeshes();
 	if ( m_pWindow )
 	{
 		SDL_DestroyWindow( m_pWindow );
@@ -27,30 +58,289 @@ Scene::~Scene()
 
 void Scene::Draw()
 {
+	TRACE_SCOPE( "Scene::Draw" );
+
+	// Upload any meshes that finished loading
+	uploadLoadedMeshes();
+
+	// Record the frame, then draw it here or hand it to the render thread
+	recordFrame( m_FrameCommands );
+	if ( m_RenderThread.IsRunning() )
+		m_RenderThread.Submit( m_FrameCommands );
+	else
+	{
+		executeFrame( m_FrameCommands );
+		m_FrameCommands.Clear();
+	}
+}
+
+void Scene::recordFrame( FrameCommands& cmds )
+{
+	TRACE_SCOPE( "Scene::recordFrame" );
+
+	// Step animations by the time since the last frame (clamped, so a hitch doesn't skip ahead)
+	const auto tpNow = std::chrono::steady_clock::now();
+	const float fDT = std::min( std::chrono::duration<float>( tpNow - m_tpLastDraw ).count(), 0.25f );
+	m_tpLastDraw = tpNow;
+	m_Animator.Update( fDT );
+
+	// Rebuild the model matrices of anything that moved,
+	// then skip anything the camera can't see
+	m_TransformStore.Update();
+	m_nVisible = (int) m_TransformStore.Cull( m_Camera.GetFrustumPlanes() );
+	m_nCulled = (int) m_TransformStore.Size() - m_nVisible;
+
+	const mat4 P = m_Camera.GetMat();
+	const GLuint Program = m_Shader.GetProgram();
+	const GLuint SkinProgram = m_SkinShader.GetProgram();
+	for ( const Drawable& dr : m_vDrawables )
+	{
+		const MeshArena::Mesh * pMesh = dr.GetMesh();
+		if ( pMesh == nullptr || dr.IsVisible() == false )
+			continue;
+
+		// Meshes share a VAO per vertex format, so they're told apart by their handles
+		RenderQueue::DrawPacket packet;
+		packet.uMesh = dr.GetMeshHandle();
+		packet.hInstPMV = -1;
+		packet.hInstColor = -1;
+		packet.VAO = pMesh->VAO;
+		packet.eIdxType = pMesh->eIdxType;
+		packet.nIdx = pMesh->nIdx;
+		packet.uIdxOffset = pMesh->uIdxOffset;
+		packet.iBaseVertex = pMesh->iBaseVertex;
+		packet.instance.v4Color = dr.GetColor();
+
+		// Skinned drawables dequantize before skinning, so that stays out of the PMV
+		if ( dr.IsSkinned() )
+		{
+			if ( SkinProgram == 0 )
+				continue;
+
+			packet.uKey = RenderQueue::MakeKey( SkinProgram, pMesh->VAO );
+			packet.Program = SkinProgram;
+			packet.instance.m4PMV = P * dr.GetMV();
+			cmds.vSkinned.push_back( { packet, dr.GetDequantMat() } );
+			cmds.vPaletteRanges.push_back( m_Animator.GetPaletteRange( dr.GetAnimInstance() ) );
+		}
+		else
+		{
+			packet.uKey = RenderQueue::MakeKey( Program, pMesh->VAO );
+			packet.Program = Program;
+			packet.instance.m4PMV = P * dr.GetDrawMV();
+			cmds.vPackets.push_back( packet );
+		}
+	}
+
+	// The GL side reads its own copy of the palettes
+	if ( cmds.vSkinned.empty() == false )
+		cmds.vPalettes = m_Animator.GetPalettes();
+
+	recordVisualizers( cmds, P );
+}
+
+void Scene::recordVisualizers( FrameCommands& cmds, const mat4& P )
+{
+	m_iVisualizerUpdateUs = 0;
+	if ( m_vVisualizers.empty() )
+		return;
+
+	TRACE_SCOPE( "Scene::recordVisualizers" );
+	const auto tpStart = std::chrono::steady_clock::now();
+
+	const AudioTap& tap = m_SoundManager.GetOutputTap();
+	const uint32_t uNumChannels = m_SoundManager.GetNumChannels();
+	for ( Visualizer& vis : m_vVisualizers )
+	{
+		vis.Update( tap, uNumChannels );
+
+		FrameCommands::VisualizerDraw draw;
+		draw.m4PMV = P * vis.GetMV();
+		draw.v4WaveColor = vis.GetWaveColor();
+		draw.v4SpectrumColor = vis.GetSpectrumColor();
+		draw.uFirstVert = (uint32_t) (cmds.vVisualizerVerts.size() / 3);
+		draw.uNumWaveVerts = vis.AppendWaveform( cmds.vVisualizerVerts );
+		draw.uNumSpectrumVerts = vis.AppendSpectrum( cmds.vVisualizerVerts );
+		cmds.vVisualizers.push_back( draw );
+	}
+
+	m_iVisualizerUpdateUs = (int) std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - tpStart ).count();
+}
+
+void Scene::executeFrame( FrameCommands& cmds )
+{
+	TRACE_SCOPE( "Scene::executeFrame" );
+
 	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
+	{
+		auto sBind = m_Shader.ScopeBind();
+
+		// See if the shader takes per instance data (only done once,
+		// so that we aren't looking names up every frame)
+		if ( m_bInstanceHandlesQueried == false )
+		{
+			m_hInstPMV = m_Shader.GetSlotLocation( m_Shader.GetSlot( "a_PMV" ) );
+			m_hInstColor = m_Shader.GetSlotLocation( m_Shader.GetSlot( "a_Color" ) );
+			m_iSlotPMV = m_Shader.GetSlot( "u_PMV" );
+			m_iSlotColor = m_Shader.GetSlot( "u_Color" );
+			m_hPos = m_Shader.GetSlotLocation( m_Shader.GetSlot( "a_Pos" ) );
+			m_bInstanceHandlesQueried = true;
+		}
+
+		if ( m_hInstPMV >= 0 && m_hInstColor >= 0 )
+			drawInstanced( cmds );
+		else
+			drawIndividually( cmds );
+	}
+
+	if ( cmds.vSkinned.empty() == false )
+		drawSkinned( cmds );
+
+	m_iVisualizerUploadUs = 0;
+	if ( cmds.vVisualizers.empty() == false )
+		drawVisualizers( cmds );
+
+	// Counters for GetRenderStats, which may be called from the other thread
+	{
+		std::lock_guard<std::mutex> lg( m_muRenderStats );
+		m_mapRenderStats = m_RenderQueue.GetStatsMap();
+		m_mapRenderStats["visualizerUploadUs"] = m_iVisualizerUploadUs;
+	}
+
+	{
+		// This blocks on vsync, so it gets its own marker
+		TRACE_SCOPE( "SDL_GL_SwapWindow" );
+		SDL_GL_SwapWindow( m_pWindow );
+	}
+}
+
+void Scene::drawIndividually( const FrameCommands& cmds )
+{
+	for ( const RenderQueue::DrawPacket& packet : cmds.vPackets )
+	{
+		m_Shader.SetUniform( m_iSlotPMV, packet.instance.m4PMV );
+		m_Shader.SetUniform( m_iSlotColor, packet.instance.v4Color );
+		glBindVertexArray( packet.VAO );
+		glDrawElementsBaseVertex( GL_TRIANGLES, packet.nIdx, packet.eIdxType, (GLvoid *) (size_t) packet.uIdxOffset, packet.iBaseVertex );
+	}
+	glBindVertexArray( 0 );
+}
+
+void Scene::drawInstanced( const FrameCommands& cmds )
+{
+	// One packet per drawable; the queue merges packets drawing the same mesh
+	for ( const RenderQueue::DrawPacket& packet : cmds.vPackets )
+	{
+		RenderQueue::DrawPacket instPacket( packet );
+		instPacket.hInstPMV = m_hInstPMV;
+		instPacket.hInstColor = m_hInstColor;
+		m_RenderQueue.Submit( instPacket );
+	}
+
+	m_RenderQueue.Flush();
+}
+
+void Scene::drawSkinned( const FrameCommands& cmds )
+{
+	// Palettes are bound here, and the shader's block reads from it
+	const GLuint kPaletteBinding = 0;
+
+	auto sBind = m_SkinShader.ScopeBind();
+	if ( m_bSkinHandlesQueried == false )
+	{
+		m_iSkinSlotPMV = m_SkinShader.GetSlot( "u_PMV" );
+		m_iSkinSlotColor = m_SkinShader.GetSlot( "u_Color" );
+		m_iSkinSlotDequant = m_SkinShader.GetSlot( "u_Dequant" );
+		const GLuint uBlockIdx = glGetUniformBlockIndex( m_SkinShader.GetProgram(), "JointPalette" );
+		if ( uBlockIdx != GL_INVALID_INDEX )
+			glUniformBlockBinding( m_SkinShader.GetProgram(), uBlockIdx, kPaletteBinding );
+		m_bSkinHandlesQueried = true;
+	}
+
+	if ( m_Animator.Upload( cmds.vPalettes, cmds.vPaletteRanges ) == false )
+		return;
+
+	for ( size_t i = 0; i < cmds.vSkinned.size(); i++ )
+	{
+		const FrameCommands::SkinnedDraw& draw = cmds.vSkinned[i];
+		if ( m_Animator.BindPalette( i, kPaletteBinding ) == false )
+			continue;
+
+		m_SkinShader.SetUniform( m_iSkinSlotPMV, draw.packet.instance.m4PMV );
+		m_SkinShader.SetUniform( m_iSkinSlotDequant, draw.m4Dequant );
+		m_SkinShader.SetUniform( m_iSkinSlotColor, draw.packet.instance.v4Color );
+		glBindVertexArray( draw.packet.VAO );
+		glDrawElementsBaseVertex( GL_TRIANGLES, draw.packet.nIdx, draw.packet.eIdxType, (GLvoid *) (size_t) draw.packet.uIdxOffset, draw.packet.iBaseVertex );
+	}
+	glBindVertexArray( 0 );
+
+	m_Animator.EndFrame();
+}
+
+void Scene::drawVisualizers( const FrameCommands& cmds )
+{
+	TRACE_SCOPE( "Scene::drawVisualizers" );
+
+	if ( m_VisualizerVAO == 0 || m_hPos < 0 )
+		return;
+
+	// Stream this frame's vertices into the next region
+	{
+		TRACE_SCOPE( "Scene::uploadVisualizers" );
+		const auto tpStart = std::chrono::steady_clock::now();
+
+		const size_t uNumBytes = cmds.vVisualizerVerts.size() * sizeof( float );
+		void * pVerts = m_VisualizerStream.Reserve( uNumBytes ) ? m_VisualizerStream.BeginFrame() : nullptr;
+		if ( pVerts == nullptr )
+			return;
+		memcpy( pVerts, cmds.vVisualizerVerts.data(), uNumBytes );
+		m_VisualizerStream.EndWrite( uNumBytes );
+
+		m_iVisualizerUploadUs = (int) std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - tpStart ).count();
+	}
+
 	auto sBind = m_Shader.ScopeBind();
+	glBindVertexArray( m_VisualizerVAO );
+	glBindBuffer( GL_ARRAY_BUFFER, m_VisualizerStream.GetBuffer() );
+	glEnableVertexAttribArray( m_hPos );
+	glVertexAttribPointer( m_hPos, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid *) m_VisualizerStream.GetFrameOffset() );
 
-	GLuint pmvHandle = m_Shader.GetHandle( "u_PMV" );
-	GLuint clrHandle = m_Shader.GetHandle( "u_Color" );
-	mat4 P = m_Camera.GetMat();
+	// Our VAO doesn't feed the per instance attributes, so their current
+	// values are used for every vertex (or they're uniforms, if not instancing)
+	auto setDrawState = [this] ( const mat4& m4PMV, const vec4& v4Color )
+	{
+		if ( m_hInstPMV >= 0 && m_hInstColor >= 0 )
+		{
+			for ( GLuint uCol = 0; uCol < 4; uCol++ )
+				glVertexAttrib4fv( m_hInstPMV + uCol, glm::value_ptr( m4PMV[uCol] ) );
+			glVertexAttrib4fv( m_hInstColor, glm::value_ptr( v4Color ) );
+		}
+		else
+		{
+			m_Shader.SetUniform( m_iSlotPMV, m4PMV );
+			m_Shader.SetUniform( m_iSlotColor, v4Color );
+		}
+	};
 
-	for ( Drawable& dr : m_vDrawables )
+	for ( const FrameCommands::VisualizerDraw& draw : cmds.vVisualizers )
 	{
-		mat4 PMV = P * dr.GetMV();
-		vec4 c = dr.GetColor();
-		glUniformMatrix4fv( pmvHandle, 1, GL_FALSE, glm::value_ptr( PMV ) );
-		glUniform4fv( clrHandle, 1, glm::value_ptr( c ) );
-		dr.Draw();
+		setDrawState( draw.m4PMV, draw.v4WaveColor );
+		glDrawArrays( GL_LINE_STRIP, draw.uFirstVert, draw.uNumWaveVerts );
+		setDrawState( draw.m4PMV, draw.v4SpectrumColor );
+		glDrawArrays( GL_LINE_STRIP, draw.uFirstVert + draw.uNumWaveVerts, draw.uNumSpectrumVerts );
 	}
 
-	SDL_GL_SwapWindow( m_pWindow );
+	glBindVertexArray( 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	m_VisualizerStream.EndFrame();
 }
 
 /*static*/const std::string Scene::strModuleName = "pylScene";
 
 void Scene::Update()
 {
+	TRACE_SCOPE( "Scene::Update" );
 	m_obDriverScript.call_function( "Update", this );
 }
 
@@ -102,6 +392,14 @@ bool Scene::InitDisplay( int glMajor, int glMinor, int iScreenW, int iScreenH, v
 
 	//For debugging
 	glLineWidth( 8.f );
+
+	// Render queue's, animator's and visualizers' GL resources
+	m_RenderQueue.Init();
+	m_Animator.Init();
+	m_VisualizerStream.Init( GL_ARRAY_BUFFER, 64 * 1024, 3 );
+	glGenVertexArrays( 1, &m_VisualizerVAO );
+
+	return true;
 }
 
 bool Scene::AddDrawable( std::string strIqmFile, vec2 T, vec2 S, vec4 C )
@@ -110,6 +408,7 @@ bool Scene::AddDrawable( std::string strIqmFile, vec2 T, vec2 S, vec4 C )
 	{
 		Drawable D( strIqmFile, C, quatvec( vec3( T, 0 ), fquat() ), S );
 		m_vDrawables.push_back( D );
+		m_vDrawables.back().AttachTransformStore( &m_TransformStore );
 		return true;
 	}
 	catch ( std::runtime_error )
@@ -118,6 +417,146 @@ bool Scene::AddDrawable( std::string strIqmFile, vec2 T, vec2 S, vec4 C )
 	}
 }
 
+int Scene::AddDrawableAsync( std::string strIqmFile, vec2 T, vec2 S, vec4 C )
+{
+	try
+	{
+		Drawable D = Drawable::Deferred( strIqmFile, C, quatvec( vec3( T, 0 ), fquat() ), S );
+		m_vDrawables.push_back( D );
+		m_vDrawables.back().AttachTransformStore( &m_TransformStore );
+	}
+	catch ( std::runtime_error )
+	{
+		return -1;
+	}
+
+	// If the mesh is already here we're done, otherwise wait for it
+	// (only requesting a load the first time we see the file)
+	const size_t drIdx = m_vDrawables.size() - 1;
+	if ( m_vDrawables.back().ResolveMesh() == false )
+	{
+		auto it = m_mapPendingDrawables.find( strIqmFile );
+		if ( it == m_mapPendingDrawables.end() )
+		{
+			m_mapPendingDrawables[strIqmFile].push_back( drIdx );
+			m_MeshLoader.Request( strIqmFile );
+		}
+		else
+			it->second.push_back( drIdx );
+	}
+
+	return (int) drIdx;
+}
+
+int Scene::AddAnimatedDrawable( std::string strIqmFile, vec2 T, vec2 S, vec4 C )
+{
+	const int iSkeleton = m_Animator.LoadSkeleton( strIqmFile );
+	if ( iSkeleton < 0 )
+		return -1;
+
+	try
+	{
+		Drawable D( strIqmFile, C, quatvec( vec3( T, 0 ), fquat() ), S );
+		D.SetAnimInstance( m_Animator.AddInstance( iSkeleton ) );
+		m_vDrawables.push_back( D );
+		m_vDrawables.back().AttachTransformStore( &m_TransformStore );
+	}
+	catch ( std::runtime_error )
+	{
+		return -1;
+	}
+
+	return (int) (m_vDrawables.size() - 1);
+}
+
+bool Scene::PlayAnimation( size_t drIdx, std::string strAnim, float fFadeTime )
+{
+	if ( drIdx >= m_vDrawables.size() || m_vDrawables[drIdx].IsSkinned() == false )
+		return false;
+	return m_Animator.Play( m_vDrawables[drIdx].GetAnimInstance(), strAnim, fFadeTime );
+}
+
+bool Scene::SetAnimationSpeed( size_t drIdx, float fSpeed )
+{
+	if ( drIdx >= m_vDrawables.size() || m_vDrawables[drIdx].IsSkinned() == false )
+		return false;
+	return m_Animator.SetSpeed( m_vDrawables[drIdx].GetAnimInstance(), fSpeed );
+}
+
+int Scene::AddVisualizer( vec2 T, vec2 S, vec4 v4WaveColor, vec4 v4SpectrumColor )
+{
+	m_vVisualizers.emplace_back( T, S, v4WaveColor, v4SpectrumColor );
+	return (int) m_vVisualizers.size() - 1;
+}
+
+bool Scene::IsDrawableResident( size_t drIdx ) const
+{
+	return drIdx < m_vDrawables.size() && m_vDrawables[drIdx].IsResident();
+}
+
+void Scene::uploadLoadedMeshes()
+{
+	// GL uploads per frame are limited to roughly this many bytes
+	// (we always do at least one, so big meshes still get through)
+	const size_t kMeshUploadBudget = 1 << 20;
+
+	m_MeshLoader.TakeLoaded( m_liMeshUploads );
+	if ( m_liMeshUploads.empty() )
+		return;
+
+	TRACE_SCOPE( "Scene::uploadLoadedMeshes" );
+
+	// These need GL, so with a render thread they go over in one trip
+	RenderThread::RunSync( [&] ()
+	{
+		size_t uBytesUploaded( 0 );
+		while ( m_liMeshUploads.empty() == false && uBytesUploaded < kMeshUploadBudget )
+		{
+			MeshLoader::Loaded& loaded = m_liMeshUploads.front();
+
+			// AddDrawable may have loaded it synchronously in the meantime
+			if ( Drawable::IsMeshCached( loaded.strIqmFile ) == false )
+			{
+				if ( loaded.bSuccess && Drawable::CacheMesh( loaded.strIqmFile, loaded.mesh ) )
+				{
+					const MeshData::Header& h = loaded.mesh.GetHeader();
+					uBytesUploaded += h.uVertexBytes + h.uIndexBytes;
+				}
+				else
+					std::cout << "Error: unable to load mesh " << loaded.strIqmFile << std::endl;
+			}
+
+			// Everyone waiting on this mesh can pick it up now (they stay invisible if it failed)
+			auto it = m_mapPendingDrawables.find( loaded.strIqmFile );
+			if ( it != m_mapPendingDrawables.end() )
+			{
+				for ( size_t drIdx : it->second )
+					m_vDrawables[drIdx].ResolveMesh();
+				m_mapPendingDrawables.erase( it );
+			}
+
+			m_liMeshUploads.pop_front();
+		}
+	} );
+}
+
+bool Scene::StartRenderThread()
+{
+	// Make sure nothing is left half done on this thread first
+	glFinish();
+	return m_RenderThread.Start( m_pWindow, m_GLContext, [this] ( FrameCommands& cmds ) { executeFrame( cmds ); } );
+}
+
+void Scene::StopRenderThread()
+{
+	m_RenderThread.Stop();
+}
+
+bool Scene::IsRenderThreadRunning() const
+{
+	return m_RenderThread.IsRunning();
+}
+
 const SoundManager * Scene::GetSoundManagerPtr() const
 {
 	return &m_SoundManager;
@@ -128,6 +567,11 @@ Shader * Scene::GetShaderPtr() const
 	return (Shader *) &m_Shader;
 }
 
+Shader * Scene::GetSkinShaderPtr() const
+{
+	return (Shader *) &m_SkinShader;
+}
+
 Camera * Scene::GetCameraPtr() const
 {
 	return (Camera *) &m_Camera;
@@ -150,6 +594,30 @@ Drawable * Scene::GetDrawable( const size_t drIdx ) const
 	return nullptr;
 }
 
+std::map<std::string, int> Scene::GetRenderStats() const
+{
+	std::map<std::string, int> mapStats;
+	{
+		std::lock_guard<std::mutex> lg( m_muRenderStats );
+		mapStats = m_mapRenderStats;
+	}
+	mapStats["visible"] = m_nVisible;
+	mapStats["culled"] = m_nCulled;
+	mapStats["meshBytesUsed"] = (int) Drawable::GetMeshArena().GetUsedBytes();
+	mapStats["meshBytesAllocated"] = (int) Drawable::GetMeshArena().GetAllocatedBytes();
+	mapStats["meshBytesSaved"] = (int) Drawable::GetTotalMeshBytesSaved();
+	mapStats["animInstances"] = (int) m_Animator.GetNumInstances();
+	mapStats["animJoints"] = (int) m_Animator.GetNumJointsEvaluated();
+	mapStats["renderThreadWaits"] = (int) m_RenderThread.GetNumWaits();
+	mapStats["renderThreadTasks"] = (int) m_RenderThread.GetNumTasks();
+	mapStats["shaderCacheHits"] = Shader::GetBinaryCacheHits();
+	mapStats["shaderCacheMisses"] = Shader::GetBinaryCacheMisses();
+	mapStats["shaderLinkMs"] = (int) Shader::GetTotalLinkTime();
+	mapStats["visualizers"] = (int) m_vVisualizers.size();
+	mapStats["visualizerFFTUs"] = m_iVisualizerUpdateUs;
+	return mapStats;
+}
+
 /*static*/ void Scene::pylExpose()
 {
 	SoundManager::pylExpose();
@@ -166,10 +634,26 @@ Drawable * Scene::GetDrawable( const size_t drIdx ) const
 
 	AddMemFnToMod( Scene, InitDisplay, bool, pSceneModuleDef, int, int, int, int, vec4 );
 	AddMemFnToMod( Scene, AddDrawable, bool, pSceneModuleDef, std::string, vec2, vec2, vec4 );
+	AddMemFnToMod( Scene, AddDrawableAsync, int, pSceneModuleDef, std::string, vec2, vec2, vec4 );
+	AddMemFnToMod( Scene, IsDrawableResident, bool, pSceneModuleDef, size_t );
+	AddMemFnToMod( Scene, AddAnimatedDrawable, int, pSceneModuleDef, std::string, vec2, vec2, vec4 );
+	AddMemFnToMod( Scene, PlayAnimation, bool, pSceneModuleDef, size_t, std::string, float );
+	AddMemFnToMod( Scene, SetAnimationSpeed, bool, pSceneModuleDef, size_t, float );
+	AddMemFnToMod( Scene, AddVisualizer, int, pSceneModuleDef, vec2, vec2, vec4, vec4 );
+	AddMemFnToMod( Scene, StartRenderThread, bool, pSceneModuleDef );
+	AddMemFnToMod( Scene, StopRenderThread, void, pSceneModuleDef );
+	AddMemFnToMod( Scene, IsRenderThreadRunning, bool, pSceneModuleDef );
 	AddMemFnToMod( Scene, GetShaderPtr, Shader *, pSceneModuleDef );
+	AddMemFnToMod( Scene, GetSkinShaderPtr, Shader *, pSceneModuleDef );
 	AddMemFnToMod( Scene, GetCameraPtr, Camera *, pSceneModuleDef );
 	AddMemFnToMod( Scene, GetSoundManagerPtr, const SoundManager *, pSceneModuleDef );
 	AddMemFnToMod( Scene, GetDrawable, Drawable *, pSceneModuleDef, size_t );
 	AddMemFnToMod( Scene, GetQuitFlag, bool, pSceneModuleDef );
 	AddMemFnToMod( Scene, SetQuitFlag, void, pSceneModuleDef, bool );
+	using StatsMap = std::map<std::string, int>;
+	AddMemFnToMod( Scene, GetRenderStats, StatsMap, pSceneModuleDef );
+
+	// Tracing controls
+	pSceneModuleDef->RegisterFunction<PYL_FN( Trace::SetEnabled )>( "SetTraceEnabled" );
+	pSceneModuleDef->RegisterFunction<PYL_FN( Trace::Dump )>( "DumpTrace" );
 }
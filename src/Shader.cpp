@@ -1,11 +1,65 @@
 #include <fstream>
 #include <string>
 #include <iostream>
+#include <chrono>
+#include <vector>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
 using namespace std;
 
+#include <stdio.h>
+#include <string.h>
+
 #include <pyliason.h>
 
 #include "Shader.h"
+#include "Hash.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+// What's at the front of a program binary cache file
+static const char kProgMagic[8] = "SDLPROG";
+static const uint32_t kProgVersion = 1;
+struct ProgramBinaryHeader
+{
+	char magic[8];
+	uint32_t uVersion;
+	uint32_t eFormat;			// From glGetProgramBinary
+	uint64_t uNumBytes;			// The binary follows the header
+	uint64_t uSrcHash;			// Hash of the vertex and fragment sources
+	uint64_t uDriverHash;		// Hash of the vendor, renderer and version strings
+	uint64_t uDataHash;			// Hash of the binary
+};
+
+/*static*/ std::string Shader::s_strBinaryCacheDir;
+/*static*/ int Shader::s_nBinaryCacheHits( 0 );
+/*static*/ int Shader::s_nBinaryCacheMisses( 0 );
+/*static*/ float Shader::s_fTotalLinkTime( 0 );
+
+// Binaries are only good for the driver that made them
+static uint64_t getDriverHash()
+{
+	uint64_t uHash = kFnvOffsetBasis;
+	for ( GLenum eName : { GL_VENDOR, GL_RENDERER, GL_VERSION } )
+	{
+		const char * szStr = (const char *) glGetString( eName );
+		if ( szStr )
+			uHash = FnvHash( szStr, strlen( szStr ) + 1, uHash );
+	}
+	return uHash;
+}
+
+// Whether the context can give us program binaries
+static bool binaryCacheSupported()
+{
+	if ( GLEW_VERSION_4_1 == false && GLEW_ARB_get_program_binary == false )
+		return false;
+
+	GLint nFormats( 0 );
+	glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &nFormats );
+	return nFormats > 0;
+}
 
 // TODO
 // Set up constructors so things don't get messed up if someone
@@ -16,7 +70,9 @@ Shader::Shader() :
 	m_bIsBound( false ),
 	m_Program( 0 ),
 	m_hVertShader( 0 ),
-	m_hFragShader( 0 )
+	m_hFragShader( 0 ),
+	m_bFromCache( false ),
+	m_fLinkTime( 0 )
 {
 }
 Shader::Shader( std::string vSrc, std::string fSrc ) :
@@ -88,7 +144,162 @@ bool Shader::IsBound() const {
 	return m_bIsBound;
 }
 
-int Shader::CompileAndLink() {
+int Shader::CompileAndLink()
+{
+	const auto tpStart = std::chrono::steady_clock::now();
+
+	// The cache file is named for the sources, and checked against the driver
+	const bool bUseCache = s_strBinaryCacheDir.empty() == false && binaryCacheSupported();
+	uint64_t uSrcHash( 0 ), uDriverHash( 0 );
+	std::string strCacheFile;
+	if ( bUseCache )
+	{
+		uSrcHash = FnvHash( m_VertShaderSrc.data(), m_VertShaderSrc.size() );
+		uSrcHash = FnvHash( m_FragShaderSrc.data(), m_FragShaderSrc.size(), uSrcHash );
+		uDriverHash = getDriverHash();
+
+		std::ostringstream ssFile;
+		ssFile << s_strBinaryCacheDir << std::hex << std::setw( 16 ) << std::setfill( '0' ) << uSrcHash << ".progbin";
+		strCacheFile = ssFile.str();
+	}
+
+	m_bFromCache = bUseCache && loadBinary( strCacheFile, uSrcHash, uDriverHash );
+	if ( m_bFromCache == false )
+	{
+		const int err = compileAndLink( bUseCache );
+		if ( err )
+			return err;
+
+		// Not being able to write the cache isn't an error
+		if ( bUseCache && saveBinary( strCacheFile, uSrcHash, uDriverHash ) == false )
+			cout << "Warning: unable to write program binary cache " << strCacheFile << endl;
+	}
+
+	reflect();
+
+	m_fLinkTime = std::chrono::duration<float, std::milli>( std::chrono::steady_clock::now() - tpStart ).count();
+	s_fTotalLinkTime += m_fLinkTime;
+	if ( m_bFromCache )
+		s_nBinaryCacheHits++;
+	else if ( bUseCache )
+		s_nBinaryCacheMisses++;
+
+	cout << "Shader program " << (m_bFromCache ? "loaded from binary cache" : "compiled") << " in " << m_fLinkTime << " ms" << endl;
+
+	return 0;
+}
+
+bool Shader::loadBinary( const std::string strCacheFile, uint64_t uSrcHash, uint64_t uDriverHash )
+{
+	FILE * fp = fopen( strCacheFile.c_str(), "rb" );
+	if ( fp == nullptr )
+		return false;
+
+	// Make sure it's for these sources and this driver before reading the rest
+	ProgramBinaryHeader header;
+	std::vector<char> vBinary;
+	bool bRead = fread( &header, sizeof( header ), 1, fp ) == 1 &&
+		memcmp( header.magic, kProgMagic, sizeof( header.magic ) ) == 0 &&
+		header.uVersion == kProgVersion &&
+		header.uSrcHash == uSrcHash &&
+		header.uDriverHash == uDriverHash &&
+		header.uNumBytes > 0 && header.uNumBytes < (1 << 30);
+	if ( bRead )
+	{
+		vBinary.resize( (size_t) header.uNumBytes );
+		bRead = fread( vBinary.data(), 1, vBinary.size(), fp ) == vBinary.size() &&
+			FnvHash( vBinary.data(), vBinary.size() ) == header.uDataHash;
+	}
+	fclose( fp );
+
+	if ( bRead == false )
+		return false;
+
+	// The driver can still refuse it (after an update, say)
+	GLuint program = glCreateProgram();
+	glProgramBinary( program, (GLenum) header.eFormat, vBinary.data(), (GLsizei) vBinary.size() );
+	GLint status( GL_FALSE );
+	glGetProgramiv( program, GL_LINK_STATUS, &status );
+	if ( status != GL_TRUE )
+	{
+		glDeleteProgram( program );
+		return false;
+	}
+
+	m_Program = program;
+	return true;
+}
+
+bool Shader::saveBinary( const std::string strCacheFile, uint64_t uSrcHash, uint64_t uDriverHash ) const
+{
+	GLint nBytes( 0 );
+	glGetProgramiv( m_Program, GL_PROGRAM_BINARY_LENGTH, &nBytes );
+	if ( nBytes <= 0 )
+		return false;
+
+	std::vector<char> vBinary( (size_t) nBytes );
+	GLenum eFormat( 0 );
+	GLsizei nWritten( 0 );
+	glGetProgramBinary( m_Program, nBytes, &nWritten, &eFormat, vBinary.data() );
+	if ( nWritten <= 0 )
+		return false;
+	vBinary.resize( (size_t) nWritten );
+
+	ProgramBinaryHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, kProgMagic, sizeof( header.magic ) );
+	header.uVersion = kProgVersion;
+	header.eFormat = eFormat;
+	header.uNumBytes = vBinary.size();
+	header.uSrcHash = uSrcHash;
+	header.uDriverHash = uDriverHash;
+	header.uDataHash = FnvHash( vBinary.data(), vBinary.size() );
+
+	FILE * fp = fopen( strCacheFile.c_str(), "wb" );
+	if ( fp == nullptr )
+		return false;
+
+	const bool bSuccess = fwrite( &header, sizeof( header ), 1, fp ) == 1 &&
+		fwrite( vBinary.data(), 1, vBinary.size(), fp ) == vBinary.size();
+	fclose( fp );
+
+	return bSuccess;
+}
+
+bool Shader::WasLoadedFromCache() const
+{
+	return m_bFromCache;
+}
+
+float Shader::GetLinkTime() const
+{
+	return m_fLinkTime;
+}
+
+/*static*/ void Shader::SetBinaryCacheDir( std::string strDir )
+{
+	// Make sure we can tack a file name on
+	if ( strDir.empty() == false && strDir.back() != '/' && strDir.back() != '\\' )
+		strDir += '/';
+	s_strBinaryCacheDir = strDir;
+}
+
+/*static*/ int Shader::GetBinaryCacheHits()
+{
+	return s_nBinaryCacheHits;
+}
+
+/*static*/ int Shader::GetBinaryCacheMisses()
+{
+	return s_nBinaryCacheMisses;
+}
+
+/*static*/ float Shader::GetTotalLinkTime()
+{
+	return s_fTotalLinkTime;
+}
+
+int Shader::compileAndLink( bool bRetrievable ) {
 	// Check if the shader op went ok
 	auto check = [](GLuint id, GLuint type) {
 		GLint status(GL_FALSE);
@@ -129,6 +340,8 @@ int Shader::CompileAndLink() {
 	m_Program = glCreateProgram();
 	glAttachShader(m_Program, m_hVertShader);
 	glAttachShader(m_Program, m_hFragShader);
+	if (bRetrievable)
+		glProgramParameteri(m_Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(m_Program);
 	if (!check(m_Program, GL_LINK_STATUS)) {
 		PrintLog_P();
@@ -139,10 +352,151 @@ int Shader::CompileAndLink() {
 	return ERR_N;
 }
 
+void Shader::reflect()
+{
+	m_vVariables.clear();
+	m_mapSlots.clear();
+	m_Handles.clear();
+
+	// Long enough for any name we'd use
+	GLint nMaxAttrLen( 0 ), nMaxUniLen( 0 );
+	glGetProgramiv( m_Program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &nMaxAttrLen );
+	glGetProgramiv( m_Program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &nMaxUniLen );
+	std::vector<GLchar> vName( (size_t) std::max( std::max( nMaxAttrLen, nMaxUniLen ), 1 ) );
+
+	auto addVariable = [this] ( std::string strName, GLint iLocation, GLenum eType, GLint nSize, bool bUniform )
+	{
+		// Builtins and block members have no location of their own
+		if ( iLocation < 0 )
+			return;
+
+		// Arrays are reported as name[0]; we go by the name
+		const size_t uBracket = strName.find( '[' );
+		if ( uBracket != std::string::npos )
+			strName.resize( uBracket );
+
+		m_mapSlots[strName] = (int) m_vVariables.size();
+		m_vVariables.push_back( { strName, iLocation, eType, nSize, bUniform } );
+
+		// GetHandle needn't ask GL for these
+		m_Handles[strName] = iLocation;
+	};
+
+	GLint nAttrs( 0 ), nUniforms( 0 );
+	glGetProgramiv( m_Program, GL_ACTIVE_ATTRIBUTES, &nAttrs );
+	glGetProgramiv( m_Program, GL_ACTIVE_UNIFORMS, &nUniforms );
+
+	for ( GLint i = 0; i < nAttrs; i++ )
+	{
+		GLsizei nLen( 0 );
+		GLint nSize( 0 );
+		GLenum eType( 0 );
+		glGetActiveAttrib( m_Program, (GLuint) i, (GLsizei) vName.size(), &nLen, &nSize, &eType, vName.data() );
+		addVariable( std::string( vName.data(), nLen ), glGetAttribLocation( m_Program, vName.data() ), eType, nSize, false );
+	}
+
+	for ( GLint i = 0; i < nUniforms; i++ )
+	{
+		GLsizei nLen( 0 );
+		GLint nSize( 0 );
+		GLenum eType( 0 );
+		glGetActiveUniform( m_Program, (GLuint) i, (GLsizei) vName.size(), &nLen, &nSize, &eType, vName.data() );
+		addVariable( std::string( vName.data(), nLen ), glGetUniformLocation( m_Program, vName.data() ), eType, nSize, true );
+	}
+}
+
+int Shader::GetSlot( const std::string strName ) const
+{
+	auto it = m_mapSlots.find( strName );
+	return it == m_mapSlots.end() ? -1 : it->second;
+}
+
+int Shader::GetNumSlots() const
+{
+	return (int) m_vVariables.size();
+}
+
+GLint Shader::GetSlotLocation( int iSlot ) const
+{
+	if ( iSlot < 0 || iSlot >= (int) m_vVariables.size() )
+		return -1;
+	return m_vVariables[iSlot].iLocation;
+}
+
+const Shader::Variable * Shader::getUniform( int iSlot ) const
+{
+	if ( iSlot < 0 || iSlot >= (int) m_vVariables.size() || m_vVariables[iSlot].bUniform == false )
+		return nullptr;
+	return &m_vVariables[iSlot];
+}
+
+bool Shader::SetUniform( int iSlot, int iVal )
+{
+	const Variable * pVar = getUniform( iSlot );
+	if ( pVar == nullptr )
+		return false;
+	glUniform1i( pVar->iLocation, iVal );
+	return true;
+}
+
+bool Shader::SetUniform( int iSlot, float fVal )
+{
+	const Variable * pVar = getUniform( iSlot );
+	if ( pVar == nullptr )
+		return false;
+	glUniform1f( pVar->iLocation, fVal );
+	return true;
+}
+
+bool Shader::SetUniform( int iSlot, const vec2& v2Val )
+{
+	const Variable * pVar = getUniform( iSlot );
+	if ( pVar == nullptr )
+		return false;
+	glUniform2fv( pVar->iLocation, 1, glm::value_ptr( v2Val ) );
+	return true;
+}
+
+bool Shader::SetUniform( int iSlot, const vec3& v3Val )
+{
+	const Variable * pVar = getUniform( iSlot );
+	if ( pVar == nullptr )
+		return false;
+	glUniform3fv( pVar->iLocation, 1, glm::value_ptr( v3Val ) );
+	return true;
+}
+
+bool Shader::SetUniform( int iSlot, const vec4& v4Val )
+{
+	const Variable * pVar = getUniform( iSlot );
+	if ( pVar == nullptr )
+		return false;
+	glUniform4fv( pVar->iLocation, 1, glm::value_ptr( v4Val ) );
+	return true;
+}
+
+bool Shader::SetUniform( int iSlot, const mat4& m4Val )
+{
+	return SetUniform( iSlot, &m4Val, 1 );
+}
+
+bool Shader::SetUniform( int iSlot, const mat4 * pm4Vals, GLsizei nCount )
+{
+	const Variable * pVar = getUniform( iSlot );
+	if ( pVar == nullptr || pm4Vals == nullptr )
+		return false;
+	glUniformMatrix4fv( pVar->iLocation, std::min( nCount, pVar->nSize ), GL_FALSE, glm::value_ptr( *pm4Vals ) );
+	return true;
+}
+
 GLint Shader::operator[](const string idx) {
 	return GetHandle(idx);
 }
 
+GLuint Shader::GetProgram() const {
+	return m_Program;
+}
+
 // Accessor for shader handles
 GLint Shader::GetHandle(const string idx) {
 	// If we have the handle, return it
@@ -237,4 +591,10 @@ int Shader::PrintSrc_F() const {
 	AddMemFnToMod( Shader, Bind, bool, pShaderModDef );
 	AddMemFnToMod( Shader, Unbind, bool, pShaderModDef );
 	AddMemFnToMod( Shader, GetHandle, GLint, pShaderModDef, std::string );
+	AddMemFnToMod( Shader, WasLoadedFromCache, bool, pShaderModDef );
+	AddMemFnToMod( Shader, GetLinkTime, float, pShaderModDef );
+	AddMemFnToMod( Shader, GetSlot, int, pShaderModDef, std::string );
+	AddMemFnToMod( Shader, GetNumSlots, int, pShaderModDef );
+
+	pShaderModDef->RegisterFunction<PYL_FN( Shader::SetBinaryCacheDir )>( "SetBinaryCacheDir" );
 }
\ No newline at end of file
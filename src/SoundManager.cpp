@@ -1,24 +1,58 @@
 #include "SoundManager.h"
 #include "Clip.h"
 #include "Voice.h"
+#include "Trace.h"
 
 #include <algorithm>
+#include <iterator>
 #include <iostream>
 
+// The most mix caches the audio thread can hold (its storage is reserved up front)
+const size_t kMaxMixCaches = 32;
+
+// The most voices that can play at once (the audio thread takes them from a pool)
+const size_t kMaxVoices = 128;
+
 SoundManager::SoundManager():
 	m_bPlaying( false ),
-	m_uSamplePos( 0 ),
 	m_uMaxSampleCount( 0 ),
-	m_uNumBufsCompleted( 0 )
+	m_uNumBufsCompleted( 0 ),
+	m_uSamplePos( 0 ),
+	m_uBufsUncounted( 0 ),
+	m_uClipMemoryBudget( 0 ),
+	m_uSamplesRendered( 0 ),
+	m_pAudioLogFile( stdout )
 {
+	reserveAudioStorage();
 }
 
 SoundManager::SoundManager( SDL_AudioSpec sdlAudioSpec ) :
-	m_uSamplePos( 0 ),
+	m_bPlaying( false ),
 	m_uMaxSampleCount( 0 ),
-	m_AudioSpec( sdlAudioSpec )
+	m_uNumBufsCompleted( 0 ),
+	m_AudioSpec( sdlAudioSpec ),
+	m_uSamplePos( 0 ),
+	m_uBufsUncounted( 0 ),
+	m_uClipMemoryBudget( 0 ),
+	m_uSamplesRendered( 0 ),
+	m_pAudioLogFile( stdout )
 {
 	m_AudioSpec.userdata = nullptr;
+	reserveAudioStorage();
+}
+
+// Anything the audio thread needs to hold gets made up front, so it never allocates
+void SoundManager::reserveAudioStorage()
+{
+	m_vAudioMixCaches.reserve( kMaxMixCaches );
+
+	// The audio thread counts completed buffers in this, see updateTaskQueue
+	Command tNumBufsCompleted;
+	tNumBufsCompleted.eID = ECommandID::BufCompleted;
+	m_liPublicCmdQueue = { tNumBufsCompleted };
+
+	for ( size_t i = 0; i < kMaxVoices; i++ )
+		m_liFreeVoices.emplace_back( nullptr, -1, 0, 1.f );
 }
 
 SoundManager::~SoundManager()
@@ -28,51 +62,93 @@ SoundManager::~SoundManager()
 		SDL_CloseAudio();
 		memset( &m_AudioSpec, 0, sizeof( SDL_AudioSpec ) );
 	}
+
+	if ( m_pAudioLogFile && m_pAudioLogFile != stdout )
+	{
+		fclose( m_pAudioLogFile );
+		m_pAudioLogFile = nullptr;
+	}
 }
 
 bool SoundManager::RegisterClip( std::string strLoopName, std::string strHeadFile, std::string strTailFile, size_t uFadeDurationMS )
 {
-	// This shouldn't be happening at a bad time, but just in case
-	std::lock_guard<std::mutex> lg( m_muAudioMutex );
-
 	// If we already have this clip stored, return true
-	if ( m_mapClips.find( strLoopName ) != m_mapClips.end() )
+	if ( m_mapClipSources.find( strLoopName ) != m_mapClipSources.end() )
 		return true;
 
-	float * pSoundBuffer( nullptr );
-	Uint32 uNumBytesInHead( 0 );
-	float * pTailBuffer( nullptr );
-	Uint32 uNumBytesInTail( 0 );
-	SDL_AudioSpec wavSpec{ 0 }, refSpec = m_AudioSpec;
-	auto checkAudioSpec = [refSpec, &wavSpec] ()
-	{
-		return (refSpec.freq == wavSpec.freq &&
-				 refSpec.format == wavSpec.format &&
-				 refSpec.channels == wavSpec.channels &&
-				 refSpec.samples == wavSpec.samples);
-	};
-	if ( SDL_LoadWAV( strHeadFile.c_str(), &wavSpec, (Uint8 **) &pSoundBuffer, &uNumBytesInHead ) )
-	{
-		if ( checkAudioSpec() )
-		{
-			if ( SDL_LoadWAV( strTailFile.c_str(), &wavSpec, (Uint8 **) &pTailBuffer, &uNumBytesInTail ) )
-			{
-				if ( checkAudioSpec() == false )
-				{
-					pTailBuffer = nullptr;
-					uNumBytesInTail = 0;
-				}
-			}
+	// Load the clip before taking the lock
+	ClipLoader::Source src;
+	src.strHeadFile = strHeadFile;
+	src.strTailFile = strTailFile;
+	src.uFadeSamples = uFadeDurationMS;
+
+	Clip clip;
+	if ( ClipLoader::LoadClip( strLoopName, src, m_AudioSpec, clip ) == false )
+		return false;
+
+	// Remember where it came from, in case it gets evicted
+	m_mapClipSources[strLoopName] = src;
+
+	// This shouldn't be happening at a bad time, but just in case
+	std::lock_guard<RTCheck::Mutex> lg( m_muAudioMutex );
+	m_uMaxSampleCount = std::max( m_uMaxSampleCount, clip.GetNumSamples( false ) );
+	m_mapClips[strLoopName] = clip;
+
+	return true;
+}
+
+// Render a steady state mix on this thread and send it to the audio thread (locks mutex)
+bool SoundManager::CacheMix( std::string strMixName, std::list<MixCacheEntry> liEntries )
+{
+	if ( liEntries.empty() )
+		return false;
 
-			const size_t uNumSamplesInHead = uNumBytesInHead / sizeof( float );
-			const size_t uNumSamplesInTail = uNumBytesInTail / sizeof( float );
-			m_uMaxSampleCount = std::max( m_uMaxSampleCount, uNumSamplesInHead );
-			m_mapClips[strLoopName] = Clip( strLoopName, pSoundBuffer, uNumSamplesInHead, pTailBuffer, uNumSamplesInTail, uFadeDurationMS );
+	// If we already have this mix stored, return true
+	for ( const MixCache& mix : m_liMixCaches )
+		if ( mix.strName == strMixName )
 			return true;
-		}
+
+	// The audio thread can't grow its list
+	if ( m_liMixCaches.size() >= kMaxMixCaches )
+		return false;
+
+	MixCache mix;
+	mix.strName = strMixName;
+	for ( MixCacheEntry& entry : liEntries )
+	{
+		auto itClip = m_mapClips.find( std::get<0>( entry ) );
+		if ( itClip == m_mapClips.end() )
+			return false;
+
+		// Every clip must be resident and loop with the same period
+		const Clip& clip = itClip->second;
+		if ( clip.IsResident() == false )
+			return false;
+		const size_t uSamplesInHead = clip.GetNumSamples( false );
+		if ( uSamplesInHead == 0 )
+			return false;
+		if ( mix.vMixBuffer.empty() )
+			mix.vMixBuffer.resize( uSamplesInHead, 0.f );
+		else if ( mix.vMixBuffer.size() != uSamplesInHead )
+			return false;
+
+		// Mix this clip in
+		Voice::RenderSteadyLoop( &clip, std::get<2>( entry ), mix.vMixBuffer.data() );
+		mix.vVoiceIDs.push_back( std::get<1>( entry ) );
+		mix.vVolumes.push_back( std::get<2>( entry ) );
 	}
 
-	return false;
+	// Store it where it won't move and let the audio thread know about it
+	m_liMixCaches.push_back( std::move( mix ) );
+
+	Command cmd;
+	cmd.eID = ECommandID::EnableMixCache;
+	cmd.pMixCache = &m_liMixCaches.back();
+
+	std::lock_guard<RTCheck::Mutex> lg( m_muAudioMutex );
+	m_liPublicCmdQueue.push_back( cmd );
+
+	return true;
 }
 
 // Add a message-wrapped task to the queue (locks mutex)
@@ -82,7 +158,7 @@ bool SoundManager::SendMessage( Message M )
 	if ( cmd.eID == ECommandID::None )
 		return false;
 
-	std::lock_guard<std::mutex> lg( m_muAudioMutex );
+	std::lock_guard<RTCheck::Mutex> lg( m_muAudioMutex );
 	m_liPublicCmdQueue.push_back( cmd );
 
 	return true;
@@ -108,7 +184,7 @@ bool SoundManager::SendMessages( std::list<Message> liM )
 	if ( liNewTasks.empty() )
 		return false;
 
-	std::lock_guard<std::mutex> lg( m_muAudioMutex );
+	std::lock_guard<RTCheck::Mutex> lg( m_muAudioMutex );
 	m_liPublicCmdQueue.splice( m_liPublicCmdQueue.end(), liNewTasks );
 
 	return ret;
@@ -169,19 +245,21 @@ SoundManager::Command SoundManager::translateMessage( Message& M )
 // Called by main thread, locks mutex
 void SoundManager::incNumBufsCompleted()
 {
-	// We gotta lock this while we mess with the public queue
-	std::lock_guard<std::mutex> lg( m_muAudioMutex );
+	// Commands the audio thread is done with, freed once we've unlocked
+	std::list<Command> liRetired;
 
-	// Get out if empty
-	if ( m_liPublicCmdQueue.empty() )
-		return;
-
-	// Grab the front, maybe inc buf count and pop
-	Command tFront = m_liPublicCmdQueue.front();
-	if ( tFront.eID == ECommandID::BufCompleted )
+	// We gotta lock this while we mess with the public queue
 	{
-		m_liPublicCmdQueue.pop_front();
-		m_uNumBufsCompleted += tFront.uData;
+		std::lock_guard<RTCheck::Mutex> lg( m_muAudioMutex );
+		liRetired.swap( m_liRetiredCmds );
+
+		// The front is always the audio thread's count of completed buffers
+		Command& tFront = m_liPublicCmdQueue.front();
+		if ( tFront.eID == ECommandID::BufCompleted )
+		{
+			m_uNumBufsCompleted += tFront.uData;
+			tFront.uData = 0;
+		}
 	}
 }
 
@@ -191,92 +269,315 @@ void SoundManager::Update()
 	// Just see if the audio thread has left any
 	// BufCompleted tasks for us
 	incNumBufsCompleted();
+
+	// Load, free, and evict clips as needed
+	updateClipResidency();
+
+	// Flush anything the audio thread logged
+	m_AudioLog.Drain( m_pAudioLogFile );
 }
 
-// Called by audio thread, locks mutex
-void SoundManager::updateTaskQueue()
+// Called by main thread, may lock mutex
+void SoundManager::updateClipResidency()
+{
+	// Install any clips that finished loading
+	std::list<ClipLoader::Loaded> liLoaded;
+	m_ClipLoader.TakeLoaded( liLoaded );
+	for ( ClipLoader::Loaded& loaded : liLoaded )
+	{
+		auto itClip = m_mapClips.find( loaded.strName );
+		if ( itClip == m_mapClips.end() || itClip->second.GetResidency() != Clip::EResidency::Loading )
+			continue;
+
+		// The audio thread won't look at the samples until it sees the clip is resident
+		if ( loaded.bSuccess )
+		{
+			itClip->second.Restore( loaded.clip );
+			itClip->second.SetResidency( Clip::EResidency::Resident );
+		}
+		else
+		{
+			std::cout << "Error loading clip " << loaded.strName << std::endl;
+			itClip->second.SetResidency( Clip::EResidency::NotResident );
+		}
+	}
+
+	// Prefetch reachable clips that aren't resident (first, so any it takes
+	// back from eviction are counted below rather than freed)
+	requestReachableClips();
+
+	// Free clips the audio thread has released, and see how much memory we're using.
+	// Clips being evicted don't count, they'll be freed soon enough
+	size_t uResidentBytes( 0 );
+	for ( auto& itClip : m_mapClips )
+	{
+		Clip& clip = itClip.second;
+		switch ( clip.GetResidency() )
+		{
+			case Clip::EResidency::Evicted:
+				clip.Evict();
+				clip.SetResidency( Clip::EResidency::NotResident );
+				break;
+			case Clip::EResidency::Resident:
+				uResidentBytes += clip.GetNumResidentBytes();
+				break;
+			default:
+				break;
+		}
+	}
+
+	// If we're over budget, evict unreachable clips (biggest first) until we aren't
+	if ( m_uClipMemoryBudget == 0 || uResidentBytes <= m_uClipMemoryBudget )
+		return;
+
+	std::list<Clip *> liEvictable;
+	for ( auto& itClip : m_mapClips )
+	{
+		// Clips Python is looking at stay put too
+		if ( itClip.second.IsResident() && m_setReachableClips.count( itClip.first ) == 0 && itClip.second.HasSampleViews() == false )
+			liEvictable.push_back( &itClip.second );
+	}
+	liEvictable.sort( [] ( const Clip * pA, const Clip * pB ) { return pA->GetNumResidentBytes() > pB->GetNumResidentBytes(); } );
+
+	// The audio thread decides if they can really go (they can't if a voice is using them)
+	std::list<Command> liEvictCommands;
+	for ( Clip * pClip : liEvictable )
+	{
+		if ( uResidentBytes <= m_uClipMemoryBudget )
+			break;
+
+		pClip->SetResidency( Clip::EResidency::Evicting );
+		uResidentBytes -= pClip->GetNumResidentBytes();
+
+		Command cmd;
+		cmd.eID = ECommandID::EvictClip;
+		cmd.pClip = pClip;
+		liEvictCommands.push_back( cmd );
+	}
+
+	if ( liEvictCommands.empty() )
+		return;
+
+	std::lock_guard<RTCheck::Mutex> lg( m_muAudioMutex );
+	m_liPublicCmdQueue.splice( m_liPublicCmdQueue.end(), liEvictCommands );
+}
+
+void SoundManager::SetClipMemoryBudget( size_t uNumBytes )
+{
+	m_uClipMemoryBudget = uNumBytes;
+}
+
+void SoundManager::SetReachableClips( std::set<std::string> setClipNames )
+{
+	m_setReachableClips = setClipNames;
+
+	// Start loading now, so StartLoops sent right after this find their clips on the way
+	requestReachableClips();
+}
+
+// Called by main thread, start loading any reachable clips that aren't resident
+void SoundManager::requestReachableClips()
+{
+	for ( const std::string& strClipName : m_setReachableClips )
+	{
+		auto itClip = m_mapClips.find( strClipName );
+		auto itSource = m_mapClipSources.find( strClipName );
+		if ( itClip == m_mapClips.end() || itSource == m_mapClipSources.end() )
+			continue;
+
+		Clip& clip = itClip->second;
+
+		// If it's waiting to be evicted, cancel that. If the audio thread
+		// got there first it's either been kept or released, and if it was
+		// released it gets loaded again below, skipping NotResident so a
+		// StartLoop waiting on it doesn't give up in between
+		if ( clip.GetResidency() == Clip::EResidency::Evicting )
+			clip.ChangeResidency( Clip::EResidency::Evicting, Clip::EResidency::Resident );
+
+		switch ( clip.GetResidency() )
+		{
+			// Free what the audio thread released, then load it again
+			case Clip::EResidency::Evicted:
+				clip.Evict();
+				clip.SetResidency( Clip::EResidency::Loading );
+				m_ClipLoader.Request( strClipName, itSource->second, m_AudioSpec );
+				break;
+
+			// Start loading it
+			case Clip::EResidency::NotResident:
+				clip.SetResidency( Clip::EResidency::Loading );
+				m_ClipLoader.Request( strClipName, itSource->second, m_AudioSpec );
+				break;
+
+			default:
+				break;
+		}
+	}
+}
+
+bool SoundManager::IsClipResident( std::string strClipName ) const
+{
+	auto itClip = m_mapClips.find( strClipName );
+	if ( itClip != m_mapClips.end() )
+		return itClip->second.IsResident();
+	return false;
+}
+
+size_t SoundManager::GetResidentClipBytes() const
 {
-	// Take any tasks the main thread has left us
-	// and put them into our queue
+	size_t uResidentBytes( 0 );
+	for ( auto& itClip : m_mapClips )
+		uResidentBytes += itClip.second.GetNumResidentBytes();
+	return uResidentBytes;
+}
+
+bool SoundManager::SetAudioLogFile( std::string strLogFile )
+{
+	FILE * pLogFile = stdout;
+	if ( strLogFile.empty() == false )
 	{
-		std::lock_guard<std::mutex> lg( m_muAudioMutex );
+		pLogFile = fopen( strLogFile.c_str(), "w" );
+		if ( pLogFile == nullptr )
+			return false;
+	}
 
-		// We're going to leave the main thread a task indicating how many
-		// buffers have completed since the last time it checked the queue
-		Command tNumBufsCompleted;
+	// Flush whatever's pending to the old file before switching
+	m_AudioLog.Drain( m_pAudioLogFile );
+	if ( m_pAudioLogFile && m_pAudioLogFile != stdout )
+		fclose( m_pAudioLogFile );
 
-		// Format the taks - we leave it with one buf
-		tNumBufsCompleted.eID = ECommandID::BufCompleted;
-		tNumBufsCompleted.uData = 1;
+	m_pAudioLogFile = pLogFile;
+
+	return true;
+}
 
-		// See if there's anything still in the public queue
-		if ( m_liPublicCmdQueue.empty() == false )
+// Called by audio thread, tries to lock mutex
+void SoundManager::updateTaskQueue()
+{
+	// This buffer is about to complete
+	m_uBufsUncounted++;
+
+	// Take any tasks the main thread has left us and put them into our
+	// queue. If the main thread has the lock we don't wait for it; the
+	// tasks and the buffer count will still be there next time
+	{
+		std::unique_lock<RTCheck::Mutex> lk( m_muAudioMutex, std::try_to_lock );
+		if ( lk.owns_lock() )
 		{
-			// The first task might be a leftover numBufsCompleted
-			// (happens if our buffer size is lower than the refresh rate)
-			Command tFront = m_liPublicCmdQueue.front();
-			if ( tFront.eID == ECommandID::BufCompleted )
-			{
-				// If it's a buf completed task, pop it off
-				// and add its sample count to the one declared above
-				tNumBufsCompleted.uData += tFront.uData;
-				m_liPublicCmdQueue.pop_front();
-			}
-
-			// Take all other tasks and add them to our queue
-			m_liAudioCmdQueue.splice( m_liAudioCmdQueue.end(), m_liPublicCmdQueue );
+			// Hand back what we handled last time, the main thread frees it
+			m_liRetiredCmds.splice( m_liRetiredCmds.end(), m_liHandledCmds );
+
+			// The front of the public queue is where we count completed buffers
+			// for the main thread, take every task after it
+			auto itFront = m_liPublicCmdQueue.begin();
+			itFront->uData += m_uBufsUncounted;
+			m_uBufsUncounted = 0;
+			m_liAudioCmdQueue.splice( m_liAudioCmdQueue.end(), m_liPublicCmdQueue, std::next( itFront ), m_liPublicCmdQueue.end() );
 		}
+	}
 
-		// The public queue is empty, leave it with the # of buffers completed
-		m_liPublicCmdQueue = { tNumBufsCompleted };
+	// Return any voices that have stopped to the pool
+	for ( auto itVoice = m_liVoices.begin(); itVoice != m_liVoices.end(); )
+	{
+		auto itNextVoice = std::next( itVoice );
+		if ( itVoice->GetState() == Voice::EState::Stopped )
+			m_liFreeVoices.splice( m_liFreeVoices.end(), m_liVoices, itVoice );
+		itVoice = itNextVoice;
 	}
 
-	// Remove any voices that have stopped
-	m_liVoices.remove_if( [] ( const Voice& v ) { return v.GetState() == Voice::EState::Stopped; } );
+	// Retry commands that were waiting on a clip before anything newer
+	m_liAudioCmdQueue.splice( m_liAudioCmdQueue.begin(), m_liDeferredCmds );
 
 	// Handle each task
-	for ( Command cmd : m_liAudioCmdQueue )
+	for ( auto itCmd = m_liAudioCmdQueue.begin(); itCmd != m_liAudioCmdQueue.end(); )
 	{
+		// Get the next one now, this one might be moved to the deferred list
+		Command& cmd = *itCmd;
+		auto itNextCmd = std::next( itCmd );
+
 		// Find the voice associated with the command's ID - this is dumb, but easy
-		auto prFindVoice = [cmd] ( const Voice& v ) { return v.GetID() == cmd.iData; };
+		const int iVoiceID = cmd.iData;
+		auto prFindVoice = [iVoiceID] ( const Voice& v ) { return v.GetID() == iVoiceID; };
 		auto itVoice = std::find_if( m_liVoices.begin(), m_liVoices.end(), prFindVoice );
 
+		// Once a voice has a command waiting on its clip, everything after it
+		// for that voice waits too, so they still happen in the order they were sent
+		const bool bVoiceCmd = cmd.eID == ECommandID::StartLoop || cmd.eID == ECommandID::OneShot ||
+			cmd.eID == ECommandID::StopLoop || cmd.eID == ECommandID::SetVolume;
+		auto prSameVoice = [iVoiceID] ( const Command& c ) { return c.iData == iVoiceID; };
+		if ( bVoiceCmd && std::any_of( m_liDeferredCmds.begin(), m_liDeferredCmds.end(), prSameVoice ) )
+		{
+			m_liDeferredCmds.splice( m_liDeferredCmds.end(), m_liAudioCmdQueue, itCmd );
+			itCmd = itNextCmd;
+			continue;
+		}
+
 		// Handle the command
 		switch ( cmd.eID )
 		{
-			// Start every loop
+			// Start every loop (that's resident)
 			case ECommandID::Start:
 				for ( auto& itLoop : m_mapClips )
-					m_liVoices.emplace_back( &itLoop.second, cmd.uData, cmd.fData, false );
+					if ( itLoop.second.IsResident() )
+						startVoice( Voice( &itLoop.second, cmd.uData, cmd.fData, false ) );
             break;
 
-			// Stop every loop
+			// Stop every loop, including any still waiting to start
 			case ECommandID::Stop:
 				for ( Voice& v : m_liVoices )
 					v.SetStopping( cmd.uData );
+				m_liHandledCmds.splice( m_liHandledCmds.end(), m_liDeferredCmds );
             break;
 
 			// Start a specific loop
 			case ECommandID::StartLoop:
 			case ECommandID::OneShot:
+				// Voices never touch clips that aren't resident, but if it may be
+				// soon hold on to the command (splicing doesn't allocate)
+				if ( cmd.pClip != nullptr && cmd.pClip->IsLoadPending() )
+					m_liDeferredCmds.splice( m_liDeferredCmds.end(), m_liAudioCmdQueue, itCmd );
+				else if ( cmd.pClip == nullptr || cmd.pClip->IsResident() == false )
+					m_AudioLog.Write( "Voice %d can't start, its clip isn't resident", cmd.iData );
                 // If it isn't already there, construct the voice
-				if ( itVoice == m_liVoices.end() )
-					m_liVoices.emplace_back( cmd );
+				else if ( itVoice == m_liVoices.end() )
+					startVoice( Voice( cmd ) );
                 // Otherwise try set the voice to pending
-                else
-                    itVoice->SetPending( cmd.uData, cmd.eID == ECommandID::StartLoop );
+                else if ( itVoice->SetPending( cmd.uData, cmd.eID == ECommandID::StartLoop ) == false )
+                    m_AudioLog.Write( "Voice %d is already playing!", cmd.iData );
             break;
 
 			// Stop a specific loop
 			case ECommandID::StopLoop:
 				if ( itVoice != m_liVoices.end() )
 					itVoice->SetStopping( cmd.uData );
+				else
+					m_AudioLog.Write( "StopLoop sent to unknown voice %d", cmd.iData );
             break;
 
 			// Set the volume of a loop
 			case ECommandID::SetVolume:
 				if ( itVoice != m_liVoices.end() )
 					itVoice->SetVolume( cmd.fData );
+				else
+					m_AudioLog.Write( "SetVolume sent to unknown voice %d", cmd.iData );
+            break;
+
+			// Start checking a mix cache (we reserved room for it)
+			case ECommandID::EnableMixCache:
+				if ( cmd.pMixCache && m_vAudioMixCaches.size() < m_vAudioMixCaches.capacity() )
+					m_vAudioMixCaches.push_back( cmd.pMixCache );
+            break;
+
+			// Release a clip if no voice is using it, otherwise keep it resident
+			// (unless the main thread cancelled the eviction, which it can do any time)
+			case ECommandID::EvictClip:
+				if ( cmd.pClip && cmd.pClip->GetResidency() == Clip::EResidency::Evicting )
+				{
+					const Clip * pClip = cmd.pClip;
+					auto prUsesClip = [pClip] ( const Voice& v ) { return v.GetClip() == pClip; };
+					const bool bInUse = std::any_of( m_liVoices.begin(), m_liVoices.end(), prUsesClip );
+					cmd.pClip->ChangeResidency( Clip::EResidency::Evicting, bInUse ? Clip::EResidency::Resident : Clip::EResidency::Evicted );
+				}
             break;
 
 			// Uhhh
@@ -284,11 +585,74 @@ void SoundManager::updateTaskQueue()
 			default:
 				break;
 		}
+
+		itCmd = itNextCmd;
+	}
+
+	// The audio thread doesn't care about anything else, but freeing
+	// the commands would be up to us, so they go back to the main thread
+	m_liHandledCmds.splice( m_liHandledCmds.end(), m_liAudioCmdQueue );
+}
+
+// Called by audio thread to play a voice, using one from the pool
+bool SoundManager::startVoice( const Voice& v )
+{
+	if ( m_liFreeVoices.empty() )
+	{
+		m_AudioLog.Write( "Voice %d can't start, every voice is in use", v.GetID() );
+		return false;
+	}
+
+	m_liFreeVoices.front() = v;
+	m_liVoices.splice( m_liVoices.end(), m_liFreeVoices, m_liFreeVoices.begin() );
+	return true;
+}
+
+// Called by audio thread after the task queue is handled
+void SoundManager::updateMixCaches()
+{
+	// Start with every cache inactive
+	for ( MixCache * pMix : m_vAudioMixCaches )
+		pMix->bActive = false;
+
+	// A cache can be used if all of its voices are steadily looping at the
+	// volume it was rendered with, they all started at the same position,
+	// and none of them are already being covered by another cache
+	for ( MixCache * pMix : m_vAudioMixCaches )
+	{
+		bool bValid = true;
+		size_t uStartingPos( 0 );
+		for ( size_t uIdx = 0; bValid && uIdx < pMix->vVoiceIDs.size(); uIdx++ )
+		{
+			const int iVoiceID = pMix->vVoiceIDs[uIdx];
+			auto itVoice = std::find_if( m_liVoices.begin(), m_liVoices.end(), [iVoiceID] ( const Voice& v ) { return v.GetID() == iVoiceID; } );
+			if ( itVoice == m_liVoices.end() || itVoice->IsSteadyLooping() == false || isVoiceMixCached( *itVoice ) )
+				bValid = false;
+			else if ( itVoice->GetVolume() != pMix->vVolumes[uIdx] )
+				bValid = false;
+			else if ( uIdx == 0 )
+				uStartingPos = itVoice->GetStartingPos();
+			else if ( itVoice->GetStartingPos() != uStartingPos )
+				bValid = false;
+		}
+
+		if ( bValid )
+		{
+			pMix->bActive = true;
+			pMix->uStartingPos = uStartingPos;
+		}
 	}
+}
 
-	// The audio thread doesn't care about anything else
-	// so clear the list
-	m_liAudioCmdQueue.clear();
+bool SoundManager::isVoiceMixCached( const Voice& v ) const
+{
+	for ( const MixCache * pMix : m_vAudioMixCaches )
+	{
+		if ( pMix->bActive && std::find( pMix->vVoiceIDs.begin(), pMix->vVoiceIDs.end(), v.GetID() ) != pMix->vVoiceIDs.end() )
+			return true;
+	}
+
+	return false;
 }
 
 bool SoundManager::Configure( std::map<std::string, int> mapAudCfg )
@@ -321,6 +685,9 @@ bool SoundManager::Configure( std::map<std::string, int> mapAudCfg )
 
 	m_bPlaying = false;
 
+	// The clock counts samples the way we do, all channels interleaved
+	m_AudioClock.SetRate( (uint64_t) received.freq * received.channels, (uint64_t) received.samples * received.channels );
+
 	return true;
 }
 
@@ -363,6 +730,31 @@ size_t SoundManager::GetNumBufsCompleted() const
 	return m_uNumBufsCompleted;
 }
 
+double SoundManager::GetPlaybackTime() const
+{
+	return m_AudioClock.GetTime();
+}
+
+float SoundManager::GetLoopPhase() const
+{
+	return m_AudioClock.GetLoopPhase();
+}
+
+const AudioClock& SoundManager::GetAudioClock() const
+{
+	return m_AudioClock;
+}
+
+const AudioTap& SoundManager::GetOutputTap() const
+{
+	return m_OutputTap;
+}
+
+uint32_t SoundManager::GetNumChannels() const
+{
+	return m_AudioSpec.channels;
+}
+
 size_t SoundManager::GetNumSamplesInClip( std::string strClipName, bool bTail /*= false*/ ) const
 {
 	auto it = m_mapClips.find( strClipName );
@@ -371,6 +763,40 @@ size_t SoundManager::GetNumSamplesInClip( std::string strClipName, bool bTail /*
 	return 0;
 }
 
+pyl::Object SoundManager::GetClipSamples( std::string strClipName, bool bTail )
+{
+	// Only resident clips have samples to look at (and evicting ones won't for long)
+	auto it = m_mapClips.find( strClipName );
+	if ( it == m_mapClips.end() || it->second.IsResident() == false || it->second.GetAudioData() == nullptr )
+		return pyl::Object();
+
+	// Samples are interleaved, so rows are frames and columns channels
+	Clip& clip = it->second;
+	const Py_ssize_t nChannels = std::max<Py_ssize_t>( m_AudioSpec.channels, 1 );
+	pyl::BufferInfo info;
+	info.pData = clip.GetAudioData();
+	info.format = "f";
+	info.itemsize = sizeof( float );
+	info.ndim = 2;
+	info.shape[0] = Py_ssize_t( clip.GetNumSamples( bTail ) ) / nChannels;
+	info.shape[1] = nChannels;
+	info.strides[0] = nChannels * sizeof( float );
+	info.strides[1] = sizeof( float );
+	info.readonly = true;
+
+	PyObject * pView = pyl::alloc_buffer( info, clip.GetSampleViewToken() );
+	if ( pView == nullptr )
+	{
+		PyErr_Print();
+		return pyl::Object();
+	}
+
+	// pyl::Object takes its own reference
+	pyl::Object obView( pView );
+	Py_DECREF( pView );
+	return obView;
+}
+
 SDL_AudioSpec const * SoundManager::GetAudioSpecPtr() const
 {
 	return &m_AudioSpec;
@@ -383,6 +809,8 @@ void SoundManager::fill_audio_impl( Uint8 * pStream, int nBytesToFill )
 	if ( pStream == nullptr || nBytesToFill == 0 )
 		return;
 
+	TRACE_SCOPE( "SoundManager::fill_audio_impl" );
+
 	// Silence no matter what
 	memset( pStream, 0, nBytesToFill );
 
@@ -390,16 +818,47 @@ void SoundManager::fill_audio_impl( Uint8 * pStream, int nBytesToFill )
 	// Also let them know a buffer is about to complete
 	updateTaskQueue();
 
+	// The number of float samples we want
+	const size_t uNumSamplesDesired = nBytesToFill / sizeof( float );
+
+	// Let readers know where this buffer starts (the loop only moves if something's playing)
+	m_AudioClock.Publish( m_uSamplesRendered, m_uSamplePos, m_liVoices.empty() ? 0 : m_uMaxSampleCount );
+	m_uSamplesRendered += uNumSamplesDesired;
+
 	// Nothing to do
 	if ( m_liVoices.empty() )
 		return;
 
-	// The number of float samples we want
-	const size_t uNumSamplesDesired = nBytesToFill / sizeof( float );
+	// See which voices can be rendered from a cached mix
+	updateMixCaches();
+
+	// Render active mix caches, indexing them the same way a looping voice would
+	for ( MixCache * pMix : m_vAudioMixCaches )
+	{
+		if ( pMix->bActive == false )
+			continue;
 
-	// Fill audio data for each loop
+		const size_t uSamplesInHead = pMix->vMixBuffer.size();
+		const size_t uOffsetPos = m_uSamplePos < pMix->uStartingPos ?
+			(uSamplesInHead - pMix->uStartingPos) + m_uSamplePos :
+			m_uSamplePos - pMix->uStartingPos;
+
+		float * const pMixBuffer = (float *) pStream;
+		size_t uMixIdx = uOffsetPos % uSamplesInHead;
+		for ( size_t uSampleIdx = 0; uSampleIdx < uNumSamplesDesired; uSampleIdx++ )
+		{
+			pMixBuffer[uSampleIdx] += pMix->vMixBuffer[uMixIdx];
+			if ( ++uMixIdx == uSamplesInHead )
+				uMixIdx = 0;
+		}
+	}
+
+	// Fill audio data for each loop not covered by a cache
 	for ( Voice& v : m_liVoices )
-		v.RenderData( (float *) pStream, uNumSamplesDesired, m_uSamplePos );
+	{
+		if ( isVoiceMixCached( v ) == false )
+			v.RenderData( (float *) pStream, uNumSamplesDesired, m_uSamplePos );
+	}
 
 	// Update sample counter, reset if we went over
 	m_uSamplePos += uNumSamplesDesired;
@@ -414,8 +873,17 @@ void SoundManager::fill_audio_impl( Uint8 * pStream, int nBytesToFill )
 // multiple instances are legit)
 /*static*/ void SoundManager::FillAudio( void * pUserData, Uint8 * pStream, int nSamplesDesired )
 {
+	// Mark this as the audio thread while we're in here (debug builds only)
+	RTCheck::ScopedAudioThread rtAudioThread;
+	Trace::SetThreadName( "audio" );
+
 	// livin on a prayer
-	((SoundManager *) pUserData)->fill_audio_impl( pStream, nSamplesDesired );
+	SoundManager * pSM = (SoundManager *) pUserData;
+	pSM->fill_audio_impl( pStream, nSamplesDesired );
+
+	// Let visualizers see what we played (silence included)
+	if ( pStream )
+		pSM->m_OutputTap.Write( (const float *) pStream, nSamplesDesired / sizeof( float ) );
 }
 
 // Expose the LM class and some functions
@@ -432,14 +900,28 @@ const std::string SoundManager::strModuleName = "pylSoundManager";
 	AddMemFnToMod( SoundManager, RegisterClip, bool, pSoundManagerModDef, std::string, std::string, std::string, size_t );
 	AddMemFnToMod( SoundManager, SendMessages, bool, pSoundManagerModDef, std::list<SoundManager::Message> );
 	AddMemFnToMod( SoundManager, SendMessage, bool, pSoundManagerModDef, SoundManager::Message );
+	AddMemFnToMod( SoundManager, CacheMix, bool, pSoundManagerModDef, std::string, std::list<SoundManager::MixCacheEntry> );
 	AddMemFnToMod( SoundManager, Update, void, pSoundManagerModDef );
 	AddMemFnToMod( SoundManager, GetSampleRate, size_t, pSoundManagerModDef );
 	AddMemFnToMod( SoundManager, GetMaxSampleCount, size_t, pSoundManagerModDef );
 	AddMemFnToMod( SoundManager, GetBufferSize, size_t, pSoundManagerModDef );
 	AddMemFnToMod( SoundManager, GetNumBufsCompleted, size_t, pSoundManagerModDef );
+	AddMemFnToMod( SoundManager, GetPlaybackTime, double, pSoundManagerModDef );
+	AddMemFnToMod( SoundManager, GetLoopPhase, float, pSoundManagerModDef );
 	AddMemFnToMod( SoundManager, GetNumSamplesInClip, size_t, pSoundManagerModDef, std::string, bool );
+	AddMemFnToMod( SoundManager, GetClipSamples, pyl::Object, pSoundManagerModDef, std::string, bool );
 	AddMemFnToMod( SoundManager, Configure, bool, pSoundManagerModDef, std::map<std::string, int> );
 	AddMemFnToMod( SoundManager, PlayPause, bool, pSoundManagerModDef );
+	AddMemFnToMod( SoundManager, SetAudioLogFile, bool, pSoundManagerModDef, std::string );
+	AddMemFnToMod( SoundManager, SetClipMemoryBudget, void, pSoundManagerModDef, size_t );
+	AddMemFnToMod( SoundManager, SetReachableClips, void, pSoundManagerModDef, std::set<std::string> );
+	AddMemFnToMod( SoundManager, IsClipResident, bool, pSoundManagerModDef, std::string );
+	AddMemFnToMod( SoundManager, GetResidentClipBytes, size_t, pSoundManagerModDef );
+
+	// Real-time safety checks (these do nothing unless built with RT_CHECK)
+	pSoundManagerModDef->RegisterFunction<PYL_FN( RTCheck::GetNumViolations )>( "GetNumRTViolations" );
+	pSoundManagerModDef->RegisterFunction<PYL_FN( RTCheck::PrintViolations )>( "PrintRTViolations" );
+	pSoundManagerModDef->RegisterFunction<PYL_FN( RTCheck::Reset )>( "ResetRTViolations" );
 
 	pSoundManagerModDef->SetCustomModuleInit( [] ( pyl::Object obModule )
 	{
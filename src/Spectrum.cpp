@@ -0,0 +1,153 @@
+#include "Spectrum.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+#define SPECTRUM_SSE
+#include <xmmintrin.h>
+#endif
+
+static const double kPi = 3.14159265358979323846;
+
+Spectrum::Spectrum() :
+	m_uSize( 0 )
+{
+}
+
+bool Spectrum::Init( uint32_t uSize )
+{
+	if ( uSize < 4 || (uSize & (uSize - 1)) != 0 )
+		return false;
+
+	m_uSize = uSize;
+	m_vRe.assign( uSize, 0.f );
+	m_vIm.assign( uSize, 0.f );
+
+	m_vWindow.resize( uSize );
+	for ( uint32_t i = 0; i < uSize; i++ )
+		m_vWindow[i] = (float) (0.5 - 0.5 * cos( 2 * kPi * i / uSize ));
+
+	uint32_t uNumBits = 0;
+	while ( (1u << uNumBits) < uSize )
+		uNumBits++;
+
+	m_vBitReverse.resize( uSize );
+	for ( uint32_t i = 0; i < uSize; i++ )
+	{
+		uint32_t uRev = 0;
+		for ( uint32_t b = 0; b < uNumBits; b++ )
+			uRev |= ((i >> b) & 1) << (uNumBits - 1 - b);
+		m_vBitReverse[i] = uRev;
+	}
+
+	// A stage combining halves of uHalf samples uses e^(-i pi k / uHalf) for k < uHalf
+	m_vTwiddleRe.clear();
+	m_vTwiddleIm.clear();
+	for ( uint32_t uHalf = 1; uHalf < uSize; uHalf <<= 1 )
+	{
+		for ( uint32_t k = 0; k < uHalf; k++ )
+		{
+			m_vTwiddleRe.push_back( (float) cos( kPi * k / uHalf ) );
+			m_vTwiddleIm.push_back( (float) -sin( kPi * k / uHalf ) );
+		}
+	}
+
+	return true;
+}
+
+uint32_t Spectrum::GetSize() const
+{
+	return m_uSize;
+}
+
+void Spectrum::Compute( const float * pSamples, float * pOut, float fFloorDB /*= -80.f*/ )
+{
+	if ( m_uSize == 0 || pSamples == nullptr || pOut == nullptr )
+		return;
+
+	// Window into bit reversed order
+	for ( uint32_t i = 0; i < m_uSize; i++ )
+	{
+		const uint32_t j = m_vBitReverse[i];
+		m_vRe[j] = pSamples[i] * m_vWindow[i];
+		m_vIm[j] = 0.f;
+	}
+
+	transform();
+
+	// A full scale sine would come out at N / 4 (half from the window, half from the
+	// negative frequency), so scale that to 1 before taking decibels
+	const float fScale = 4.f / m_uSize;
+	const float fRange = -fFloorDB;
+	for ( uint32_t k = 0; k < m_uSize / 2; k++ )
+	{
+		const float fMag = sqrtf( m_vRe[k] * m_vRe[k] + m_vIm[k] * m_vIm[k] ) * fScale;
+		const float fDB = 20.f * log10f( fMag + 1e-9f );
+		pOut[k] = std::min( std::max( (fDB - fFloorDB) / fRange, 0.f ), 1.f );
+	}
+}
+
+void Spectrum::transform()
+{
+	float * const pRe = m_vRe.data();
+	float * const pIm = m_vIm.data();
+	const uint32_t N = m_uSize;
+
+	// Halves of 1 and 2 samples (the twiddles are 1, and 1 or -i), done directly
+	for ( uint32_t s = 0; s < N; s += 2 )
+	{
+		const float ar = pRe[s], ai = pIm[s];
+		const float br = pRe[s + 1], bi = pIm[s + 1];
+		pRe[s] = ar + br; pIm[s] = ai + bi;
+		pRe[s + 1] = ar - br; pIm[s + 1] = ai - bi;
+	}
+	for ( uint32_t s = 0; s < N; s += 4 )
+	{
+		for ( uint32_t k = 0; k < 2; k++ )
+		{
+			// b * -i for k == 1
+			const float ar = pRe[s + k], ai = pIm[s + k];
+			const float br = k ? pIm[s + k + 2] : pRe[s + k + 2];
+			const float bi = k ? -pRe[s + k + 2] : pIm[s + k + 2];
+			pRe[s + k] = ar + br; pIm[s + k] = ai + bi;
+			pRe[s + k + 2] = ar - br; pIm[s + k + 2] = ai - bi;
+		}
+	}
+
+	// The rest have at least four butterflies per block, sharing twiddles across blocks
+	size_t uTwiddleOfs = 1 + 2;
+	for ( uint32_t uHalf = 4; uHalf < N; uTwiddleOfs += uHalf, uHalf <<= 1 )
+	{
+		const float * const pWr = &m_vTwiddleRe[uTwiddleOfs];
+		const float * const pWi = &m_vTwiddleIm[uTwiddleOfs];
+		for ( uint32_t s = 0; s < N; s += 2 * uHalf )
+		{
+			float * const pAr = pRe + s, * const pAi = pIm + s;
+			float * const pBr = pAr + uHalf, * const pBi = pAi + uHalf;
+#ifdef SPECTRUM_SSE
+			for ( uint32_t k = 0; k < uHalf; k += 4 )
+			{
+				const __m128 wr = _mm_loadu_ps( pWr + k ), wi = _mm_loadu_ps( pWi + k );
+				const __m128 br = _mm_loadu_ps( pBr + k ), bi = _mm_loadu_ps( pBi + k );
+				const __m128 ar = _mm_loadu_ps( pAr + k ), ai = _mm_loadu_ps( pAi + k );
+				const __m128 tr = _mm_sub_ps( _mm_mul_ps( br, wr ), _mm_mul_ps( bi, wi ) );
+				const __m128 ti = _mm_add_ps( _mm_mul_ps( br, wi ), _mm_mul_ps( bi, wr ) );
+				_mm_storeu_ps( pAr + k, _mm_add_ps( ar, tr ) );
+				_mm_storeu_ps( pAi + k, _mm_add_ps( ai, ti ) );
+				_mm_storeu_ps( pBr + k, _mm_sub_ps( ar, tr ) );
+				_mm_storeu_ps( pBi + k, _mm_sub_ps( ai, ti ) );
+			}
+#else
+			for ( uint32_t k = 0; k < uHalf; k++ )
+			{
+				const float tr = pBr[k] * pWr[k] - pBi[k] * pWi[k];
+				const float ti = pBr[k] * pWi[k] + pBi[k] * pWr[k];
+				const float ar = pAr[k], ai = pAi[k];
+				pAr[k] = ar + tr; pAi[k] = ai + ti;
+				pBr[k] = ar - tr; pBi[k] = ai - ti;
+			}
+#endif
+		}
+	}
+}
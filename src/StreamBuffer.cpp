@@ -0,0 +1,174 @@
+#include "StreamBuffer.h"
+
+StreamBuffer::StreamBuffer() :
+	m_Buffer( 0 ),
+	m_Target( GL_ARRAY_BUFFER ),
+	m_uFrameSize( 0 ),
+	m_uNumFrames( 0 ),
+	m_uFrameIdx( 0 ),
+	m_bPersistent( false ),
+	m_pMapped( nullptr ),
+	m_uNumStalls( 0 )
+{
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	Destroy();
+}
+
+bool StreamBuffer::Init( GLenum target, size_t uBytesPerFrame, size_t uNumFrames /*= 3*/ )
+{
+	Destroy();
+
+	if ( uBytesPerFrame == 0 || uNumFrames == 0 )
+		return false;
+
+	m_Target = target;
+	m_uFrameSize = uBytesPerFrame;
+	m_uNumFrames = uNumFrames;
+	m_uFrameIdx = 0;
+	m_vFences.assign( uNumFrames, nullptr );
+
+	const GLsizeiptr uTotalSize = m_uFrameSize * m_uNumFrames;
+
+	glGenBuffers( 1, &m_Buffer );
+	glBindBuffer( m_Target, m_Buffer );
+
+	if ( GLEW_ARB_buffer_storage )
+	{
+		// Map once, write forever
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage( m_Target, uTotalSize, nullptr, flags );
+		m_pMapped = (uint8_t *) glMapBufferRange( m_Target, 0, uTotalSize, flags );
+		m_bPersistent = (m_pMapped != nullptr);
+	}
+
+	if ( m_bPersistent == false )
+	{
+		// If we couldn't map, the buffer may have immutable storage; start over
+		glDeleteBuffers( 1, &m_Buffer );
+		glGenBuffers( 1, &m_Buffer );
+		glBindBuffer( m_Target, m_Buffer );
+		glBufferData( m_Target, uTotalSize, nullptr, GL_STREAM_DRAW );
+
+		m_vStaging.resize( m_uFrameSize );
+		m_pMapped = m_vStaging.data();
+	}
+
+	glBindBuffer( m_Target, 0 );
+
+	return true;
+}
+
+void StreamBuffer::Destroy()
+{
+	for ( GLsync& fence : m_vFences )
+	{
+		if ( fence )
+			glDeleteSync( fence );
+		fence = nullptr;
+	}
+
+	if ( m_Buffer )
+	{
+		if ( m_bPersistent )
+		{
+			glBindBuffer( m_Target, m_Buffer );
+			glUnmapBuffer( m_Target );
+			glBindBuffer( m_Target, 0 );
+		}
+		glDeleteBuffers( 1, &m_Buffer );
+		m_Buffer = 0;
+	}
+
+	m_pMapped = nullptr;
+	m_bPersistent = false;
+	m_vStaging.clear();
+}
+
+bool StreamBuffer::Reserve( size_t uBytes )
+{
+	if ( m_Buffer && uBytes <= m_uFrameSize )
+		return true;
+
+	// Grow by at least double to avoid doing this often
+	size_t uNewSize = std::max<size_t>( m_uFrameSize, 1024 );
+	while ( uNewSize < uBytes )
+		uNewSize *= 2;
+
+	return Init( m_Target, uNewSize, m_uNumFrames ? m_uNumFrames : 3 );
+}
+
+void * StreamBuffer::BeginFrame()
+{
+	if ( m_Buffer == 0 )
+		return nullptr;
+
+	// Make sure the GPU is done with the region we're about to write
+	GLsync& fence = m_vFences[m_uFrameIdx];
+	if ( fence )
+	{
+		// Check without blocking first, so we know if we stalled
+		GLenum eStatus = glClientWaitSync( fence, 0, 0 );
+		if ( eStatus == GL_TIMEOUT_EXPIRED )
+		{
+			m_uNumStalls++;
+			while ( eStatus == GL_TIMEOUT_EXPIRED )
+				eStatus = glClientWaitSync( fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 );
+		}
+
+		glDeleteSync( fence );
+		fence = nullptr;
+	}
+
+	if ( m_bPersistent )
+		return m_pMapped + GetFrameOffset();
+
+	// Staged writes go to the start of the staging buffer
+	return m_pMapped;
+}
+
+void StreamBuffer::EndWrite( size_t uBytesWritten )
+{
+	if ( m_Buffer == 0 )
+		return;
+
+	// Coherent mappings need no flush; staged writes get uploaded
+	if ( m_bPersistent == false && uBytesWritten )
+	{
+		glBindBuffer( m_Target, m_Buffer );
+		glBufferSubData( m_Target, GetFrameOffset(), std::min( uBytesWritten, m_uFrameSize ), m_vStaging.data() );
+		glBindBuffer( m_Target, 0 );
+	}
+}
+
+void StreamBuffer::EndFrame()
+{
+	if ( m_Buffer == 0 )
+		return;
+
+	// The GPU signals this once it's done with every command reading this region
+	m_vFences[m_uFrameIdx] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	m_uFrameIdx = (m_uFrameIdx + 1) % m_uNumFrames;
+}
+
+size_t StreamBuffer::GetFrameOffset() const
+{
+	return m_uFrameIdx * m_uFrameSize;
+}
+
+GLuint StreamBuffer::GetBuffer() const
+{
+	return m_Buffer;
+}
+
+bool StreamBuffer::IsPersistent() const
+{
+	return m_bPersistent;
+}
+
+size_t StreamBuffer::GetNumStalls() const
+{
+	return m_uNumStalls;
+}
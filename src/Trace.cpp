@@ -0,0 +1,139 @@
+#include "Trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+
+namespace Trace
+{
+	// Fixed limits, everything is allocated statically so recording never allocates
+	const size_t kMaxThreads = 16;
+	const size_t kMaxEventsPerThread = 8192;
+
+	// A complete ("X") event
+	struct Event
+	{
+		const char * szName;
+		uint64_t uBeginUS;
+		uint64_t uEndUS;
+	};
+
+	// Each thread that records gets one of these
+	struct ThreadBuffer
+	{
+		std::atomic<bool> bClaimed{ false };
+		std::atomic<const char *> szName{ nullptr };
+		std::atomic<uint64_t> uWritePos{ 0 };
+		Event aEvents[kMaxEventsPerThread];
+	};
+
+	static std::atomic<bool> s_bEnabled( false );
+	static ThreadBuffer s_aBuffers[kMaxThreads];
+	static thread_local ThreadBuffer * tl_pBuffer( nullptr );
+	static const std::chrono::steady_clock::time_point s_tStart = std::chrono::steady_clock::now();
+
+	// Claim a buffer for the calling thread (returns null if they're all taken)
+	static ThreadBuffer * getThreadBuffer()
+	{
+		if ( tl_pBuffer )
+			return tl_pBuffer;
+
+		for ( ThreadBuffer& buf : s_aBuffers )
+		{
+			bool bClaimed = false;
+			if ( buf.bClaimed.compare_exchange_strong( bClaimed, true ) )
+			{
+				tl_pBuffer = &buf;
+				break;
+			}
+		}
+
+		return tl_pBuffer;
+	}
+
+	void SetEnabled( bool bEnabled )
+	{
+		s_bEnabled.store( bEnabled );
+	}
+
+	bool IsEnabled()
+	{
+		return s_bEnabled.load( std::memory_order_relaxed );
+	}
+
+	void SetThreadName( const char * szName )
+	{
+		if ( ThreadBuffer * pBuf = getThreadBuffer() )
+			pBuf->szName.store( szName );
+	}
+
+	uint64_t Now()
+	{
+		using namespace std::chrono;
+		return (uint64_t) duration_cast<microseconds>(steady_clock::now() - s_tStart).count();
+	}
+
+	void Record( const char * szName, uint64_t uBeginUS, uint64_t uEndUS )
+	{
+		ThreadBuffer * pBuf = getThreadBuffer();
+		if ( pBuf == nullptr )
+			return;
+
+		// Overwrite the oldest event, then publish
+		const uint64_t uWritePos = pBuf->uWritePos.load( std::memory_order_relaxed );
+		Event& ev = pBuf->aEvents[uWritePos % kMaxEventsPerThread];
+		ev.szName = szName;
+		ev.uBeginUS = uBeginUS;
+		ev.uEndUS = uEndUS;
+		pBuf->uWritePos.store( uWritePos + 1, std::memory_order_release );
+	}
+
+	// Other threads may still be recording while we dump, so
+	// events at the very start of a full ring might be torn
+	bool Dump( std::string strFile, float fWindowSec )
+	{
+		FILE * fp = fopen( strFile.c_str(), "w" );
+		if ( fp == nullptr )
+			return false;
+
+		// Anything ending before this doesn't get written
+		const uint64_t uNow = Now();
+		const uint64_t uWindowUS = fWindowSec > 0.f ? (uint64_t) (fWindowSec * 1e6f) : uNow;
+		const uint64_t uCutoffUS = uWindowUS < uNow ? uNow - uWindowUS : 0;
+
+		fprintf( fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+
+		const char * szSep = "";
+		for ( size_t uTid = 0; uTid < kMaxThreads; uTid++ )
+		{
+			ThreadBuffer& buf = s_aBuffers[uTid];
+			if ( buf.bClaimed.load() == false )
+				continue;
+
+			// Name the thread, if it has one
+			if ( const char * szName = buf.szName.load() )
+			{
+				fprintf( fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}", szSep, uTid, szName );
+				szSep = ",\n";
+			}
+
+			const uint64_t uWritePos = buf.uWritePos.load( std::memory_order_acquire );
+			const uint64_t uFirstPos = uWritePos > kMaxEventsPerThread ? uWritePos - kMaxEventsPerThread : 0;
+			for ( uint64_t uPos = uFirstPos; uPos < uWritePos; uPos++ )
+			{
+				const Event& ev = buf.aEvents[uPos % kMaxEventsPerThread];
+				if ( ev.uEndUS < uCutoffUS || ev.szName == nullptr )
+					continue;
+
+				fprintf( fp, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%llu,\"dur\":%llu}",
+						 szSep, ev.szName, uTid, (unsigned long long) ev.uBeginUS, (unsigned long long) (ev.uEndUS - ev.uBeginUS) );
+				szSep = ",\n";
+			}
+		}
+
+		fprintf( fp, "\n]}\n" );
+		fclose( fp );
+
+		return true;
+	}
+}
@@ -0,0 +1,395 @@
+#include "TransformStore.h"
+
+#include <glm/mat4x4.hpp>
+
+#include <cmath>
+#include <cstring>
+
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+#define TRANSFORMSTORE_SSE
+#include <xmmintrin.h>
+#endif
+
+TransformStore::TransformStore() :
+	m_uCount( 0 ),
+	m_uNumRecomputed( 0 )
+{
+}
+
+uint32_t TransformStore::Add( const quatvec& qv, vec2 v2Scale )
+{
+	// Grow a block of 4 at a time, padding with identity transforms
+	if ( m_uCount % 4 == 0 )
+	{
+		const size_t uNewSize = m_uCount + 4;
+		m_vPosX.resize( uNewSize, 0.f );
+		m_vPosY.resize( uNewSize, 0.f );
+		m_vPosZ.resize( uNewSize, 0.f );
+		m_vQuatX.resize( uNewSize, 0.f );
+		m_vQuatY.resize( uNewSize, 0.f );
+		m_vQuatZ.resize( uNewSize, 0.f );
+		m_vQuatW.resize( uNewSize, 1.f );
+		m_vScaleX.resize( uNewSize, 1.f );
+		m_vScaleY.resize( uNewSize, 1.f );
+		m_vTransA.resize( uNewSize, 1.f );
+		m_vTransB.resize( uNewSize, 0.f );
+		m_vType.resize( uNewSize, (uint8_t) quatvec::Type::TR );
+		for ( auto pv : { &m_vLocalCX, &m_vLocalCY, &m_vLocalCZ, &m_vLocalEX, &m_vLocalEY, &m_vLocalEZ,
+						&m_vWorldCX, &m_vWorldCY, &m_vWorldCZ, &m_vWorldEX, &m_vWorldEY, &m_vWorldEZ } )
+			pv->resize( uNewSize, 0.f );
+		m_vVisible.resize( uNewSize, 1 );
+		m_vDirty.resize( uNewSize, 0 );
+		m_vMats.resize( uNewSize, mat4( 1 ) );
+	}
+
+	const uint32_t uIdx = (uint32_t) m_uCount++;
+	SetTransform( uIdx, qv );
+	SetScale( uIdx, v2Scale );
+
+	return uIdx;
+}
+
+size_t TransformStore::Size() const
+{
+	return m_uCount;
+}
+
+void TransformStore::Clear()
+{
+	m_uCount = 0;
+	m_vPosX.clear();
+	m_vPosY.clear();
+	m_vPosZ.clear();
+	m_vQuatX.clear();
+	m_vQuatY.clear();
+	m_vQuatZ.clear();
+	m_vQuatW.clear();
+	m_vScaleX.clear();
+	m_vScaleY.clear();
+	m_vTransA.clear();
+	m_vTransB.clear();
+	m_vType.clear();
+	for ( auto pv : { &m_vLocalCX, &m_vLocalCY, &m_vLocalCZ, &m_vLocalEX, &m_vLocalEY, &m_vLocalEZ,
+					&m_vWorldCX, &m_vWorldCY, &m_vWorldCZ, &m_vWorldEX, &m_vWorldEY, &m_vWorldEZ } )
+		pv->clear();
+	m_vVisible.clear();
+	m_vDirty.clear();
+	m_vMats.clear();
+}
+
+void TransformStore::SetPos( uint32_t uIdx, vec3 T )
+{
+	m_vPosX[uIdx] = T.x;
+	m_vPosY[uIdx] = T.y;
+	m_vPosZ[uIdx] = T.z;
+	m_vDirty[uIdx] = 1;
+}
+
+void TransformStore::Translate( uint32_t uIdx, vec3 T )
+{
+	m_vPosX[uIdx] += T.x;
+	m_vPosY[uIdx] += T.y;
+	m_vPosZ[uIdx] += T.z;
+	m_vDirty[uIdx] = 1;
+}
+
+void TransformStore::SetRot( uint32_t uIdx, fquat Q )
+{
+	m_vQuatX[uIdx] = Q.x;
+	m_vQuatY[uIdx] = Q.y;
+	m_vQuatZ[uIdx] = Q.z;
+	m_vQuatW[uIdx] = Q.w;
+	m_vDirty[uIdx] = 1;
+}
+
+void TransformStore::Rotate( uint32_t uIdx, fquat Q )
+{
+	fquat curQ( m_vQuatW[uIdx], m_vQuatX[uIdx], m_vQuatY[uIdx], m_vQuatZ[uIdx] );
+	SetRot( uIdx, Q * curQ );
+}
+
+void TransformStore::SetTransform( uint32_t uIdx, const quatvec& qv )
+{
+	SetPos( uIdx, qv.V );
+	SetRot( uIdx, qv.Q );
+	setType( uIdx, qv.T );
+}
+
+void TransformStore::Transform( uint32_t uIdx, const quatvec& qv )
+{
+	// Same as Drawable::Transform used to do
+	Translate( uIdx, qv.V );
+	Rotate( uIdx, qv.Q );
+}
+
+void TransformStore::SetScale( uint32_t uIdx, vec2 v2Scale )
+{
+	m_vScaleX[uIdx] = v2Scale.x;
+	m_vScaleY[uIdx] = v2Scale.y;
+	m_vDirty[uIdx] = 1;
+}
+
+void TransformStore::SetLocalBounds( uint32_t uIdx, vec3 v3Min, vec3 v3Max )
+{
+	m_vLocalCX[uIdx] = 0.5f * (v3Min.x + v3Max.x);
+	m_vLocalCY[uIdx] = 0.5f * (v3Min.y + v3Max.y);
+	m_vLocalCZ[uIdx] = 0.5f * (v3Min.z + v3Max.z);
+	m_vLocalEX[uIdx] = 0.5f * (v3Max.x - v3Min.x);
+	m_vLocalEY[uIdx] = 0.5f * (v3Max.y - v3Min.y);
+	m_vLocalEZ[uIdx] = 0.5f * (v3Max.z - v3Min.z);
+	m_vDirty[uIdx] = 1;
+}
+
+void TransformStore::setType( uint32_t uIdx, quatvec::Type eType )
+{
+	m_vType[uIdx] = (uint8_t) eType;
+	switch ( eType )
+	{
+		case quatvec::Type::TR:
+			m_vTransA[uIdx] = 1.f;
+			m_vTransB[uIdx] = 0.f;
+			break;
+		case quatvec::Type::RT:
+			m_vTransA[uIdx] = 0.f;
+			m_vTransB[uIdx] = 1.f;
+			break;
+		case quatvec::Type::TRT:
+			m_vTransA[uIdx] = 1.f;
+			m_vTransB[uIdx] = -1.f;
+			break;
+	}
+	m_vDirty[uIdx] = 1;
+}
+
+quatvec TransformStore::GetTransform( uint32_t uIdx ) const
+{
+	return quatvec( vec3( m_vPosX[uIdx], m_vPosY[uIdx], m_vPosZ[uIdx] ),
+					fquat( m_vQuatW[uIdx], m_vQuatX[uIdx], m_vQuatY[uIdx], m_vQuatZ[uIdx] ),
+					(quatvec::Type) m_vType[uIdx] );
+}
+
+vec2 TransformStore::GetScale( uint32_t uIdx ) const
+{
+	return vec2( m_vScaleX[uIdx], m_vScaleY[uIdx] );
+}
+
+const mat4& TransformStore::GetMat( uint32_t uIdx )
+{
+	if ( m_vDirty[uIdx] )
+		recomputeBlock( uIdx & ~3u );
+	return m_vMats[uIdx];
+}
+
+void TransformStore::Update()
+{
+	// Check four flags at once, rebuild blocks with anything dirty
+	for ( size_t uFirst = 0; uFirst < m_uCount; uFirst += 4 )
+	{
+		uint32_t uFlags( 0 );
+		memcpy( &uFlags, &m_vDirty[uFirst], sizeof( uFlags ) );
+		if ( uFlags )
+			recomputeBlock( uFirst );
+	}
+}
+
+void TransformStore::GetWorldBounds( uint32_t uIdx, vec3& v3Min, vec3& v3Max ) const
+{
+	const vec3 v3Center( m_vWorldCX[uIdx], m_vWorldCY[uIdx], m_vWorldCZ[uIdx] );
+	const vec3 v3Extent( m_vWorldEX[uIdx], m_vWorldEY[uIdx], m_vWorldEZ[uIdx] );
+	v3Min = v3Center - v3Extent;
+	v3Max = v3Center + v3Extent;
+}
+
+size_t TransformStore::Cull( const std::array<vec4, 6>& arPlanes )
+{
+	size_t uNumVisible( 0 );
+	for ( size_t i = 0; i < m_uCount; i++ )
+	{
+		// A box is outside if it's entirely behind any plane; the
+		// projected radius is how far the box reaches along the normal
+		bool bVisible = true;
+		for ( const vec4& plane : arPlanes )
+		{
+			const float fDist = plane.x * m_vWorldCX[i] + plane.y * m_vWorldCY[i] + plane.z * m_vWorldCZ[i] + plane.w;
+			const float fRadius = fabs( plane.x ) * m_vWorldEX[i] + fabs( plane.y ) * m_vWorldEY[i] + fabs( plane.z ) * m_vWorldEZ[i];
+			if ( fDist + fRadius < 0.f )
+			{
+				bVisible = false;
+				break;
+			}
+		}
+
+		m_vVisible[i] = bVisible ? 1 : 0;
+		if ( bVisible )
+			uNumVisible++;
+	}
+
+	return uNumVisible;
+}
+
+bool TransformStore::IsVisible( uint32_t uIdx ) const
+{
+	return m_vVisible[uIdx] != 0;
+}
+
+size_t TransformStore::TakeNumRecomputed()
+{
+	size_t uRet = m_uNumRecomputed;
+	m_uNumRecomputed = 0;
+	return uRet;
+}
+
+// Builds T * R * S for the four transforms starting at uFirst, where
+// R comes from the quaternion, S = scale(sx, sy, 1), and the translation
+// column depends on the quatvec type (see m_vTransA / m_vTransB). The
+// world bounds are the local box transformed by that matrix, with the
+// extents run through its absolute value so the box stays axis aligned
+void TransformStore::recomputeBlock( size_t uFirst )
+{
+	for ( size_t i = uFirst; i < uFirst + 4; i++ )
+	{
+		if ( m_vDirty[i] )
+			m_uNumRecomputed++;
+		m_vDirty[i] = 0;
+	}
+
+#ifdef TRANSFORMSTORE_SSE
+	// Each register holds one component of four transforms
+	const __m128 one = _mm_set1_ps( 1.f );
+	const __m128 two = _mm_set1_ps( 2.f );
+	const __m128 zero = _mm_setzero_ps();
+
+	const __m128 qx = _mm_loadu_ps( &m_vQuatX[uFirst] );
+	const __m128 qy = _mm_loadu_ps( &m_vQuatY[uFirst] );
+	const __m128 qz = _mm_loadu_ps( &m_vQuatZ[uFirst] );
+	const __m128 qw = _mm_loadu_ps( &m_vQuatW[uFirst] );
+
+	const __m128 xx = _mm_mul_ps( qx, qx ), yy = _mm_mul_ps( qy, qy ), zz = _mm_mul_ps( qz, qz );
+	const __m128 xy = _mm_mul_ps( qx, qy ), xz = _mm_mul_ps( qx, qz ), yz = _mm_mul_ps( qy, qz );
+	const __m128 wx = _mm_mul_ps( qw, qx ), wy = _mm_mul_ps( qw, qy ), wz = _mm_mul_ps( qw, qz );
+
+	// Rotation matrix, rCR is column C row R (same as glm::mat4_cast)
+	const __m128 r00 = _mm_sub_ps( one, _mm_mul_ps( two, _mm_add_ps( yy, zz ) ) );
+	const __m128 r01 = _mm_mul_ps( two, _mm_add_ps( xy, wz ) );
+	const __m128 r02 = _mm_mul_ps( two, _mm_sub_ps( xz, wy ) );
+	const __m128 r10 = _mm_mul_ps( two, _mm_sub_ps( xy, wz ) );
+	const __m128 r11 = _mm_sub_ps( one, _mm_mul_ps( two, _mm_add_ps( xx, zz ) ) );
+	const __m128 r12 = _mm_mul_ps( two, _mm_add_ps( yz, wx ) );
+	const __m128 r20 = _mm_mul_ps( two, _mm_add_ps( xz, wy ) );
+	const __m128 r21 = _mm_mul_ps( two, _mm_sub_ps( yz, wx ) );
+	const __m128 r22 = _mm_sub_ps( one, _mm_mul_ps( two, _mm_add_ps( xx, yy ) ) );
+
+	// Translation column, A * V + B * (R * V)
+	const __m128 vx = _mm_loadu_ps( &m_vPosX[uFirst] );
+	const __m128 vy = _mm_loadu_ps( &m_vPosY[uFirst] );
+	const __m128 vz = _mm_loadu_ps( &m_vPosZ[uFirst] );
+	const __m128 a = _mm_loadu_ps( &m_vTransA[uFirst] );
+	const __m128 b = _mm_loadu_ps( &m_vTransB[uFirst] );
+
+	const __m128 rvx = _mm_add_ps( _mm_add_ps( _mm_mul_ps( r00, vx ), _mm_mul_ps( r10, vy ) ), _mm_mul_ps( r20, vz ) );
+	const __m128 rvy = _mm_add_ps( _mm_add_ps( _mm_mul_ps( r01, vx ), _mm_mul_ps( r11, vy ) ), _mm_mul_ps( r21, vz ) );
+	const __m128 rvz = _mm_add_ps( _mm_add_ps( _mm_mul_ps( r02, vx ), _mm_mul_ps( r12, vy ) ), _mm_mul_ps( r22, vz ) );
+
+	const __m128 tx = _mm_add_ps( _mm_mul_ps( a, vx ), _mm_mul_ps( b, rvx ) );
+	const __m128 ty = _mm_add_ps( _mm_mul_ps( a, vy ), _mm_mul_ps( b, rvy ) );
+	const __m128 tz = _mm_add_ps( _mm_mul_ps( a, vz ), _mm_mul_ps( b, rvz ) );
+
+	// Scale the first two columns
+	const __m128 sx = _mm_loadu_ps( &m_vScaleX[uFirst] );
+	const __m128 sy = _mm_loadu_ps( &m_vScaleY[uFirst] );
+	const __m128 m00 = _mm_mul_ps( r00, sx ), m01 = _mm_mul_ps( r01, sx ), m02 = _mm_mul_ps( r02, sx );
+	const __m128 m10 = _mm_mul_ps( r10, sy ), m11 = _mm_mul_ps( r11, sy ), m12 = _mm_mul_ps( r12, sy );
+
+	// Transpose each column from SoA to one column per matrix and store it
+	float * pDst = &m_vMats[uFirst][0][0];
+	auto storeColumn = [pDst] ( size_t uCol, __m128 x, __m128 y, __m128 z, __m128 w )
+	{
+		_MM_TRANSPOSE4_PS( x, y, z, w );
+		_mm_storeu_ps( pDst + 0 * 16 + uCol * 4, x );
+		_mm_storeu_ps( pDst + 1 * 16 + uCol * 4, y );
+		_mm_storeu_ps( pDst + 2 * 16 + uCol * 4, z );
+		_mm_storeu_ps( pDst + 3 * 16 + uCol * 4, w );
+	};
+
+	storeColumn( 0, m00, m01, m02, zero );
+	storeColumn( 1, m10, m11, m12, zero );
+	storeColumn( 2, r20, r21, r22, zero );
+	storeColumn( 3, tx, ty, tz, one );
+
+	// World bounds, already in SoA form
+	const __m128 cx = _mm_loadu_ps( &m_vLocalCX[uFirst] );
+	const __m128 cy = _mm_loadu_ps( &m_vLocalCY[uFirst] );
+	const __m128 cz = _mm_loadu_ps( &m_vLocalCZ[uFirst] );
+	const __m128 ex = _mm_loadu_ps( &m_vLocalEX[uFirst] );
+	const __m128 ey = _mm_loadu_ps( &m_vLocalEY[uFirst] );
+	const __m128 ez = _mm_loadu_ps( &m_vLocalEZ[uFirst] );
+
+	auto transformCenter = [cx, cy, cz] ( __m128 a, __m128 b, __m128 c, __m128 t )
+	{
+		return _mm_add_ps( _mm_add_ps( _mm_mul_ps( a, cx ), _mm_mul_ps( b, cy ) ), _mm_add_ps( _mm_mul_ps( c, cz ), t ) );
+	};
+	const __m128 signMask = _mm_set1_ps( -0.f );
+	auto transformExtent = [ex, ey, ez, signMask] ( __m128 a, __m128 b, __m128 c )
+	{
+		a = _mm_andnot_ps( signMask, a );
+		b = _mm_andnot_ps( signMask, b );
+		c = _mm_andnot_ps( signMask, c );
+		return _mm_add_ps( _mm_add_ps( _mm_mul_ps( a, ex ), _mm_mul_ps( b, ey ) ), _mm_mul_ps( c, ez ) );
+	};
+
+	_mm_storeu_ps( &m_vWorldCX[uFirst], transformCenter( m00, m10, r20, tx ) );
+	_mm_storeu_ps( &m_vWorldCY[uFirst], transformCenter( m01, m11, r21, ty ) );
+	_mm_storeu_ps( &m_vWorldCZ[uFirst], transformCenter( m02, m12, r22, tz ) );
+	_mm_storeu_ps( &m_vWorldEX[uFirst], transformExtent( m00, m10, r20 ) );
+	_mm_storeu_ps( &m_vWorldEY[uFirst], transformExtent( m01, m11, r21 ) );
+	_mm_storeu_ps( &m_vWorldEZ[uFirst], transformExtent( m02, m12, r22 ) );
+#else
+	// Same math, one transform at a time
+	for ( size_t i = uFirst; i < uFirst + 4; i++ )
+	{
+		const float qx = m_vQuatX[i], qy = m_vQuatY[i], qz = m_vQuatZ[i], qw = m_vQuatW[i];
+		const float xx = qx * qx, yy = qy * qy, zz = qz * qz;
+		const float xy = qx * qy, xz = qx * qz, yz = qy * qz;
+		const float wx = qw * qx, wy = qw * qy, wz = qw * qz;
+
+		mat4& M = m_vMats[i];
+		M[0][0] = 1.f - 2.f * (yy + zz);
+		M[0][1] = 2.f * (xy + wz);
+		M[0][2] = 2.f * (xz - wy);
+		M[0][3] = 0.f;
+		M[1][0] = 2.f * (xy - wz);
+		M[1][1] = 1.f - 2.f * (xx + zz);
+		M[1][2] = 2.f * (yz + wx);
+		M[1][3] = 0.f;
+		M[2][0] = 2.f * (xz + wy);
+		M[2][1] = 2.f * (yz - wx);
+		M[2][2] = 1.f - 2.f * (xx + yy);
+		M[2][3] = 0.f;
+
+		const float vx = m_vPosX[i], vy = m_vPosY[i], vz = m_vPosZ[i];
+		const float a = m_vTransA[i], b = m_vTransB[i];
+		for ( int r = 0; r < 3; r++ )
+		{
+			const float rv = M[0][r] * vx + M[1][r] * vy + M[2][r] * vz;
+			M[3][r] = a * (r == 0 ? vx : r == 1 ? vy : vz) + b * rv;
+		}
+		M[3][3] = 1.f;
+
+		for ( int r = 0; r < 3; r++ )
+		{
+			M[0][r] *= m_vScaleX[i];
+			M[1][r] *= m_vScaleY[i];
+		}
+
+		const vec3 c( m_vLocalCX[i], m_vLocalCY[i], m_vLocalCZ[i] );
+		const vec3 e( m_vLocalEX[i], m_vLocalEY[i], m_vLocalEZ[i] );
+		float * arWorldC[3] = { &m_vWorldCX[i], &m_vWorldCY[i], &m_vWorldCZ[i] };
+		float * arWorldE[3] = { &m_vWorldEX[i], &m_vWorldEY[i], &m_vWorldEZ[i] };
+		for ( int r = 0; r < 3; r++ )
+		{
+			*arWorldC[r] = M[0][r] * c.x + M[1][r] * c.y + M[2][r] * c.z + M[3][r];
+			*arWorldE[r] = fabs( M[0][r] ) * e.x + fabs( M[1][r] ) * e.y + fabs( M[2][r] ) * e.z;
+		}
+	}
+#endif
+}
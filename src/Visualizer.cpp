@@ -0,0 +1,122 @@
+#include "Visualizer.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// How much of a bar's height it keeps each update when the level drops
+static const float kBarDecay = 0.85f;
+
+Visualizer::Visualizer() :
+	Visualizer( vec2( 0 ), vec2( 1 ), vec4( 1 ), vec4( 1 ) )
+{
+}
+
+Visualizer::Visualizer( vec2 v2Pos, vec2 v2Scale, vec4 v4WaveColor, vec4 v4SpectrumColor, uint32_t uWindowSize /*= 1024*/ ) :
+	m_v2Pos( v2Pos ),
+	m_v2Scale( v2Scale ),
+	m_v4WaveColor( v4WaveColor ),
+	m_v4SpectrumColor( v4SpectrumColor )
+{
+	if ( m_Spectrum.Init( uWindowSize ) == false )
+		m_Spectrum.Init( 1024 );
+
+	const uint32_t uSize = m_Spectrum.GetSize();
+	const uint32_t uNumBins = uSize / 2;
+	m_vWindow.assign( uSize, 0.f );
+	m_vMagnitudes.assign( uNumBins, 0.f );
+	m_vBars.assign( kNumBars, 0.f );
+
+	// Bars cover bins 1 (skipping DC) through the last, evenly in log frequency;
+	// each gets at least one bin, so the low bars aren't empty
+	m_vBarBins.resize( kNumBars + 1 );
+	m_vBarBins[0] = 1;
+	for ( uint32_t b = 1; b <= kNumBars; b++ )
+	{
+		const uint32_t uBin = (uint32_t) std::round( std::pow( (float) uNumBins, (float) b / kNumBars ) );
+		m_vBarBins[b] = std::min( std::max( uBin, m_vBarBins[b - 1] + 1 ), uNumBins );
+	}
+}
+
+void Visualizer::Update( const AudioTap& tap, uint32_t uNumChannels )
+{
+	const uint32_t uSize = m_Spectrum.GetSize();
+	uNumChannels = std::max( uNumChannels, 1u );
+
+	// Downmix the latest window (zeros in front if we don't have that much yet)
+	m_vInterleaved.resize( (size_t) uSize * uNumChannels );
+	const size_t uNumRead = tap.ReadLatest( m_vInterleaved.data(), m_vInterleaved.size() ) / uNumChannels;
+	const size_t uNumMissing = uSize - uNumRead;
+	std::fill( m_vWindow.begin(), m_vWindow.begin() + uNumMissing, 0.f );
+	for ( size_t i = 0; i < uNumRead; i++ )
+	{
+		float fSum = 0.f;
+		for ( uint32_t c = 0; c < uNumChannels; c++ )
+			fSum += m_vInterleaved[i * uNumChannels + c];
+		m_vWindow[uNumMissing + i] = fSum / uNumChannels;
+	}
+
+	m_Spectrum.Compute( m_vWindow.data(), m_vMagnitudes.data() );
+
+	// Bars jump up to the loudest bin they cover and fall back slowly
+	for ( uint32_t b = 0; b < kNumBars; b++ )
+	{
+		const auto itBegin = m_vMagnitudes.begin() + m_vBarBins[b];
+		const auto itEnd = m_vMagnitudes.begin() + std::max( m_vBarBins[b + 1], m_vBarBins[b] + 1 );
+		const float fLevel = itBegin < m_vMagnitudes.end() ? *std::max_element( itBegin, std::min( itEnd, m_vMagnitudes.end() ) ) : 0.f;
+		m_vBars[b] = std::max( fLevel, m_vBars[b] * kBarDecay );
+	}
+}
+
+uint32_t Visualizer::AppendWaveform( std::vector<float>& vVerts ) const
+{
+	// Centered in the top half
+	const uint32_t uNumVerts = (uint32_t) m_vWindow.size();
+	const float fDX = 2.f / (uNumVerts - 1);
+	for ( uint32_t i = 0; i < uNumVerts; i++ )
+	{
+		const float fSample = std::min( std::max( m_vWindow[i], -1.f ), 1.f );
+		vVerts.insert( vVerts.end(), { -1.f + i * fDX, 0.5f + 0.45f * fSample, 0.f } );
+	}
+	return uNumVerts;
+}
+
+uint32_t Visualizer::AppendSpectrum( std::vector<float>& vVerts ) const
+{
+	// Rising from the bottom edge, two vertices per bar so the tops are flat
+	const float fDX = 2.f / kNumBars;
+	for ( uint32_t b = 0; b < kNumBars; b++ )
+	{
+		const float fY = -1.f + 0.95f * m_vBars[b];
+		vVerts.insert( vVerts.end(), { -1.f + b * fDX, fY, 0.f, -1.f + (b + 1) * fDX, fY, 0.f } );
+	}
+	return 2 * kNumBars;
+}
+
+mat4 Visualizer::GetMV() const
+{
+	return glm::translate( vec3( m_v2Pos, 0 ) ) * glm::scale( vec3( m_v2Scale, 1 ) );
+}
+
+vec4 Visualizer::GetWaveColor() const
+{
+	return m_v4WaveColor;
+}
+
+vec4 Visualizer::GetSpectrumColor() const
+{
+	return m_v4SpectrumColor;
+}
+
+void Visualizer::SetPos( vec2 v2Pos )
+{
+	m_v2Pos = v2Pos;
+}
+
+void Visualizer::SetColors( vec4 v4WaveColor, vec4 v4SpectrumColor )
+{
+	m_v4WaveColor = v4WaveColor;
+	m_v4SpectrumColor = v4SpectrumColor;
+}
@@ -16,7 +16,7 @@ Voice::Voice() :
 {}
 
 // Don't set anything until the pointer and ID are checked
-Voice::Voice( const Clip const * pClip, int ID, size_t uTriggerRes, float fVolume, bool bLoop /*= false*/ ) :
+Voice::Voice( const Clip * pClip, int ID, size_t uTriggerRes, float fVolume, bool bLoop /*= false*/ ) :
     Voice()
 {
     // If these are valid, assign members
@@ -71,6 +71,57 @@ int Voice::GetID() const
 	return m_iUniqueID;
 }
 
+const Clip * Voice::GetClip() const
+{
+	return m_pClip;
+}
+
+size_t Voice::GetStartingPos() const
+{
+	return m_uStartingPos;
+}
+
+bool Voice::IsSteadyLooping() const
+{
+	if ( m_eState != EState::Looping || m_pClip == nullptr )
+		return false;
+
+	// If we're still rendering a previous tail, we aren't periodic
+	return m_uLastTailSampleAdded >= m_pClip->GetNumSamples( true );
+}
+
+// This should match what RenderData does in the Looping state
+/*static*/ void Voice::RenderSteadyLoop( const Clip * const pClip, const float fVolume, float * const pMixBuffer )
+{
+	if ( pClip == nullptr || pMixBuffer == nullptr || fVolume <= 0.f )
+		return;
+
+	const size_t uTotalSampleCount = pClip->GetNumSamples( true );
+	const size_t uSamplesInHead = pClip->GetNumSamples( false );
+	const size_t uSamplesInTail = uTotalSampleCount - uSamplesInHead;
+	const size_t uFadeBegin = uSamplesInHead - pClip->GetNumFadeSamples();
+	const float * const pAudioData = pClip->GetAudioData();
+	if ( uSamplesInHead == 0 || pAudioData == nullptr )
+		return;
+
+	// The loopback fade target is (head+tail)[0]
+	float fTargetVal = *pAudioData;
+	if ( uSamplesInTail )
+		fTargetVal += pAudioData[uSamplesInHead];
+
+	// Head samples before the fade
+	for ( size_t uHeadIdx = 0; uHeadIdx < uFadeBegin; uHeadIdx++ )
+		pMixBuffer[uHeadIdx] += fVolume * pAudioData[uHeadIdx];
+
+	// Fade out to the target
+	for ( size_t uFadeIdx = uFadeBegin; uFadeIdx < uSamplesInHead; uFadeIdx++ )
+		pMixBuffer[uFadeIdx] += remap( uFadeIdx, uFadeBegin, uSamplesInHead, fVolume * pAudioData[uFadeIdx], fTargetVal );
+
+	// The tail is mixed in on top of the start of the head
+	for ( size_t uTailIdx = uSamplesInHead; uTailIdx < uTotalSampleCount; uTailIdx++ )
+		pMixBuffer[uTailIdx - uSamplesInHead] += fVolume * pAudioData[uTailIdx];
+}
+
 // Handle the transition to stopping appropriately
 void Voice::SetStopping( const size_t uTriggerRes )
 {
@@ -106,7 +157,7 @@ void Voice::SetStopping( const size_t uTriggerRes )
 	m_uTriggerRes = uTriggerRes;
 }
 
-void Voice::SetPending(const size_t uTriggerRes, bool bLoop /*= false*/)
+bool Voice::SetPending(const size_t uTriggerRes, bool bLoop /*= false*/)
 {
 	EState eNextState = m_eState;
     switch(m_eState){
@@ -130,8 +181,8 @@ void Voice::SetPending(const size_t uTriggerRes, bool bLoop /*= false*/)
         case EState::Starting:
         case EState::Looping:
 		case EState::Stopping:
-			//std::cout << "Voice " << m_pClip->GetName() << " " << m_iUniqueID << " is already playing!" << std::endl;
-            return;
+			// The caller can log this, we're on the audio thread
+            return false;
 
         // If we're tailing or stopped, set the appropriate pending state
         case EState::Tail:
@@ -147,6 +198,8 @@ void Voice::SetPending(const size_t uTriggerRes, bool bLoop /*= false*/)
     setState(eNextState);
     m_uTriggerRes = uTriggerRes;
     m_uStartingPos = 0;
+
+    return true;
 }
 
 void Voice::SetVolume( float fVol )
@@ -174,7 +227,7 @@ void Voice::RenderData( float * const pMixBuffer, const size_t uSamplesDesired,
 	const size_t uSamplesInTail = uTotalSampleCount - uSamplesInHead;
 	const size_t uFadeSamples = m_pClip->GetNumFadeSamples();
 	const size_t uFadeBegin = uSamplesInHead - uFadeSamples;
-	const float const * pAudioData = m_pClip->GetAudioData();
+	const float * const pAudioData = m_pClip->GetAudioData();
 
 	// Just another early out check
 	if ( uSamplesInHead == 0 || pAudioData == nullptr )
@@ -7,6 +7,7 @@
 #include <iostream>
 #include <stdexcept>
 #include "Scene.h"
+#include "Trace.h"
 
 int main(int argc, char ** argv)
 {
@@ -21,14 +22,22 @@ int main(int argc, char ** argv)
 		pyl::Object obDriverModule = pyl::Object::from_script( "../scripts/driver.py" );
 		Scene S( obDriverModule );
 
+		// Name this thread in traces
+		Trace::SetThreadName( "main" );
+
 		// Loop until the script sets the quit flag
 		while ( S.GetQuitFlag() == false )
 		{
+			TRACE_SCOPE( "Frame" );
+
 			// Let python handle events
-			SDL_Event e;
-			while ( SDL_PollEvent( &e ) && S.GetQuitFlag() == false )
 			{
-				obDriverModule.call_function( "HandleEvent", &e );
+				TRACE_SCOPE( "HandleEvents" );
+				SDL_Event e;
+				while ( SDL_PollEvent( &e ) && S.GetQuitFlag() == false )
+				{
+					obDriverModule.call_function( "HandleEvent", &e );
+				}
 			}
 
 			// Update the scene, draw
@@ -0,0 +1,229 @@
+// Drives SoundManager::FillAudio the way SDL would and makes sure the
+// audio thread never allocates, frees, or blocks on a lock while doing it.
+// Only meaningful with the RT_CHECK cmake option on (which builds this)
+
+#include "SoundManager.h"
+#include "RTCheck.h"
+
+#include <pyliason.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <stdint.h>
+
+// Print and count anything that doesn't hold
+static int s_nFailures( 0 );
+#define RT_TEST_CHECK(cond) do { if ( !(cond) ) { printf( "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond ); s_nFailures++; } } while ( 0 )
+
+// Device settings (SDL_LoadWAV always reports 4096 samples, and clips must match)
+static const int kSampleRate = 44100;
+static const int kNumChannels = 2;
+static const int kBufferFrames = 300;	// Doesn't divide the loops, so triggers land mid buffer
+static const int kWavSpecSamples = 4096;
+
+// Write a 32 bit float WAV file of a sine wave
+static bool writeWav( const std::string strFile, size_t uNumFrames, float fFreq )
+{
+	FILE * fp = fopen( strFile.c_str(), "wb" );
+	if ( fp == nullptr )
+		return false;
+
+	std::vector<float> vSamples( uNumFrames * kNumChannels );
+	for ( size_t uFrame = 0; uFrame < uNumFrames; uFrame++ )
+		for ( int iChannel = 0; iChannel < kNumChannels; iChannel++ )
+			vSamples[uFrame * kNumChannels + iChannel] = 0.25f * (float) sin( 6.2831853 * fFreq * uFrame / kSampleRate );
+
+	auto write16 = [fp] ( uint16_t u ) { fwrite( &u, sizeof( u ), 1, fp ); };
+	auto write32 = [fp] ( uint32_t u ) { fwrite( &u, sizeof( u ), 1, fp ); };
+	const uint32_t uDataBytes = (uint32_t) (vSamples.size() * sizeof( float ));
+	fwrite( "RIFF", 1, 4, fp );
+	write32( 36 + uDataBytes );
+	fwrite( "WAVEfmt ", 1, 8, fp );
+	write32( 16 );
+	write16( 3 );	// IEEE float
+	write16( kNumChannels );
+	write32( kSampleRate );
+	write32( kSampleRate * kNumChannels * sizeof( float ) );
+	write16( kNumChannels * sizeof( float ) );
+	write16( 32 );
+	fwrite( "data", 1, 4, fp );
+	write32( uDataBytes );
+	fwrite( vSamples.data(), sizeof( float ), vSamples.size(), fp );
+
+	fclose( fp );
+	return true;
+}
+
+// A StartLoop or StopLoop message, as the scripts would send it
+static SoundManager::Message loopMessage( SoundManager::ECommandID eID, const char * szClip, int iVoiceID, size_t uTriggerRes )
+{
+	PyObject * pData = Py_BuildValue( "(sifn)", szClip, iVoiceID, 1.f, (Py_ssize_t) uTriggerRes );
+	return SoundManager::Message( (int) eID, pyl::Object( pData ) );
+}
+
+// Run some buffers through the callback, letting the main thread catch up in between
+static void fillBuffers( SoundManager& sm, int nBuffers, std::vector<float>& vBuffer )
+{
+	for ( int i = 0; i < nBuffers; i++ )
+	{
+		SoundManager::FillAudio( &sm, (Uint8 *) vBuffer.data(), (int) (vBuffer.size() * sizeof( float )) );
+		sm.Update();
+	}
+}
+
+// Keep filling buffers until a clip is resident (it's loading on another thread)
+static bool fillUntilResident( SoundManager& sm, const char * szClip, std::vector<float>& vBuffer )
+{
+	for ( int i = 0; i < 1000 && sm.IsClipResident( szClip ) == false; i++ )
+	{
+		fillBuffers( sm, 1, vBuffer );
+		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+	}
+	return sm.IsClipResident( szClip );
+}
+
+// The loudest sample in the last buffer played
+static float latestPeak( const SoundManager& sm, size_t uNumSamples )
+{
+	std::vector<float> vPlayed( uNumSamples );
+	if ( sm.GetOutputTap().ReadLatest( vPlayed.data(), vPlayed.size() ) != vPlayed.size() )
+		return 0.f;
+
+	float fPeak( 0.f );
+	for ( float fSample : vPlayed )
+		fPeak = std::max( fPeak, fabsf( fSample ) );
+	return fPeak;
+}
+
+int main()
+{
+	Py_Initialize();
+
+	// Two clips with the same head length, so they can share a mix cache
+	const size_t uHeadFrames = 2048;
+	const size_t uHeadSamples = uHeadFrames * kNumChannels;
+	if ( writeWav( "rtcheck_a_head.wav", uHeadFrames, 440.f ) == false ||
+		 writeWav( "rtcheck_a_tail.wav", 256, 440.f ) == false ||
+		 writeWav( "rtcheck_b_head.wav", uHeadFrames, 660.f ) == false ||
+		 writeWav( "rtcheck_b_tail.wav", 256, 660.f ) == false )
+	{
+		printf( "Unable to write test clips\n" );
+		return 1;
+	}
+
+	SDL_AudioSpec spec{};
+	spec.freq = kSampleRate;
+	spec.format = AUDIO_F32;
+	spec.channels = kNumChannels;
+	spec.samples = kWavSpecSamples;
+
+	int nBuffersFilled( 0 );
+	{
+		SoundManager sm( spec );
+		RT_TEST_CHECK( sm.RegisterClip( "a", "rtcheck_a_head.wav", "rtcheck_a_tail.wav", 64 ) );
+		RT_TEST_CHECK( sm.RegisterClip( "b", "rtcheck_b_head.wav", "rtcheck_b_tail.wav", 64 ) );
+		RT_TEST_CHECK( sm.CacheMix( "ab", { SoundManager::MixCacheEntry( "a", 0, 1.f ), SoundManager::MixCacheEntry( "b", 1, 1.f ) } ) );
+
+		std::vector<float> vBuffer( kBufferFrames * kNumChannels );
+		const int nBuffersPerLoop = (int) (uHeadSamples / vBuffer.size()) + 1;
+
+		// Nothing may allocate, free, or lock on the audio thread from here on
+		RTCheck::Reset();
+
+		// An idle buffer, then start both loops together
+		fillBuffers( sm, 1, vBuffer );
+		RT_TEST_CHECK( sm.SendMessages( {
+			loopMessage( SoundManager::ECommandID::StartLoop, "a", 0, uHeadSamples ),
+			loopMessage( SoundManager::ECommandID::StartLoop, "b", 1, uHeadSamples ) } ) );
+
+		// Wait for them to start, then loop a few times (their steady
+		// state is the cached mix, so that's what gets played)
+		fillBuffers( sm, 4 * nBuffersPerLoop, vBuffer );
+
+		// Stop one, let its tail play out, and stop the other
+		RT_TEST_CHECK( sm.SendMessage( loopMessage( SoundManager::ECommandID::StopLoop, "a", 0, uHeadSamples ) ) );
+		fillBuffers( sm, 2 * nBuffersPerLoop, vBuffer );
+		RT_TEST_CHECK( sm.SendMessage( SoundManager::Message( (int) SoundManager::ECommandID::Stop, pyl::Object( PyLong_FromSize_t( uHeadSamples ) ) ) ) );
+		fillBuffers( sm, 2 * nBuffersPerLoop, vBuffer );
+
+		// And start one again, which reuses a stopped voice
+		RT_TEST_CHECK( sm.SendMessage( loopMessage( SoundManager::ECommandID::StartLoop, "b", 1, uHeadSamples ) ) );
+		fillBuffers( sm, 2 * nBuffersPerLoop, vBuffer );
+
+		nBuffersFilled = 1 + 10 * nBuffersPerLoop;
+		RT_TEST_CHECK( sm.GetNumBufsCompleted() == (size_t) nBuffersFilled );
+
+		// Something should have been played
+		RT_TEST_CHECK( latestPeak( sm, vBuffer.size() ) > 0.f );
+	}
+
+	// Clips coming and going while the audio thread runs
+	{
+		SoundManager sm( spec );
+		RT_TEST_CHECK( sm.RegisterClip( "a", "rtcheck_a_head.wav", "rtcheck_a_tail.wav", 64 ) );
+
+		std::vector<float> vBuffer( kBufferFrames * kNumChannels );
+		const int nBuffersPerLoop = (int) (uHeadSamples / vBuffer.size()) + 1;
+
+		// Put it up for eviction, then make it reachable before the audio
+		// thread gets to it, which should keep it resident
+		sm.SetClipMemoryBudget( 1 );
+		sm.SetReachableClips( {} );
+		sm.Update();
+		RT_TEST_CHECK( sm.IsClipResident( "a" ) == false );
+		sm.SetReachableClips( { "a" } );
+		RT_TEST_CHECK( sm.IsClipResident( "a" ) );
+		fillBuffers( sm, 2, vBuffer );
+		RT_TEST_CHECK( sm.IsClipResident( "a" ) );
+
+		// Now let it really be evicted
+		sm.SetReachableClips( {} );
+		fillBuffers( sm, 2, vBuffer );
+		RT_TEST_CHECK( sm.IsClipResident( "a" ) == false );
+
+		// Start and stop it while it's loading again; the stop has to wait
+		// for the start, and the two together shouldn't play anything
+		sm.SetReachableClips( { "a" } );
+		RT_TEST_CHECK( sm.SendMessages( {
+			loopMessage( SoundManager::ECommandID::StartLoop, "a", 0, uHeadSamples ),
+			loopMessage( SoundManager::ECommandID::StopLoop, "a", 0, uHeadSamples ) } ) );
+		RT_TEST_CHECK( fillUntilResident( sm, "a", vBuffer ) );
+		fillBuffers( sm, 4 * nBuffersPerLoop, vBuffer );
+		RT_TEST_CHECK( latestPeak( sm, vBuffer.size() ) == 0.f );
+
+		// But it does play on its own
+		RT_TEST_CHECK( sm.SendMessage( loopMessage( SoundManager::ECommandID::StartLoop, "a", 0, uHeadSamples ) ) );
+		fillBuffers( sm, 2 * nBuffersPerLoop, vBuffer );
+		RT_TEST_CHECK( latestPeak( sm, vBuffer.size() ) > 0.f );
+	}
+
+	if ( RTCheck::GetNumViolations() != 0 )
+		RTCheck::PrintViolations();
+	RT_TEST_CHECK( RTCheck::GetNumViolations() == 0 );
+
+	// Make sure the detector would have caught something
+	{
+		RTCheck::ScopedAudioThread rtAudioThread;
+		int * volatile pInt = new int( nBuffersFilled );
+		delete pInt;
+	}
+	RTCheck::Violation v;
+	RT_TEST_CHECK( RTCheck::GetNumViolations() == 2 );
+	RT_TEST_CHECK( RTCheck::GetViolation( 0, v ) && v.eType == RTCheck::EViolation::Alloc && v.uSize == sizeof( int ) );
+	RT_TEST_CHECK( RTCheck::GetViolation( 1, v ) && v.eType == RTCheck::EViolation::Free );
+
+	for ( const char * szFile : { "rtcheck_a_head.wav", "rtcheck_a_tail.wav", "rtcheck_b_head.wav", "rtcheck_b_tail.wav" } )
+		remove( szFile );
+
+	if ( s_nFailures )
+		printf( "%d checks failed\n", s_nFailures );
+	else
+		printf( "All checks passed\n" );
+
+	return s_nFailures ? 1 : 0;
+}